@@ -6,10 +6,13 @@ Loads Open Babel, pybel, and applicable normalization wrappers
 @author: Ben Bucior
 """
 
-# Calling an external obabel binary is more expensive than using the built-in Python
-# libraries but ensures that all Open Babel calls are consistent.
+# Calling an external Open Babel binary is more expensive than using the built-in Python
+# libraries but ensures that all Open Babel calls are consistent.  Requests go to one
+# long-lived bin/ob_server process, which caches compiled SMARTS and transforms, instead of
+# starting a new obabel process per call.
 
 import sys, os
+import atexit
 import re
 from mofid.paths import openbabel_path, bin_path
 # Ensure that subprocess32 is installed if running Py2
@@ -21,78 +24,78 @@ if sys.version_info[0] < 3:
 else:
     import subprocess
 
-def runcmd(cmd_list, timeout=None):
-    if timeout is None:
-        return subprocess.run(cmd_list, universal_newlines=True,
-            stdout=subprocess.PIPE, stderr=subprocess.PIPE)
-    else:
-        return subprocess.run(cmd_list, universal_newlines=True,
-            stdout=subprocess.PIPE, stderr=subprocess.PIPE, timeout=timeout)
-
 # Set up local Open Babel data environment before importing the libraries.
 # CIF and other SMILES work is handled by the bin/sbu binary, called as a subprocess
 os.environ['BABEL_DATADIR'] = os.path.join(openbabel_path,'data')  # directory with native EOL
-TSFM_BIN = os.path.join(bin_path,'tsfm_smiles')
-OBABEL_BIN = os.path.join(openbabel_path,'build','bin','obabel')
+SERVER_BIN = os.path.join(bin_path,'ob_server')
+
+_server = None
 
-def quote(smiles_str):
-    # Prepares SMILES strings for Open Babel command line calls.
-    # Formerly wrapped strings within single (non-parseable) quotes, which is necessary in Bash to
-    # avoid globbing/expansion but apparently not for Python's subprocess calls.  The quotes were
-    # being literally passed as part of the SMILES in Linux, resulting in parsing failures.
-    #return ''' + smiles_str + '''
-    return smiles_str
+def _stop_server():
+    global _server
+    if _server is not None:
+        _server.stdin.close()
+        _server.wait()
+        _server = None
 
-def in_smiles(smiles_str):
-    # Adds necessary quotes and Open Babel input notation for SMILES strings
-    return '-:' + quote(smiles_str)
+atexit.register(_stop_server)
+
+def ob_request(*fields):
+    # Sends one tab-separated request to bin/ob_server, starting it on first use.
+    # Returns (ok, result).  Open Babel warnings go straight to our stderr.
+    global _server
+    if _server is None or _server.poll() is not None:
+        _server = subprocess.Popen([SERVER_BIN], universal_newlines=True,
+            stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+    try:
+        _server.stdin.write('\t'.join(fields) + '\n')
+        _server.stdin.flush()
+        response = _server.stdout.readline()
+    except (IOError, OSError):
+        response = ''
+    if not response:
+        _server = None  # restarted on the next request
+        return False, 'ob_server exited unexpectedly'
+    status, _, result = response.rstrip('\n').partition('\t')
+    return status == 'OK', result
 
 def ob_normalize(smiles):
     # Normalizes an arbitrary SMILES string with the same format and parameters as sbu.cpp
-    cpp_run = runcmd([OBABEL_BIN, in_smiles(smiles), '-xi', '-ocan'])
-    cpp_output = cpp_run.stdout
-    if (cpp_run.stderr != '1 molecule converted\n'):
-        sys.stderr.write(cpp_run.stderr + '\n')  # Re-fowarding obabel errors
-    return cpp_output.rstrip()
+    ok, result = ob_request('normalize', smiles)
+    if not ok:
+        sys.stderr.write(result + '\n')  # Re-fowarding Open Babel errors
+        return ''
+    return result
 
 def openbabel_replace(mol_smiles, query, replacement):
     # Perform Open Babel transforms, deletions, and/or replacements on a SMILES molecule.
     # With help from on http://baoilleach.blogspot.com/2012/08/transforming-molecules-intowellother.html
     # See also the [Daylight manual on SMARTS](http://www.daylight.com/dayhtml/doc/theory/theory.smarts.html)
-    # and phmodel.cpp:208, which clarifies the possibilities of Open Babel replacements
-    cpp_run = runcmd([TSFM_BIN, quote(mol_smiles), quote(query), quote(replacement)])
-    cpp_output = cpp_run.stdout
-    sys.stderr.write(cpp_run.stderr)  # Re-fowarding C++ errors
-    return ob_normalize(cpp_output.rstrip())
+    # and phmodel.cpp:208, which clarifies the possibilities of Open Babel replacements.
+    # The server normalizes the result, like ob_normalize.
+    ok, result = ob_request('transform', mol_smiles, query, replacement)
+    if not ok:
+        sys.stderr.write(result + '\n')  # Re-fowarding C++ errors
+        return ''
+    return result
 
 def openbabel_contains(mol_smiles, query):
     # Checks if a molecule (including multi-fragment contains a SMARTS match
-    cpp_run = runcmd([OBABEL_BIN, in_smiles(mol_smiles), '-s', quote(query),
-        '-xi', '-ocan'])
-    if (cpp_run.stderr == '1 molecule converted\n'):
-        return True
-    elif (cpp_run.stderr == '0 molecules converted\n'):
-        return False
-    else:
-        sys.stderr.write(cpp_run.stderr + '\n')  # Re-fowarding obabel errors
+    ok, result = ob_request('contains', mol_smiles, query)
+    if not ok:
+        sys.stderr.write(result + '\n')  # Re-fowarding Open Babel errors
         return False
+    return result == '1'
 
 def openbabel_formula(mol_smiles, smiles=True):
-    # Extracts a molecular formula without relying on the pybel module
-    # The .txt format prints the title: https://openbabel.org/docs/dev/FileFormats/Title_format.html
-    # Note: it looks like the various --append options are in descriptors/filters.cpp, etc.
-    if smiles:
-        input_str = in_smiles(mol_smiles)
-    else:
-        input_str = mol_smiles
-    cpp_run = runcmd([OBABEL_BIN, input_str,
-        '-ab',  # disables bonding for non-SMILES formats, otherwise ignored
-        '--title', 'FAKE',  # override title so we can consistently remove it
-        '--append', 'FORMULA', '-otxt'])
-    cpp_output = cpp_run.stdout
-    if (cpp_run.stderr != '1 molecule converted\n'):
-        sys.stderr.write(cpp_run.stderr + '\n')  # Re-fowarding obabel errors
-    return cpp_output.rstrip().split()[1]  # removes the overwritten title
+    # Extracts a molecular formula without relying on the pybel module.
+    # Same as obabel --append FORMULA (descriptors/filters.cpp) with -ab, which disables
+    # bonding for non-SMILES formats.  Files are read by extension (e.g. orig_mol.cif).
+    ok, result = ob_request('formula', mol_smiles, '1' if smiles else '0')
+    if not ok:
+        sys.stderr.write(result + '\n')  # Re-fowarding Open Babel errors
+        return ''
+    return result
 
 def openbabel_GetSpacedFormula(mol_smiles, delim=' ', smiles=True):
     # Re-implements part of OpenBabel's GetSpacedFormula method
@@ -11,6 +11,7 @@ to wrap it up as a formated string.
 import sys
 import os
 from mofid.paths import resources_path, bin_path
+from mofid.trace_events import span
 
 if sys.version_info[0] < 3:
     try:
@@ -59,7 +60,8 @@ def runcmd(cmd_list, timeout=None):
 
 def extract_fragments(mof_path,output_path):
     # Extract MOF decomposition information using a C++ code based on OpenBabel
-    cpp_run = runcmd([SBU_BIN, mof_path, output_path])
+    with span('sbu', 'process', cif=mof_path):
+        cpp_run = runcmd([SBU_BIN, mof_path, output_path])
     cpp_output = cpp_run.stdout
     sys.stderr.write(cpp_run.stderr)  # Re-forward sbu.cpp errors
     if cpp_run.returncode:  # EasyProcess uses threads, so you don't have to worry about the entire code crashing
@@ -95,8 +97,9 @@ def extract_fragments(mof_path,output_path):
 def extract_topology(mof_path):
     # Extract underlying MOF topology using Systre and the output data from my C++ code
     try:
-        java_run = runcmd(SYSTRE_CMD_LIST + [mof_path],
-            timeout=SYSTRE_TIMEOUT)
+        with span('Systre', 'systre', cgd=mof_path):
+            java_run = runcmd(SYSTRE_CMD_LIST + [mof_path],
+                timeout=SYSTRE_TIMEOUT)
     except subprocess.TimeoutExpired:
         return 'TIMEOUT'
     java_output = java_run.stdout
@@ -10,11 +10,17 @@ import json
 from mofid.id_constructor import (extract_fragments, extract_topology,
     assemble_mofkey, assemble_mofid, parse_mofid)
 from mofid.cpp_cheminformatics import openbabel_GetSpacedFormula
+from mofid.trace_events import span
 DEFAULT_OUTPUT_PATH = 'Output'
 
 def cif2mofid(cif_path,output_path=DEFAULT_OUTPUT_PATH):
     # Assemble the MOFid string from all of its pieces.
     # Also export the MOFkey in an output dict for convenience.
+    # With $MOFID_TRACE set, the whole structure is traced as a span around sbu and Systre.
+    with span(os.path.basename(cif_path), 'structure', cif=cif_path):
+        return _cif2mofid(cif_path, output_path)
+
+def _cif2mofid(cif_path, output_path):
     cif_path = os.path.abspath(cif_path)
     output_path = os.path.abspath(output_path)
 
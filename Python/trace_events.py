@@ -0,0 +1,73 @@
+"""
+Chrome/Perfetto trace events for the Python side of a MOFid run
+
+Appends complete ("X") events to the file named by $MOFID_TRACE, in the same
+format as bin/sbu (src/trace_events.h), which inherits the variable.  Spans from
+Python, sbu, and Systre in a whole batch of runs then line up on one timeline:
+load the file in https://ui.perfetto.dev or chrome://tracing.  Both sides use the
+monotonic clock in microseconds and tag events with the process and thread IDs.
+Nothing is written unless $MOFID_TRACE is set.
+"""
+
+import os
+import json
+import time
+import threading
+from contextlib import contextmanager
+
+TRACE_ENV = 'MOFID_TRACE'
+_named_processes = set()  # (trace path, pid) pairs that already have a process_name event
+
+
+def _thread_id():
+    # The kernel's thread ID, like the C++ side, where available (Python 3.8+)
+    if hasattr(threading, 'get_native_id'):
+        return threading.get_native_id()
+    return threading.current_thread().ident & 0x7fffffff
+
+
+def _append_events(path, events):
+    # Writes whole lines in a single O_APPEND write, so concurrent workers do not interleave.
+    # Only the process that creates the file starts the JSON array, whose closing ] is optional.
+    header = ''
+    try:
+        fd = os.open(path, os.O_WRONLY | os.O_APPEND | os.O_CREAT | os.O_EXCL, 0o644)
+        header = '[\n'
+    except OSError:
+        fd = os.open(path, os.O_WRONLY | os.O_APPEND)
+    try:
+        lines = header + ''.join(json.dumps(e, separators=(',', ':')) + ',\n' for e in events)
+        os.write(fd, lines.encode('utf-8'))
+    finally:
+        os.close(fd)
+
+
+@contextmanager
+def span(name, category, **args):
+    # Records the duration of the with block as a trace event, e.g.
+    # with span('topology.cgd', 'systre', cgd=path): ...
+    path = os.environ.get(TRACE_ENV)
+    if not path:
+        yield
+        return
+    start = time.monotonic()
+    try:
+        yield
+    finally:
+        end = time.monotonic()
+        pid = os.getpid()
+        events = []
+        if (path, pid) not in _named_processes:
+            _named_processes.add((path, pid))
+            events.append({'name': 'process_name', 'ph': 'M', 'pid': pid, 'tid': _thread_id(),
+                'args': {'name': 'python'}})
+        event = {'name': name, 'cat': category, 'ph': 'X', 'ts': round(start * 1e6, 3),
+            'dur': round((end - start) * 1e6, 3), 'pid': pid, 'tid': _thread_id()}
+        if args:
+            event['args'] = args
+        events.append(event)
+        try:
+            _append_events(path, events)
+        except OSError as e:
+            import sys
+            sys.stderr.write('Could not write trace file %s: %s\n' % (path, e))
@@ -222,6 +222,14 @@ enum HydrogenType { AllHydrogen, PolarHydrogen, NonPolarHydrogen };
     //! \warning Does not update any residues which may contain this atom
     //! \return Whether deletion was successful
     bool DeleteAtom(OBAtom*, bool destroyAtom = true);
+    //! Deletes a batch of atoms from this molecule and all of their bonds.
+    //! Unlike repeated calls to DeleteAtom, the atom and bond indexes are only
+    //! updated once, so the cost is linear in the size of the molecule.
+    //! Bonds already detached from their atoms (but still owned by the molecule)
+    //! are also removed if either endpoint is in the batch.
+    //! \warning Does not special-case hydrogens like DeleteAtom
+    //! \return Whether deletion was successful
+    bool DeleteAtoms(const std::vector<OBAtom*> &atoms, bool destroyAtoms = true);
     //! Deletes an bond from this molecule and updates accordingly
     //! \return Whether deletion was successful
     bool DeleteBond(OBBond*, bool destroyBond = true);
@@ -2468,6 +2468,78 @@ namespace OpenBabel
     return(true);
   }
 
+  bool OBMol::DeleteAtoms(const std::vector<OBAtom*> &atoms, bool destroyAtoms)
+  {
+    if (atoms.empty())
+      return(true);
+
+    BeginModify();
+
+    // Flag the doomed atoms by index, which is still valid until the renumbering below
+    vector<bool> doomed(NumAtoms() + 1, false);
+    vector<OBAtom*> removed;  // without duplicates
+    vector<OBAtom*>::const_iterator a;
+    for (a = atoms.begin(); a != atoms.end(); ++a) {
+      if ((*a)->GetParent() != this || (*a)->GetIdx() > NumAtoms() || _vatom[(*a)->GetIdx() - 1] != *a) {
+        obErrorLog.ThrowError(__FUNCTION__, "Atom is not a member of this molecule", obError);
+        EndModify();
+        return(false);
+      }
+      if (!doomed[(*a)->GetIdx()]) {
+        doomed[(*a)->GetIdx()] = true;
+        removed.push_back(*a);
+      }
+    }
+
+    // Remove bonds to any deleted atom in a single pass.
+    // _vbond and _vatom are padded with null pointers past _nbonds and _natoms.
+    vector<OBBond*> kept_bonds;
+    kept_bonds.reserve(_vbond.size());
+    vector<OBBond*>::iterator b;
+    for (b = _vbond.begin(); b != _vbond.begin() + _nbonds; ++b) {
+      OBAtom *begin = (*b)->GetBeginAtom();
+      OBAtom *end = (*b)->GetEndAtom();
+      if (doomed[begin->GetIdx()] || doomed[end->GetIdx()]) {
+        begin->DeleteBond(*b);
+        end->DeleteBond(*b);
+        _bondIds[(*b)->GetId()] = nullptr;
+        DestroyBond(*b);
+      } else {
+        (*b)->SetIdx(kept_bonds.size());  // bond index starts at 0!!!
+        kept_bonds.push_back(*b);
+      }
+    }
+    _vbond.swap(kept_bonds);
+    _nbonds = _vbond.size();
+
+    // Then compact the atoms and reset their indices
+    vector<OBAtom*> kept_atoms;
+    kept_atoms.reserve(_vatom.size());
+    vector<OBAtom*>::iterator i;
+    for (i = _vatom.begin(); i != _vatom.begin() + _natoms; ++i) {
+      if (doomed[(*i)->GetIdx()]) {
+        _atomIds[(*i)->GetId()] = nullptr;
+      } else {
+        kept_atoms.push_back(*i);
+        (*i)->SetIdx(kept_atoms.size());
+      }
+    }
+    _vatom.swap(kept_atoms);
+    _natoms = _vatom.size();
+
+    EndModify();
+
+    for (a = removed.begin(); a != removed.end(); ++a) {
+      DeleteStereoOnAtom(*this, (*a)->GetId());
+      if (destroyAtoms)
+        DestroyAtom(*a);
+    }
+
+    SetSSSRPerceived(false);
+    SetLSSRPerceived(false);
+    return(true);
+  }
+
   bool OBMol::DeleteResidue(OBResidue *residue, bool destroyResidue)
   {
     unsigned short idx = residue->GetIdx();
@@ -0,0 +1,272 @@
+// Google Benchmark suite for the hot paths of bin/sbu, written as JSON by default:
+// bin/bench/mofid_bench [--cif FILE_OR_DIR]... [--supercell N] [--benchmark_filter=REGEX] ...
+// Each CIF (by default, Resources/TestCIFs) is benchmarked as-is, and as 2x2x2 ... NxNxN supercells.
+// The atoms and bonds counters record the structure size, so the JSON can be used to fit scaling.
+
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <benchmark/benchmark.h>
+
+#include <openbabel/babelconfig.h>
+#include <openbabel/mol.h>
+#include <openbabel/obconversion.h>
+#include <openbabel/oberror.h>
+
+#include "config_sbu.h"
+#include "deconstructor.h"
+#include "framework.h"
+#include "scratch_arena.h"
+#include "topology.h"
+#include "virtual_mol.h"
+
+using namespace OpenBabel;
+
+
+struct BenchStructure {
+	std::string name;  // CIF name, with a suffix like _2x2x2 for supercells
+	std::string path;  // empty for supercells, which only exist in memory
+	OBMol mol;  // as imported by sbu, with single bonds and paddlewheels detected
+};
+
+// A deque keeps the structures at fixed addresses for the registered benchmarks
+std::deque<BenchStructure> structures;
+
+
+class MetalOxoBench : public MetalOxoDeconstructor {
+// Exposes the linker exports used by GetMOFInfo and GetLinkerInChIs
+public:
+	MetalOxoBench(OBMol* orig_mof) : MetalOxoDeconstructor(orig_mof) {};
+	std::string WriteLinkers() {
+		return writeFragments(simplified_net.PseudoToOrig(simplified_net.GetAtomsOfRole("linker")), obconv);
+	}
+	std::vector<std::string> LinkerInChIs() {
+		return PAsToUniqueInChIs(simplified_net.GetAtomsOfRole("linker"), "inchi");
+	}
+};
+
+
+void setSizeCounters(benchmark::State& state, BenchStructure* s) {
+	state.counters["atoms"] = s->mol.NumAtoms();
+	state.counters["bonds"] = s->mol.NumBonds();
+}
+
+void BM_importCIF(benchmark::State& state, BenchStructure* s) {
+	for (auto _ : state) {
+		OBMol mol;
+		importCIF(&mol, s->path, false);  // same options as analyzeMOF
+	}
+	setSizeCounters(state, s);
+}
+
+void BM_detectSingleBonds(benchmark::State& state, BenchStructure* s) {
+	OBMol mol;
+	for (auto _ : state) {
+		state.PauseTiming();
+		mol = makeSupercell(&s->mol, 1, 1, 1);  // unbonded copy
+		state.ResumeTiming();
+		detectSingleBonds(&mol);
+	}
+	setSizeCounters(state, s);
+}
+
+void BM_detectPaddlewheels(benchmark::State& state, BenchStructure* s) {
+	OBMol mol;
+	for (auto _ : state) {
+		state.PauseTiming();
+		mol = makeSupercell(&s->mol, 1, 1, 1);
+		detectSingleBonds(&mol);
+		state.ResumeTiming();
+		detectPaddlewheels(&mol);
+	}
+	setSizeCounters(state, s);
+}
+
+void BM_Topology(benchmark::State& state, BenchStructure* s) {
+	for (auto _ : state) {
+		Topology net(&s->mol);
+		benchmark::DoNotOptimize(net);
+	}
+	setSizeCounters(state, s);
+}
+
+template <class T>
+void BM_SimplificationStage(benchmark::State& state, BenchStructure* s, SimplificationStage stage) {
+	// Times one stage of SimplifyMOF, after untimed runs of the earlier stages
+	for (auto _ : state) {
+		state.PauseTiming();
+		{
+			ScratchArenaScope scratch;
+			T simplifier(&s->mol);
+			for (int previous = 0; previous < stage; ++previous) {
+				simplifier.RunSimplificationStage(static_cast<SimplificationStage>(previous));
+			}
+			state.ResumeTiming();
+			simplifier.RunSimplificationStage(stage);
+			state.PauseTiming();
+		}
+		state.ResumeTiming();
+	}
+	setSizeCounters(state, s);
+}
+
+void BM_writeFragments(benchmark::State& state, BenchStructure* s) {
+	ScratchArenaScope scratch;
+	MetalOxoBench simplifier(&s->mol);
+	simplifier.SimplifyMOF(false);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(simplifier.WriteLinkers());
+	}
+	setSizeCounters(state, s);
+}
+
+void BM_PAsToUniqueInChIs(benchmark::State& state, BenchStructure* s) {
+	ScratchArenaScope scratch;
+	MetalOxoBench simplifier(&s->mol);
+	simplifier.SimplifyMOF(false);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(simplifier.LinkerInChIs());
+	}
+	setSizeCounters(state, s);
+}
+
+
+template <class T>
+void registerStages(const std::string &algorithm, BenchStructure* s) {
+	for (int stage = 0; stage < NUM_SIMPLIFICATION_STAGES; ++stage) {
+		std::string name = algorithm + "/" + SIMPLIFICATION_STAGE_NAMES[stage] + "/" + s->name;
+		benchmark::RegisterBenchmark(name.c_str(), BM_SimplificationStage<T>, s, static_cast<SimplificationStage>(stage))
+			->Unit(benchmark::kMillisecond);
+	}
+}
+
+void registerBenchmarks(BenchStructure* s) {
+	if (!s->path.empty()) {
+		benchmark::RegisterBenchmark(("importCIF/" + s->name).c_str(), BM_importCIF, s)->Unit(benchmark::kMillisecond);
+	}
+	benchmark::RegisterBenchmark(("detectSingleBonds/" + s->name).c_str(), BM_detectSingleBonds, s)->Unit(benchmark::kMillisecond);
+	benchmark::RegisterBenchmark(("detectPaddlewheels/" + s->name).c_str(), BM_detectPaddlewheels, s)->Unit(benchmark::kMillisecond);
+	benchmark::RegisterBenchmark(("Topology/" + s->name).c_str(), BM_Topology, s)->Unit(benchmark::kMillisecond);
+	registerStages<MetalOxoDeconstructor>("MetalOxo", s);
+	registerStages<SingleNodeDeconstructor>("SingleNode", s);
+	registerStages<AllNodeDeconstructor>("AllNode", s);
+	registerStages<StandardIsolatedDeconstructor>("StandardIsolated", s);
+	benchmark::RegisterBenchmark(("writeFragments/" + s->name).c_str(), BM_writeFragments, s)->Unit(benchmark::kMillisecond);
+	benchmark::RegisterBenchmark(("PAsToUniqueInChIs/" + s->name).c_str(), BM_PAsToUniqueInChIs, s)->Unit(benchmark::kMillisecond);
+}
+
+
+bool isDirectory(const std::string &path) {
+	struct stat info;
+	return (stat(path.c_str(), &info) == 0) && S_ISDIR(info.st_mode);
+}
+
+void addCIFs(const std::string &path, std::vector<std::string> *cifs) {
+	// Adds a CIF, or the *.cif files of a directory in sorted order
+	if (!isDirectory(path)) {
+		cifs->push_back(path);
+		return;
+	}
+	DIR* dir = opendir(path.c_str());
+	if (!dir) {
+		return;
+	}
+	std::vector<std::string> found;
+	while (struct dirent* entry = readdir(dir)) {
+		std::string name = entry->d_name;
+		if (name.size() > 4 && name.substr(name.size() - 4) == ".cif") {
+			found.push_back(path + "/" + name);
+		}
+	}
+	closedir(dir);
+	std::sort(found.begin(), found.end());
+	cifs->insert(cifs->end(), found.begin(), found.end());
+}
+
+std::string cifName(const std::string &path) {
+	std::string name = path.substr(path.find_last_of("/\\") + 1);
+	if (name.size() > 4 && name.substr(name.size() - 4) == ".cif") {
+		name.erase(name.size() - 4);
+	}
+	return name;
+}
+
+
+int main(int argc, char** argv) {
+#ifdef _WIN32
+	_putenv_s("BABEL_DATADIR", LOCAL_OB_DATADIR);
+	_putenv_s("BABEL_LIBDIR", LOCAL_OB_LIBDIR);
+#else
+	setenv("BABEL_DATADIR", LOCAL_OB_DATADIR, 1);
+	setenv("BABEL_LIBDIR", LOCAL_OB_LIBDIR, 1);
+#endif
+	obErrorLog.SetOutputLevel(obError);  // the deconstructors warn about many test structures
+
+	// Our own options, then everything else is passed through to Google Benchmark
+	std::vector<std::string> cifs;
+	int max_supercell = 2;
+	bool has_format = false;
+	std::vector<char*> benchmark_args(1, argv[0]);
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--cif" && i + 1 < argc) {
+			addCIFs(argv[++i], &cifs);
+		} else if (arg == "--supercell" && i + 1 < argc) {
+			max_supercell = atoi(argv[++i]);
+		} else {
+			has_format = has_format || (arg.find("--benchmark_format") == 0);
+			benchmark_args.push_back(argv[i]);
+		}
+	}
+	if (cifs.empty()) {
+		addCIFs(MOFID_TEST_CIF_DIR, &cifs);
+	}
+	char json_format[] = "--benchmark_format=json";
+	if (!has_format) {
+		benchmark_args.push_back(json_format);
+	}
+
+	for (std::vector<std::string>::iterator it=cifs.begin(); it!=cifs.end(); ++it) {
+		BenchStructure cif;
+		cif.name = cifName(*it);
+		cif.path = *it;
+		if (!importCIF(&cif.mol, cif.path, false)) {
+			std::cerr << "Skipping unreadable CIF " << *it << std::endl;
+			continue;
+		}
+		structures.push_back(cif);
+		for (int n = 2; n <= max_supercell; ++n) {
+			BenchStructure supercell;
+			std::stringstream name;
+			name << cif.name << "_" << n << "x" << n << "x" << n;
+			supercell.name = name.str();
+			supercell.mol = makeSupercell(&cif.mol, n, n, n);
+			detectSingleBonds(&supercell.mol);  // as in importCIF
+			detectPaddlewheels(&supercell.mol);
+			structures.push_back(supercell);
+		}
+	}
+	for (std::deque<BenchStructure>::iterator it=structures.begin(); it!=structures.end(); ++it) {
+		registerBenchmarks(&*it);
+	}
+	std::stringstream num_structures;
+	num_structures << structures.size();
+	benchmark::AddCustomContext("mofid_structures", num_structures.str());
+
+	int num_args = benchmark_args.size();
+	benchmark::Initialize(&num_args, &benchmark_args[0]);
+	if (benchmark::ReportUnrecognizedArguments(num_args, &benchmark_args[0])) {
+		return 2;
+	}
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
@@ -0,0 +1,459 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <utility>
+#include <map>
+#include <set>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <openbabel/obconversion.h>
+#include <openbabel/obiter.h>
+#include <openbabel/generic.h>
+#include <openbabel/atom.h>
+#include <openbabel/math/vector3.h>
+
+#include "cif_compare.h"
+
+using namespace OpenBabel;
+
+AtomGrid::AtomGrid(OBMol* mol, double tolerance) : spacing{std::max(tolerance, MIN_GRID_SPACING)}, numBins{{1, 1, 1}} {
+    unitCell = static_cast<OBUnitCell*>(mol->GetData(OBGenericDataType::UnitCell));
+    if (unitCell) {
+        // Each bin must be at least one spacing wide, measured between opposite faces of the cell
+        const std::vector<vector3> cellVectors{unitCell->GetCellVectors()};
+        const double volume{unitCell->GetCellVolume()};
+        for (int i = 0; i < 3; ++i) {
+            const vector3 faceNormal{cross(cellVectors[(i + 1) % 3], cellVectors[(i + 2) % 3])};
+            const double width{volume / faceNormal.length()};
+            numBins[i] = std::max(1, static_cast<int>(width / spacing));
+        }
+    }
+    FOR_ATOMS_OF_MOL(atom, *mol) {
+        bins[binOf(atom->GetVector())].push_back(&*atom);
+    }
+}
+
+std::array<int, 3> AtomGrid::binOf(const vector3& position) const {
+    std::array<int, 3> bin{};
+    if (unitCell) {
+        const vector3 frac{unitCell->WrapFractionalCoordinate(unitCell->CartesianToFractional(position))};
+        for (int i = 0; i < 3; ++i) {
+            const int b{static_cast<int>(std::floor(frac[i] * numBins[i]))};
+            bin[i] = std::min(numBins[i] - 1, std::max(0, b));  // wrapping leaves values just under 0 or 1
+        }
+    } else {
+        for (int i = 0; i < 3; ++i) {
+            bin[i] = static_cast<int>(std::floor(position[i] / spacing));
+        }
+    }
+    return bin;
+}
+
+std::vector<OBAtom*> AtomGrid::nearbyAtoms(const vector3& position) const {
+    const std::array<int, 3> center{binOf(position)};
+    std::vector<std::array<int, 3>> neighbors{};
+    for (int dx = -1; dx <= 1; ++dx) {
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dz = -1; dz <= 1; ++dz) {
+                std::array<int, 3> bin{{center[0] + dx, center[1] + dy, center[2] + dz}};
+                if (unitCell) {
+                    for (int i = 0; i < 3; ++i) {
+                        bin[i] = ((bin[i] % numBins[i]) + numBins[i]) % numBins[i];
+                    }
+                }
+                // Small cells have fewer than three bins per axis, so neighbors can repeat
+                if (std::find(neighbors.begin(), neighbors.end(), bin) == neighbors.end()) {
+                    neighbors.push_back(bin);
+                }
+            }
+        }
+    }
+    std::vector<OBAtom*> atoms{};
+    for (const std::array<int, 3>& bin : neighbors) {
+        const auto search = bins.find(bin);
+        if (search != bins.end()) {
+            atoms.insert(atoms.end(), search->second.begin(), search->second.end());
+        }
+    }
+    return atoms;
+}
+
+double AtomGrid::distance(const vector3& a, const vector3& b) const {
+    if (unitCell) {
+        return unitCell->MinimumImageCartesian(a - b).length();
+    }
+    return (a - b).length();
+}
+
+OBMol getMolFromCIF(const std::string& pathToFile) {
+    std::fstream cif{pathToFile};
+    OBConversion obconversion(&cif);
+    obconversion.SetInFormat("CIF");
+    obconversion.SetOptions("Bbs", OBConversion::INOPTIONS);
+    OBMol mol{};
+    obconversion.Read(&mol);
+    return mol;
+}
+
+bool areMolsSame(OBMol* mol1, OBMol* mol2, double tolerance) {
+    bool isIdentical{true};
+    if (!(mol1->NumAtoms() == mol2->NumAtoms())) {
+        std::cout << "Molecular atom count mismatch" << " mol1: " << mol1->NumAtoms() << " mol2: " << mol2->NumAtoms() << std::endl;
+        isIdentical = false;
+    }
+    if (!(mol1->NumBonds() == mol2->NumBonds())) {
+        std::cout << "Molecular bond count mismatch" << " mol1: " << mol1->NumBonds() << " mol2: " << mol2->NumBonds() << std::endl;
+        isIdentical = false;
+    }
+    if (mol1->GetFormula() != mol2->GetFormula()) {
+        std::cout << "Molecular stoichiometric formula mismatch" << " " << mol1->GetFormula() << " " << mol2->GetFormula() << std::endl;
+        isIdentical = false;
+    }
+    if (!areUnitCellsSame(mol1, mol2, tolerance)) {
+        isIdentical = false;
+    }
+    if (!isIdentical) {
+        return false;
+    }
+    std::vector<OBAtom*> atomMatches{};
+    if (!areAtomsSame(mol1, mol2, tolerance, atomMatches)) {
+        return false;
+    }
+    return areBondsSame(mol1, mol2, atomMatches);
+}
+
+bool areUnitCellsSame(OBMol* mol1, OBMol* mol2, double tolerance) {
+    OBUnitCell* mol1UC{static_cast<OBUnitCell*>(mol1->GetData(OBGenericDataType::UnitCell))};
+    OBUnitCell* mol2UC{static_cast<OBUnitCell*>(mol2->GetData(OBGenericDataType::UnitCell))};
+    if (!mol1UC || !mol2UC) {
+        if (mol1UC != mol2UC) {
+            std::cout << "Only one molecule has a unit cell" << std::endl;
+            return false;
+        }
+        return true;
+    }
+    if (mol1UC->GetLatticeType() != mol2UC->GetLatticeType()) {
+        std::cout << "Molecular unit cell lattice type mismatch" << std::endl;
+        return false;
+    }
+    // Positions are matched within the cell of mol1, so the cells themselves must agree
+    const std::vector<vector3> mol1Vectors{mol1UC->GetCellVectors()};
+    const std::vector<vector3> mol2Vectors{mol2UC->GetCellVectors()};
+    for (std::size_t i = 0; i < mol1Vectors.size(); ++i) {
+        if ((mol1Vectors[i] - mol2Vectors[i]).length() > tolerance) {
+            std::cout << "Molecular unit cell vector mismatch " << mol1Vectors[i] << " " << mol2Vectors[i] << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool areAtomsSame(OBMol* mol1, OBMol* mol2, double tolerance, std::vector<OBAtom*>& atomMatches) {
+    const AtomGrid mol1Grid{mol1, tolerance};
+    std::vector<bool> isMatched(mol1->NumAtoms() + 1, false);  // by atom index
+    atomMatches.assign(mol2->NumAtoms() + 1, nullptr);
+    bool allMatched{true};
+    FOR_ATOMS_OF_MOL(mol2Atom, *mol2) {
+        OBAtom* bestMatch{nullptr};
+        double bestDistance{tolerance};
+        for (OBAtom* mol1Atom : mol1Grid.nearbyAtoms(mol2Atom->GetVector())) {
+            if (isMatched[mol1Atom->GetIdx()] || !isAtomSame(mol1Atom, &*mol2Atom)) {
+                continue;
+            }
+            const double distance{mol1Grid.distance(mol1Atom->GetVector(), mol2Atom->GetVector())};
+            if (distance <= bestDistance) {
+                bestMatch = mol1Atom;
+                bestDistance = distance;
+            }
+        }
+        if (bestMatch) {
+            isMatched[bestMatch->GetIdx()] = true;
+            atomMatches[mol2Atom->GetIdx()] = bestMatch;
+        } else {
+            std::cout << "Atom match not found " << mol2Atom->GetAtomicNum() << " at " << mol2Atom->GetVector() << std::endl;
+            allMatched = false;
+        }
+    }
+    return allMatched;
+}
+
+bool isAtomSame(OBAtom* atom1, OBAtom* atom2) {
+    if (atom1->GetAtomicNum() != atom2->GetAtomicNum()) {
+        return false;
+    }
+    if (atom1->GetIsotope() != atom2->GetIsotope()) {
+        return false;
+    }
+    if (atom1->GetHyb() != atom2->GetHyb()) {
+        return false;
+    }
+    return true;
+}
+
+bool areBondsSame(OBMol* mol1, OBMol* mol2, const std::vector<OBAtom*>& atomMatches) {
+    // With equal bond counts, mapping every mol2 bond onto mol1 also covers the reverse.
+    // GetBond only scans the adjacency list of one atom, so this is linear in the number of bonds.
+    bool allMatched{true};
+    FOR_BONDS_OF_MOL(mol2Bond, *mol2) {
+        OBAtom* begin{atomMatches[mol2Bond->GetBeginAtomIdx()]};
+        OBAtom* end{atomMatches[mol2Bond->GetEndAtomIdx()]};
+        if (!begin || !end || !mol1->GetBond(begin, end)) {
+            std::cout << "Bond match not found " << mol2Bond->GetBeginAtom()->GetAtomicNum() << "-" << mol2Bond->GetEndAtom()->GetAtomicNum()
+                << " at " << mol2Bond->GetBeginAtom()->GetVector() << std::endl;
+            allMatched = false;
+        }
+    }
+    return allMatched;
+}
+
+bool areCIFsSame(const std::string& cif1, const std::string& cif2, double tolerance) {
+    OBMol mol1{getMolFromCIF(cif1)};
+    OBMol mol2{getMolFromCIF(cif2)};
+    return areMolsSame(&mol1, &mol2, tolerance);
+}
+
+namespace {
+// Distance between fractional positions, allowing for lattice translations
+double periodicDistance(const vector3& a, const vector3& b) {
+    const vector3 delta{a - b};
+    const vector3 wrapped{delta.x() - std::round(delta.x()), delta.y() - std::round(delta.y()), delta.z() - std::round(delta.z())};
+    return wrapped.length();
+}
+
+bool isEdgeSame(const std::pair<vector3, vector3>& edge1, const std::pair<vector3, vector3>& edge2, double tolerance) {
+    // Edges match if one is a lattice translation of the other, in either direction
+    const vector3 delta1{edge1.second - edge1.first};
+    const vector3 delta2{edge2.second - edge2.first};
+    if (periodicDistance(edge1.first, edge2.first) <= tolerance && (delta1 - delta2).length() <= tolerance) {
+        return true;
+    }
+    return periodicDistance(edge1.first, edge2.second) <= tolerance && (delta1 + delta2).length() <= tolerance;
+}
+}  // end anonymous namespace
+
+bool readCGD(const std::string& pathToFile, CGDNet& net) {
+    std::ifstream cgd{pathToFile};
+    if (!cgd) {
+        std::cout << "Could not read " << pathToFile << std::endl;
+        return false;
+    }
+    std::string line{};
+    while (std::getline(cgd, line)) {
+        std::istringstream fields{line};
+        std::string keyword{};
+        fields >> keyword;
+        if (keyword == "CELL") {
+            std::array<double, 6> cell{};
+            for (double& parameter : cell) {
+                fields >> parameter;
+            }
+            net.cells.push_back(cell);
+        } else if (keyword == "NODE") {
+            int id{};
+            int connections{};
+            double x{}, y{}, z{};
+            fields >> id >> connections >> x >> y >> z;
+            net.nodes.push_back(std::make_pair(connections, vector3{x, y, z}));
+        } else if (keyword == "EDGE") {
+            double begin[3]{};
+            double end[3]{};
+            fields >> begin[0] >> begin[1] >> begin[2] >> end[0] >> end[1] >> end[2];
+            net.edges.push_back(std::make_pair(vector3{begin[0], begin[1], begin[2]}, vector3{end[0], end[1], end[2]}));
+        } else {
+            continue;
+        }
+        if (fields.fail()) {
+            std::cout << "Malformed line in " << pathToFile << ": " << line << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool areNetsSame(const CGDNet& net1, const CGDNet& net2, double tolerance) {
+    if (net1.cells.size() != net2.cells.size() || net1.nodes.size() != net2.nodes.size()
+            || net1.edges.size() != net2.edges.size()) {
+        std::cout << "Net size mismatch" << " net1: " << net1.nodes.size() << " nodes, " << net1.edges.size() << " edges"
+            << " net2: " << net2.nodes.size() << " nodes, " << net2.edges.size() << " edges" << std::endl;
+        return false;
+    }
+    for (std::size_t i = 0; i < net1.cells.size(); ++i) {
+        for (int j = 0; j < 6; ++j) {
+            // Cell lengths and angles are printed with six significant figures
+            if (std::fabs(net1.cells[i][j] - net2.cells[i][j]) > 1e-4 * std::max(1.0, std::fabs(net1.cells[i][j]))) {
+                std::cout << "Net unit cell mismatch " << net1.cells[i][j] << " " << net2.cells[i][j] << std::endl;
+                return false;
+            }
+        }
+    }
+    // The nets are small compared to the CIFs, so simple greedy matching is fast enough
+    bool allMatched{true};
+    std::vector<bool> isNodeMatched(net1.nodes.size(), false);
+    for (const std::pair<int, vector3>& node : net2.nodes) {
+        bool found{false};
+        for (std::size_t i = 0; i < net1.nodes.size() && !found; ++i) {
+            if (!isNodeMatched[i] && net1.nodes[i].first == node.first
+                    && periodicDistance(net1.nodes[i].second, node.second) <= tolerance) {
+                isNodeMatched[i] = true;
+                found = true;
+            }
+        }
+        if (!found) {
+            std::cout << "Node match not found " << node.first << "-c at " << node.second << std::endl;
+            allMatched = false;
+        }
+    }
+    std::vector<bool> isEdgeMatched(net1.edges.size(), false);
+    for (const std::pair<vector3, vector3>& edge : net2.edges) {
+        bool found{false};
+        for (std::size_t i = 0; i < net1.edges.size() && !found; ++i) {
+            if (!isEdgeMatched[i] && isEdgeSame(net1.edges[i], edge, tolerance)) {
+                isEdgeMatched[i] = true;
+                found = true;
+            }
+        }
+        if (!found) {
+            std::cout << "Edge match not found " << edge.first << " to " << edge.second << std::endl;
+            allMatched = false;
+        }
+    }
+    return allMatched;
+}
+
+bool areCGDsSame(const std::string& cgd1, const std::string& cgd2, double tolerance) {
+    CGDNet net1{};
+    CGDNet net2{};
+    if (!readCGD(cgd1, net1) || !readCGD(cgd2, net2)) {
+        return false;
+    }
+    return areNetsSame(net1, net2, tolerance);
+}
+
+bool areLineSetsSame(const std::string& file1, const std::string& file2) {
+    std::multiset<std::string> lines[2]{};
+    const std::string paths[2]{file1, file2};
+    for (int i = 0; i < 2; ++i) {
+        std::ifstream file{paths[i]};
+        if (!file) {
+            std::cout << "Could not read " << paths[i] << std::endl;
+            return false;
+        }
+        std::string line{};
+        while (std::getline(file, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (!line.empty()) {
+                lines[i].insert(line);
+            }
+        }
+    }
+    if (lines[0] == lines[1]) {
+        return true;
+    }
+    // Each line that differs in count, once, like diff
+    for (auto it = lines[0].begin(); it != lines[0].end(); it = lines[0].upper_bound(*it)) {
+        if (lines[1].count(*it) < lines[0].count(*it)) {
+            std::cout << "< " << *it << std::endl;
+        }
+    }
+    for (auto it = lines[1].begin(); it != lines[1].end(); it = lines[1].upper_bound(*it)) {
+        if (lines[0].count(*it) < lines[1].count(*it)) {
+            std::cout << "> " << *it << std::endl;
+        }
+    }
+    return false;
+}
+
+bool areDirectoriesSame(const std::string& dir1, const std::string& dir2, double tolerance) {
+    std::vector<std::string> cifs1{};
+    std::vector<std::string> cifs2{};
+    findCIFs(dir1, "", cifs1);
+    findCIFs(dir2, "", cifs2);
+    std::set<std::string> allCIFs{cifs1.begin(), cifs1.end()};
+    allCIFs.insert(cifs2.begin(), cifs2.end());
+
+    const std::set<std::string> inDir1{cifs1.begin(), cifs1.end()};
+    const std::set<std::string> inDir2{cifs2.begin(), cifs2.end()};
+    int numDifferent{0};
+    for (const std::string& cif : allCIFs) {
+        if (!inDir1.count(cif) || !inDir2.count(cif)) {
+            std::cout << "MISSING: " << cif << " is only in " << (inDir1.count(cif) ? dir1 : dir2) << std::endl;
+            ++numDifferent;
+        } else if (!areCIFsSame(dir1 + "/" + cif, dir2 + "/" + cif, tolerance)) {
+            std::cout << "DIFFERENT: " << cif << std::endl;
+            ++numDifferent;
+        }
+    }
+    std::cout << numDifferent << " of " << allCIFs.size() << " CIFs differ" << std::endl;
+    return numDifferent == 0;
+}
+
+void findCIFs(const std::string& root, const std::string& relativeDir, std::vector<std::string>& cifs) {
+    findFiles(root, relativeDir, ".cif", cifs);
+}
+
+void findFiles(const std::string& root, const std::string& relativeDir, const std::string& suffix, std::vector<std::string>& files) {
+    const std::string dirPath{relativeDir.empty() ? root : root + "/" + relativeDir};
+    DIR* dir{opendir(dirPath.c_str())};
+    if (!dir) {
+        return;
+    }
+    std::vector<std::string> names{};
+    while (struct dirent* entry = readdir(dir)) {
+        const std::string name{entry->d_name};
+        if (name != "." && name != "..") {
+            names.push_back(name);
+        }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    for (const std::string& name : names) {
+        const std::string relativePath{relativeDir.empty() ? name : relativeDir + "/" + name};
+        if (isDirectory(root + "/" + relativePath)) {
+            findFiles(root, relativePath, suffix, files);
+        } else if (hasSuffix(name, suffix)) {
+            files.push_back(relativePath);
+        }
+    }
+}
+
+bool hasSuffix(const std::string& name, const std::string& suffix) {
+    return name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool isDirectory(const std::string& path) {
+    struct stat info{};
+    return (stat(path.c_str(), &info) == 0) && S_ISDIR(info.st_mode);
+}
+
+void printBonds(OBMol* mol, const std::string& name, int precision) {
+    OBBondIterator molBonds{mol->BeginBonds()};
+    const OBBondIterator molBondsEnd{mol->EndBonds()};
+    while (molBonds != molBondsEnd) {
+        printBond(*molBonds, name, precision);
+        ++molBonds;
+    }
+}
+
+void printBond(OBBond* bond, const std::string& name, int precision) {
+        OBAtom* beginAtom{bond->GetBeginAtom()};
+        int beginAtomX{static_cast<int>(std::trunc(beginAtom->GetX() * std::pow(10, precision)))};
+        int beginAtomY{static_cast<int>(std::trunc(beginAtom->GetY() * std::pow(10, precision)))};
+        int beginAtomZ{static_cast<int>(std::trunc(beginAtom->GetZ() * std::pow(10, precision)))};
+        OBAtom* endAtom{bond->GetEndAtom()};
+        int endAtomX{static_cast<int>(std::trunc(endAtom->GetX() * std::pow(10, precision)))};
+        int endAtomY{static_cast<int>(std::trunc(endAtom->GetY() * std::pow(10, precision)))};
+        int endAtomZ{static_cast<int>(std::trunc(endAtom->GetZ() * std::pow(10, precision)))};
+        std::cout << name << ": (" << beginAtomX << " " << beginAtomY << " " << beginAtomZ << ") (" << endAtomX << " " << endAtomY << " " << endAtomZ << ") order: " << bond->GetBondOrder() << std::endl;
+}
+
+bool isClose(double A, double B) {
+    return (std::fabs(A - B) <= 0.0001);
+}
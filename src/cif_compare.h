@@ -0,0 +1,75 @@
+#ifndef CIF_COMPARE_H
+#define CIF_COMPARE_H
+
+#include <array>
+#include <map>
+#include <vector>
+#include <string>
+
+#include <openbabel/mol.h>
+#include <openbabel/bond.h>
+#include <openbabel/generic.h>
+#include <openbabel/math/vector3.h>
+
+using namespace OpenBabel;
+
+// Atoms closer than this (in Angstroms) are considered to be at the same position
+const double DEFAULT_POSITION_TOLERANCE{0.01};
+// Fractional coordinates in topology.cgd closer than this are the same, after wrapping into the cell
+const double DEFAULT_FRACTIONAL_TOLERANCE{0.001};
+// Smallest bin of the spatial hash, so tiny tolerances do not create millions of empty bins
+const double MIN_GRID_SPACING{0.5};
+
+// Spatial hash of a molecule's atoms.  For periodic molecules, the bins tile the unit cell and
+// positions are wrapped, so periodic images of the same atom land in the same bin.
+class AtomGrid {
+public:
+    AtomGrid(OBMol* mol, double tolerance);
+    // Atoms in the bin of the position and its neighbors, i.e. every atom within the tolerance
+    std::vector<OBAtom*> nearbyAtoms(const vector3& position) const;
+    // Minimum image distance for periodic molecules
+    double distance(const vector3& a, const vector3& b) const;
+private:
+    std::array<int, 3> binOf(const vector3& position) const;
+    OBUnitCell* unitCell;  // nullptr for non-periodic molecules
+    double spacing;
+    std::array<int, 3> numBins;
+    std::map<std::array<int, 3>, std::vector<OBAtom*>> bins;
+};
+
+// Periodic net from a topology.cgd written by sbu, in fractional coordinates.  Node IDs are
+// dropped, since they depend on the order of the pseudo atoms.
+struct CGDNet {
+    std::vector<std::array<double, 6>> cells;  // a, b, c, alpha, beta, gamma for each CRYSTAL
+    std::vector<std::pair<int, vector3>> nodes;  // coordination number and position
+    std::vector<std::pair<vector3, vector3>> edges;
+};
+
+OBMol getMolFromCIF(const std::string& pathToFile);
+bool areMolsSame(OBMol* mol1, OBMol* mol2, double tolerance);
+bool areUnitCellsSame(OBMol* mol1, OBMol* mol2, double tolerance);
+// Matches each atom of mol2 to the nearest unmatched atom of mol1 within the tolerance,
+// filling atomMatches by mol2 atom index.  Returns false if any atom has no match.
+bool areAtomsSame(OBMol* mol1, OBMol* mol2, double tolerance, std::vector<OBAtom*>& atomMatches);
+bool isAtomSame(OBAtom* atom1, OBAtom* atom2);
+// Every bond of mol2 must join the matches of its atoms in mol1
+bool areBondsSame(OBMol* mol1, OBMol* mol2, const std::vector<OBAtom*>& atomMatches);
+bool areCIFsSame(const std::string& cif1, const std::string& cif2, double tolerance);
+bool readCGD(const std::string& pathToFile, CGDNet& net);
+// Same cells, node multiset, and edges, where nodes and edges may be shifted by lattice vectors
+bool areNetsSame(const CGDNet& net1, const CGDNet& net2, double tolerance);
+bool areCGDsSame(const std::string& cgd1, const std::string& cgd2, double tolerance);
+// Same lines in any order, e.g. for the linker InChIs, where only the multiset is meaningful
+bool areLineSetsSame(const std::string& file1, const std::string& file2);
+// Compares the CIFs with the same relative paths in both directory trees
+bool areDirectoriesSame(const std::string& dir1, const std::string& dir2, double tolerance);
+void findCIFs(const std::string& root, const std::string& relativeDir, std::vector<std::string>& cifs);
+// Relative paths of the files under root ending in suffix (or all files for ""), in sorted order
+void findFiles(const std::string& root, const std::string& relativeDir, const std::string& suffix, std::vector<std::string>& files);
+bool hasSuffix(const std::string& name, const std::string& suffix);
+bool isDirectory(const std::string& path);
+void printBonds(OBMol* mol, const std::string& name, int precision);
+void printBond(OBBond* bond, const std::string& name, int precision);
+bool isClose(double A, double B);
+
+#endif // CIF_COMPARE_H
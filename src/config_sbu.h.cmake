@@ -4,3 +4,5 @@
 #define LOCAL_OB_DATADIR "@LOCAL_OB_DATADIR@"
 /* Where the shared libraries are located */
 #define LOCAL_OB_LIBDIR "@LOCAL_OB_LIBDIR@"
+/* Signature of the fragment export sources, for FragmentCache namespaces */
+#define FRAGMENT_EXPORT_SIGNATURE "@FRAGMENT_EXPORT_SIGNATURE@"
@@ -2,8 +2,12 @@
 #include "invector.h"
 #include "obdetails.h"
 #include "framework.h"
+#include "fragment_cache.h"
+#include "fragment_hash.h"
 #include "periodic.h"
+#include "run_stats.h"
 #include "topology.h"
+#include "trace_events.h"
 
 #include <string>
 #include <sstream>
@@ -11,6 +15,7 @@
 #include <queue>
 #include <stack>
 #include <set>
+#include <functional>  // std::less
 #include <utility>  // std::pair
 
 #include <openbabel/babelconfig.h>
@@ -29,14 +34,41 @@ namespace OpenBabel
 
 std::set<std::string> LOGGED_ERRORS;  // global variable to keep track of reported errors in exportNormalizedMol
 
-std::string writeFragments(std::vector<OBMol> fragments, OBConversion obconv, bool only_single_bonds) {
+std::string writeFragments(const std::vector<OBMol> &fragments, OBConversion &obconv, bool only_single_bonds) {
 	// Write a list of unique SMILES for a set of fragments
 	// TODO: consider stripping out extraneous tabs, etc, here or elsewhere in the code.
 	std::stringstream written;
 	std::set<std::string> unique_smiles;
-	for (std::vector<OBMol>::iterator it = fragments.begin(); it != fragments.end(); ++it) {
+	for (std::vector<OBMol>::const_iterator it = fragments.begin(); it != fragments.end(); ++it) {
 		unique_smiles.insert(getSMILES(*it, obconv, only_single_bonds));  // only adds unique values in a set
 	}
+	countStat("fragments", fragments.size());
+	for (std::set<std::string>::iterator i2 = unique_smiles.begin(); i2 != unique_smiles.end(); ++i2) {
+		written << *i2;
+	}
+
+	return written.str();
+}
+
+
+std::string writeFragments(VirtualMol fragment_atoms, OBConversion &obconv, bool only_single_bonds) {
+	// Same as above, but separates the fragments as VirtualMol views of the parent molecule.
+	// Each fragment is then copied out of the parent only once, instead of via a combined OBMol.
+	// Normalized fragments are first deduplicated by their labeled graph, so symmetry-equivalent
+	// copies (e.g. all 24 BDC linkers in an IRMOF-1 P1 cell) are only written once.
+	std::stringstream written;
+	std::set<std::string> unique_smiles;
+	FragmentExportBatch batch(std::vector<OBConversion*>(1, &obconv), only_single_bonds);
+	std::vector<VirtualMol> fragments = fragment_atoms.Separate();
+	for (std::vector<VirtualMol>::iterator it = fragments.begin(); it != fragments.end(); ++it) {
+		batch.AddFragment(*it);
+	}
+	batch.Export();
+	countStat("fragments", batch.NumFragments());
+	countStat("distinct_fragments", batch.NumDistinct());
+	for (std::size_t i = 0; i < batch.NumFragments(); ++i) {
+		unique_smiles.insert(batch.GetOutputs(i)[0]);
+	}
 	for (std::set<std::string>::iterator i2 = unique_smiles.begin(); i2 != unique_smiles.end(); ++i2) {
 		written << *i2;
 	}
@@ -45,33 +77,68 @@ std::string writeFragments(std::vector<OBMol> fragments, OBConversion obconv, bo
 }
 
 
-std::string exportNormalizedMol(OBMol fragment, OBConversion obconv, bool only_single_bonds, bool unique_errors) {
-	// Resets a fragment's bonding/location before format conversion
+std::string exportNormalizedMol(const OBMol &fragment, OBConversion &obconv, bool only_single_bonds, bool unique_errors) {
+	// Resets a copy of the fragment's bonding/location before format conversion
+	OBMol canon = fragment;
+	return exportNormalizedMolInPlace(&canon, obconv, only_single_bonds, unique_errors);
+}
+
+
+std::string exportNormalizedMol(VirtualMol fragment, OBConversion &obconv, bool only_single_bonds, bool unique_errors) {
+	// Copies the fragment out of its parent molecule, then normalizes and exports the copy directly.
+	std::vector<OBConversion*> convs(1, &obconv);
+	return exportNormalizedMol(fragment, convs, only_single_bonds, unique_errors)[0];
+}
+
+
+std::vector<std::string> exportNormalizedMol(VirtualMol fragment, const std::vector<OBConversion*> &convs, bool only_single_bonds, bool unique_errors) {
+	// Exports one normalized copy of the fragment to several formats, e.g. SMILES and InChI
+	MappedMol canon;
+	fragment.CopyToMappedMol(&canon, false, true, false);  // only the atoms, since resetBonds redetects bonds
+	return exportNormalizedMolInPlace(&canon.mol_copy, convs, only_single_bonds, unique_errors);
+}
+
+
+std::string exportNormalizedMolInPlace(OBMol *fragment, OBConversion &obconv, bool only_single_bonds, bool unique_errors) {
+	std::vector<OBConversion*> convs(1, &obconv);
+	return exportNormalizedMolInPlace(fragment, convs, only_single_bonds, unique_errors)[0];
+}
+
+
+std::vector<std::string> exportNormalizedMolInPlace(OBMol *fragment, const std::vector<OBConversion*> &convs, bool only_single_bonds, bool unique_errors) {
+	// Resets a fragment's bonding/location before format conversion, modifying fragment.
+	// The normalized fragment is then written with each OBConversion in order.
 	// If only_single_bonds is set (disabled by default), only use single bonds instead of bond orders.
+	normalizeFragmentMol(fragment, only_single_bonds, unique_errors);
+	return writeNormalizedMol(fragment, convs, unique_errors);
+}
 
-	// If unique_errors is set (enabled by default), only report a unique error message once per executable.
-	// Otherwise, some MOFs flood the error log with warnings about aromatic bonds (raised by
-	// PerceiveBondOrders within resetBonds) or unexpected valences in the InChI converter.
 
+class UniqueErrorScope {
+// If unique_errors is set, collects the obErrorLog output in the scope and re-raises each unique
+// message only once per executable.  Otherwise, some MOFs flood the error log with warnings about
+// aromatic bonds (raised by PerceiveBondOrders within resetBonds) or unexpected valences in the InChI
+// converter.  obErrorLog and LOGGED_ERRORS are unsynchronized globals, so scopes must not be opened
+// from several threads at once.
+private:
+	bool unique_errors;
 	std::stringstream redirected_errors;
-	std::ostream* orig_err_stream = NULL;
-	if (unique_errors) {
-		orig_err_stream = obErrorLog.GetOutputStream();
-		obErrorLog.SetOutputStream(&redirected_errors);
-	}
+	std::ostream* orig_err_stream;
 
-	// A block of actual, non-error work:
-	OBMol canon = fragment;
-	resetBonds(&canon);
-	if (only_single_bonds) {
-		FOR_BONDS_OF_MOL(b, canon) {
-			b->SetBondOrder(1);
+	UniqueErrorScope(const UniqueErrorScope& other);
+	UniqueErrorScope& operator=(const UniqueErrorScope&);
+
+public:
+	UniqueErrorScope(bool unique) : unique_errors(unique), orig_err_stream(NULL) {
+		if (unique_errors) {
+			orig_err_stream = obErrorLog.GetOutputStream();
+			obErrorLog.SetOutputStream(&redirected_errors);
 		}
 	}
-	unwrapFragmentMol(&canon);
-	std::string output_string = obconv.WriteString(&canon);
-
-	if (unique_errors) {
+	~UniqueErrorScope() {
+		if (!unique_errors) {
+			return;
+		}
 		obErrorLog.SetOutputStream(orig_err_stream);  // restore the original error stream
 		std::set<std::string> errors = getUniqueErrors(redirected_errors.str());
 		for (std::set<std::string>::iterator it=errors.begin(); it!=errors.end(); ++it) {
@@ -82,17 +149,156 @@ std::string exportNormalizedMol(OBMol fragment, OBConversion obconv, bool only_s
 			}
 		}
 	}
+};
+
+
+void normalizeFragmentMol(OBMol *fragment, bool only_single_bonds, bool unique_errors) {
+	// Perceives the fragment's bonds from scratch and unwraps it from the periodic cell.
+	// Afterwards, its exports only depend on its labeled graph (see FragmentInvariant).
+	UniqueErrorScope errors(unique_errors);
+	resetBonds(fragment);
+	if (only_single_bonds) {
+		FOR_BONDS_OF_MOL(b, *fragment) {
+			b->SetBondOrder(1);
+		}
+	}
+	unwrapFragmentMol(fragment);
+}
+
+
+std::vector<std::string> writeNormalizedMol(OBMol *fragment, const std::vector<OBConversion*> &convs, bool unique_errors) {
+	// Writes a fragment from normalizeFragmentMol with each OBConversion in order.
+	// If a persistent FragmentCache is open and has every format, the writers are skipped entirely.
+	std::vector<std::string> outputs(convs.size());
+	FragmentCache &cache = globalFragmentCache();
+	FragmentInvariant invariant;
+	std::vector<std::string> conv_keys;
+	if (cache.IsOpen()) {
+		invariant = FragmentInvariant(*fragment);
+		bool all_cached = true;
+		for (std::size_t i = 0; i < convs.size(); ++i) {
+			conv_keys.push_back(FragmentCache::GetConversionKey(*convs[i]));
+			all_cached = all_cached && cache.Lookup(invariant, conv_keys[i], &outputs[i]);
+		}
+		if (all_cached) {
+			countStat("fragment_cache_hits");
+			return outputs;
+		}
+	}
 
-	return output_string;
+	UniqueErrorScope errors(unique_errors);
+	bool instrumented = RunStats::Current() || globalTraceSink().IsOpen();
+	for (std::size_t i = 0; i < convs.size(); ++i) {
+		if (!instrumented) {
+			outputs[i] = convs[i]->WriteString(fragment);
+			continue;
+		}
+		// The InChI format also writes InChIKeys, and everything else here is a SMILES flavor
+		OBFormat *format = convs[i]->GetOutFormat();
+		bool is_inchi = format && std::string(format->GetID()).find("inchi") == 0;
+		countStat(is_inchi ? "inchi_calls" : "smiles_calls");
+		TraceSpan span(is_inchi ? "InChI" : "SMILES", "export");
+		outputs[i] = convs[i]->WriteString(fragment);
+	}
+	if (cache.IsOpen()) {
+		for (std::size_t i = 0; i < convs.size(); ++i) {
+			cache.Store(invariant, conv_keys[i], outputs[i]);
+		}
+	}
+	return outputs;
 }
 
 
-std::string getSMILES(OBMol fragment, OBConversion obconv, bool only_single_bonds) {
+std::string getSMILES(const OBMol &fragment, OBConversion &obconv, bool only_single_bonds) {
 	// Prints SMILES based on OBConversion parameters
 	return exportNormalizedMol(fragment, obconv, only_single_bonds);
 }
 
 
+std::string getSMILES(VirtualMol fragment, OBConversion &obconv, bool only_single_bonds) {
+	return exportNormalizedMol(fragment, obconv, only_single_bonds);
+}
+
+
+FragmentExportBatch::FragmentExportBatch(const std::vector<OBConversion*> &conversions, bool single_bonds) {
+	convs = conversions;
+	only_single_bonds = single_bonds;
+	conv_outputs.resize(convs.size());
+}
+
+
+std::size_t FragmentExportBatch::AddFragment(VirtualMol fragment) {
+	// Normalizes a copy of the fragment right away, since bond perception depends on its geometry
+	// and atom order, but only keeps the copy if no earlier fragment has the same labeled graph
+	distinct_fragments.emplace_back();
+	MappedMol &canon = distinct_fragments.back();
+	fragment.CopyToMappedMol(&canon, false, true, false);  // only the atoms, since resetBonds redetects bonds
+	normalizeFragmentMol(&canon.mol_copy, only_single_bonds);
+	FragmentInvariant invariant(canon.mol_copy);
+
+	std::vector<std::size_t> &bucket = buckets[invariant.GetKey()];
+	std::size_t distinct_index = distinct_invariants.size();
+	for (std::vector<std::size_t>::iterator it = bucket.begin(); it != bucket.end(); ++it) {
+		if (distinct_invariants[*it].Matches(invariant)) {  // exact check in case of a hash collision
+			distinct_index = *it;
+			break;
+		}
+	}
+	if (distinct_index == distinct_invariants.size()) {
+		bucket.push_back(distinct_index);
+		distinct_invariants.push_back(invariant);
+	} else {
+		distinct_fragments.pop_back();
+	}
+	fragment_to_distinct.push_back(distinct_index);
+	return fragment_to_distinct.size() - 1;
+}
+
+
+void FragmentExportBatch::Export() {
+	for (std::size_t i = 0; i < convs.size(); ++i) {
+		ExportConversion(i);
+	}
+}
+
+
+void FragmentExportBatch::ExportConversion(std::size_t conv_index) {
+	std::vector<std::string> &outputs = conv_outputs[conv_index];
+	std::vector<OBConversion*> conv(1, convs[conv_index]);
+	for (std::size_t i = outputs.size(); i < distinct_fragments.size(); ++i) {
+		outputs.push_back(writeNormalizedMol(&distinct_fragments[i].mol_copy, conv)[0]);
+	}
+}
+
+
+void FragmentExportBatch::Clear() {
+	distinct_fragments.clear();
+	distinct_invariants.clear();
+	buckets.clear();
+	fragment_to_distinct.clear();
+	conv_outputs.assign(convs.size(), std::vector<std::string>());
+}
+
+
+std::vector<std::string> FragmentExportBatch::GetOutputs(std::size_t fragment_index) {
+	std::vector<std::string> outputs;
+	for (std::size_t i = 0; i < convs.size(); ++i) {
+		outputs.push_back(GetOutput(fragment_index, i));
+	}
+	return outputs;
+}
+
+
+std::string FragmentExportBatch::GetOutput(std::size_t fragment_index, std::size_t conv_index) {
+	if (fragment_index >= fragment_to_distinct.size() || conv_index >= convs.size()) {
+		obErrorLog.ThrowError(__FUNCTION__, "Fragment or conversion index out of range", obError);
+		return "";
+	}
+	ExportConversion(conv_index);
+	return conv_outputs[conv_index][fragment_to_distinct[fragment_index]];
+}
+
+
 std::set<std::string> getUniqueErrors(const std::string lines_of_errors) {
 	// Extract unique blocks from a string of errors
 
@@ -156,7 +362,7 @@ void Deconstructor::InitOutputFormat() {
 
 
 
-std::string Deconstructor::GetBasicSMILES(OBMol fragment) {
+std::string Deconstructor::GetBasicSMILES(const OBMol &fragment) {
 	// Get a standard, canonical SMILEs from an OBMol, e.g. to check for common fragments
 	OBConversion basic_conv;
 	basic_conv.SetOutFormat("can");  // Open Babel canonical SMILES
@@ -186,7 +392,10 @@ void Deconstructor::DetectInitialNodesAndLinkers() {
 	for (std::vector<OBMol>::iterator it = fragments.begin(); it != fragments.end(); ++it) {
 		std::string mol_smiles = GetBasicSMILES(*it);
 		VirtualMol fragment_act_atoms(parent_molp);
-		fragment_act_atoms.ImportCopiedFragment(&*it);
+		{
+			StageTimer timer("ImportCopiedFragment", "deconstruction");  // atomInOtherMol lookups, linear in the MOF size per atom
+			fragment_act_atoms.ImportCopiedFragment(&*it);
+		}
 		VirtualMol fragment_pa = simplified_net.OrigToPseudo(fragment_act_atoms);;
 
 		// If str comparisons are required, include a "\t\n" in the proposed smiles
@@ -326,51 +535,92 @@ bool Deconstructor::CollapseNodes() {
 void Deconstructor::SimplifyTopology() {
 	// Simplify the topological net (series of steps including AxB, 1-c, etc.)
 
-	int simplifications = 0;
-	do {
-		simplifications = 0;
-		simplifications += simplified_net.SimplifyAxB();  // replacement for simplifyLX
+	// Instead of rescanning the full net until self-consistent, keep a worklist of "dirty" PA's
+	// whose valence (or a neighbor's valence) changed.  Each round visits its sites in the same
+	// (pointer) order as a full pass would, so the same fixed point is reached, but the total
+	// work scales with the number of changes instead of the number of passes times the net size.
+	AtomSet axb_sites = simplified_net.GetAtoms(false).GetAtoms();
+	AtomSet to_check = axb_sites;
+	while (!axb_sites.empty() || !to_check.empty()) {
+		countStat("simplification_passes");
+		// Only sites with a newly formed connection can have new redundant AxB connections
+		AtomSet axb_modified;
+		simplified_net.SimplifyAxB(axb_sites, &axb_modified);  // replacement for simplifyLX
 		// collapseXX is no longer necessary now that we're properly tracking connections
+		for (AtomSet::iterator it=axb_modified.begin(); it!=axb_modified.end(); ++it) {
+			MarkSimplifiedNbors(*it, NULL, &to_check, &to_check);
+		}
+		axb_sites = axb_modified;
 
 		// Handle one-connected species, notably bound solvents and metal-containing ligands.
 		// TODO: check the composition of free solvents and consider connecting charged anions back to the node
-		AtomSet net_1c_without_conn = simplified_net.GetAtoms(false).GetAtoms();
-		for (AtomSet::iterator it=net_1c_without_conn.begin(); it!=net_1c_without_conn.end(); ++it) {
+		AtomSet next_check;
+		while (!to_check.empty()) {
+			PseudoAtom curr = *to_check.begin();
+			to_check.erase(to_check.begin());
+
 			// Unlike the earlier algorithm, we can use the raw valence of the test point
 			// because the SimplifyAxB method takes care of duplicate connections
-			if ((*it)->GetExplicitDegree() == 1) {
+			if (curr->GetExplicitDegree() == 1) {
 				// Find the neighbor of the 1-coordinated PA.
 				// .begin() returns the first (in this case, only) element in the internal->external map.
-				PseudoAtom it_conn = VirtualMol(*it).GetExternalBondsOrConns().begin()->second;
-				VirtualMol it_and_conn = VirtualMol(*it);
+				PseudoAtom it_conn = VirtualMol(curr).GetExternalBondsOrConns().begin()->second;
+				VirtualMol it_and_conn = VirtualMol(curr);
 				it_and_conn.AddAtom(it_conn);
 				PseudoAtom nbor_of_1c = it_and_conn.GetExternalBondsOrConns().begin()->second;
 
-				if (simplified_net.AtomHasRole(*it, "node")) {
+				if (simplified_net.AtomHasRole(curr, "node")) {
 					if (nbor_of_1c->GetExplicitDegree() == 1) {
 						obErrorLog.ThrowError(__FUNCTION__, "Not collapsing 1-c node into a 1-c linker", obInfo);
 					} else {
-						simplified_net.MergeAtomToAnother(*it, nbor_of_1c);
-						++simplifications;
+						simplified_net.MergeAtomToAnother(curr, nbor_of_1c);
+						ForgetSimplifiedAtom(curr, &axb_sites, &next_check);
+						MarkSimplifiedNbors(nbor_of_1c, curr, &to_check, &next_check);
 					}
-				} else if (simplified_net.AtomHasRole(*it, "node bridge")) {
+				} else if (simplified_net.AtomHasRole(curr, "node bridge")) {
 					// probably not uncommon due to PBC and unique OBAtoms
 					continue;
-				} else if (simplified_net.AtomHasRole(*it, "linker")) {
+				} else if (simplified_net.AtomHasRole(curr, "linker")) {
 					// Bound ligands, such as capping agents or bound solvents for ASR removal.
 					// TODO: consider if there are cases when the bound ligand should not be removed
-					simplified_net.DeleteAtomAndConns(*it, "bound solvent");
-					++simplifications;
+					simplified_net.DeleteAtomAndConns(curr, "bound solvent");
+					ForgetSimplifiedAtom(curr, &axb_sites, &next_check);
+					MarkSimplifiedNbors(nbor_of_1c, curr, &to_check, &next_check);
 				} else {
 					obErrorLog.ThrowError(__FUNCTION__, "Unexpected atom role in the simplified net.", obWarning);
 				}
-			} else if ((*it)->GetExplicitDegree() == 0) {
+			} else if (curr->GetExplicitDegree() == 0) {
 				// Free solvents are isolated without any external connections
-				simplified_net.DeleteAtomAndConns(*it, "free solvent");
-				++simplifications;
+				simplified_net.DeleteAtomAndConns(curr, "free solvent");
+				ForgetSimplifiedAtom(curr, &axb_sites, &next_check);
 			}
 		}
-	} while(simplifications);  // repeat until self-consistent
+		to_check = next_check;
+	}  // repeat until self-consistent
+}
+
+
+void Deconstructor::MarkSimplifiedNbors(PseudoAtom changed, PseudoAtom current, AtomSet *this_pass, AtomSet *next_pass) {
+	// Adds a PA whose valence changed, plus its neighbors (whose 1-c checks depend on that valence), to the worklist.
+	// Sites after the current position in the pass are still visited in this pass, like a full rescan would.
+	// The rest wait for the next pass.  A NULL current puts everything in this_pass.
+	AtomSet dirty = simplified_net.GetNeighborPAs(changed);
+	dirty.insert(changed);
+	std::less<PseudoAtom> visited_before;
+	for (AtomSet::iterator it=dirty.begin(); it!=dirty.end(); ++it) {
+		if (current == NULL || visited_before(current, *it)) {
+			this_pass->insert(*it);
+		} else {
+			next_pass->insert(*it);
+		}
+	}
+}
+
+
+void Deconstructor::ForgetSimplifiedAtom(PseudoAtom deleted, AtomSet *axb_sites, AtomSet *next_pass) {
+	// Drop a deleted PA from the worklists, since its pointer is no longer valid
+	axb_sites->erase(deleted);
+	next_pass->erase(deleted);
 }
 
 
@@ -378,27 +628,22 @@ int Deconstructor::CheckCatenation() {
 	// Catenation: check that all interpenetrated nets contain identical components.
 	// Returns the number of identified nets
 
-	std::vector<VirtualMol> net_components = simplified_net.GetAtoms().Separate();
-	std::string base_formula = "";
-	if (net_components.size() == 0) {
+	// Compare the separate topology graphs by their size, degree sequence, and orig_mol composition,
+	// which are computed on the simplified net without copying each net into an OBMol
+	std::vector<NetInvariants> nets = simplified_net.GetNetInvariants();
+	if (nets.size() == 0) {
 		obErrorLog.ThrowError(__FUNCTION__, "No MOFs found in the simplified net.", obError);
-	} else {
-		VirtualMol orig_piece = simplified_net.PseudoToOrig(net_components[0]);
-		base_formula = orig_piece.ToOBMol(false).GetFormula();
-	}
-	// Compare separate topology graphs based on the orig_mol molecular formula
-	for (std::vector<VirtualMol>::iterator it=net_components.begin(); it!=net_components.end(); ++it) {
-		VirtualMol orig_piece = simplified_net.PseudoToOrig(*it);
-		std::string component_formula = orig_piece.ToOBMol(false).GetFormula();
-		if (component_formula != base_formula) {
+	}
+	for (std::vector<NetInvariants>::iterator it=nets.begin(); it!=nets.end(); ++it) {
+		if (*it != nets[0]) {
 			std::string err_msg =
 				"Inconsistency in catenated nets.  Simplified net fragment with formula\n" +
-				component_formula + " does not match first entry " + base_formula;
+				it->ToString() + " does not match first entry " + nets[0].ToString();
 			obErrorLog.ThrowError(__FUNCTION__, err_msg, obWarning);
 		}
 	}
 
-	return net_components.size();
+	return nets.size();
 }
 
 
@@ -413,14 +658,60 @@ std::string Deconstructor::GetCatenationInfo(int num_nets) {
 void Deconstructor::SimplifyMOF(bool write_intermediate_cifs) {
 	// Runs a MOF simplfication, optionally writing intermediate CIFs
 
-	if (write_intermediate_cifs) { WriteSimplifiedNet("test_simplified_orig.cif"); }
-	DetectInitialNodesAndLinkers();
-	CollapseLinkers();
-	if (write_intermediate_cifs) { WriteSimplifiedNet("test_partial.cif"); }
-	infinite_node_detected = CollapseNodes();
-	if (write_intermediate_cifs) { WriteSimplifiedNet("test_with_simplified_nodes.cif"); }
-	SimplifyTopology();
-	PostSimplification();
+	if (write_intermediate_cifs) { StageTimer timer("WriteIntermediateCIFs", "io"); WriteSimplifiedNet("test_simplified_orig.cif"); }
+	RunSimplificationStage(DETECT_NODES_AND_LINKERS);
+	RunSimplificationStage(COLLAPSE_LINKERS);
+	if (write_intermediate_cifs) { StageTimer timer("WriteIntermediateCIFs", "io"); WriteSimplifiedNet("test_partial.cif"); }
+	RunSimplificationStage(COLLAPSE_NODES);
+	if (write_intermediate_cifs) { StageTimer timer("WriteIntermediateCIFs", "io"); WriteSimplifiedNet("test_with_simplified_nodes.cif"); }
+	RunSimplificationStage(SIMPLIFY_TOPOLOGY);
+
+	if (RunStats::Current()) {
+		RunStats::Current()->SetCount("pseudo_atoms", simplified_net.GetAtoms(false).NumAtoms());
+		RunStats::Current()->SetCount("connections", simplified_net.GetConnectors().NumAtoms());
+	}
+}
+
+
+void Deconstructor::RunSimplificationStage(SimplificationStage stage) {
+	// Each simplification step deletes many PA's, so defer the OBMol renumbering until
+	// the end of the step (i.e. before writing the intermediate CIFs).
+	// Timed under the stage names for sbu --stats, with PostSimplification reported separately.
+	switch (stage) {
+	case DETECT_NODES_AND_LINKERS: {
+		StageTimer timer("DetectInitialNodesAndLinkers", "deconstruction");
+		DetectInitialNodesAndLinkers();
+		break;
+	}
+	case COLLAPSE_LINKERS: {
+		StageTimer timer("CollapseLinkers", "deconstruction");
+		simplified_net.BeginBulkEdit();
+		CollapseLinkers();
+		simplified_net.EndBulkEdit();
+		break;
+	}
+	case COLLAPSE_NODES: {
+		StageTimer timer("CollapseNodes", "deconstruction");
+		simplified_net.BeginBulkEdit();
+		infinite_node_detected = CollapseNodes();
+		simplified_net.EndBulkEdit();
+		break;
+	}
+	case SIMPLIFY_TOPOLOGY:
+		simplified_net.BeginBulkEdit();
+		{
+			StageTimer timer("SimplifyTopology", "deconstruction");
+			SimplifyTopology();
+		}
+		{
+			StageTimer timer("PostSimplification", "deconstruction");
+			PostSimplification();
+			simplified_net.EndBulkEdit();
+		}
+		break;
+	default:
+		obErrorLog.ThrowError(__FUNCTION__, "Unknown simplification stage", obError);
+	}
 }
 
 
@@ -431,7 +722,7 @@ void Deconstructor::SetOutputDir(const std::string &path) {
 
 void Deconstructor::WriteCIFs() {
 	// Write out accessory files: the decomposed and simplified MOF, including bond orders.
-	// Also write the Systre topology file.
+	// The Systre topology file is written separately by WriteTopology.
 
 	WriteAtomsOfRole("node", "nodes.cif");
 	WriteAtomsOfRole("linker", "linkers.cif");
@@ -449,6 +740,10 @@ void Deconstructor::WriteCIFs() {
 
 	// Export the simplified net
 	simplified_net.ToSimplifiedCIF(GetOutputPath("simplified_topology_with_two_conn.cif"));
+}
+
+
+void Deconstructor::WriteTopology() {
 	simplified_net.WriteSystre(GetOutputPath("topology.cgd"));
 }
 
@@ -462,21 +757,18 @@ std::string Deconstructor::GetMOFInfo() {
 	VirtualMol node_export = simplified_net.GetAtomsOfRole("node");
 	// Handle node and node_bridge separately to match old test SMILES
 	node_export = simplified_net.PseudoToOrig(node_export);
-	OBMol node_mol = node_export.ToOBMol();
 	analysis << "# Nodes:" << std::endl;
-	analysis << writeFragments(node_mol.Separate(), obconv, export_single_bonds);
+	analysis << writeFragments(node_export, obconv, export_single_bonds);
 
 	VirtualMol node_bridge_export = simplified_net.GetAtomsOfRole("node bridge");
 	node_bridge_export = simplified_net.PseudoToOrig(node_bridge_export);
-	OBMol node_bridge_mol = node_bridge_export.ToOBMol();
 	// Considered as part of the nodes for purposes of python_smiles_parts.txt, so no subheader
-	analysis << writeFragments(node_bridge_mol.Separate(), obconv, export_single_bonds);
+	analysis << writeFragments(node_bridge_export, obconv, export_single_bonds);
 
 	VirtualMol linker_export = simplified_net.GetAtomsOfRole("linker");
 	linker_export = simplified_net.PseudoToOrig(linker_export);
-	OBMol linker_mol = linker_export.ToOBMol();
 	analysis << "# Linkers:" << std::endl;
-	analysis << writeFragments(linker_mol.Separate(), obconv, !export_single_bonds);
+	analysis << writeFragments(linker_export, obconv, !export_single_bonds);
 
 	analysis << "# " << GetCatenationInfo(CheckCatenation());
 	return analysis.str();
@@ -510,12 +802,16 @@ void Deconstructor::WriteAtomsOfRole(const std::string &simplified_role, const s
 
 
 
-MetalOxoDeconstructor::MetalOxoDeconstructor(OBMol* orig_mof) : Deconstructor(orig_mof) {
+MetalOxoDeconstructor::MetalOxoDeconstructor(OBMol* orig_mof) : Deconstructor(orig_mof),
+	linker_batch({&inchi_conv, &inchikey_conv, &obconv}), skeleton_batch({&obconv}, true) {
 	// Note: MetalOxoDeconstructor would call the default constructor for Deconstructor,
 	// not Deconstructor(orig_mof) unless specified above.
 	// See also https://www.learncpp.com/cpp-tutorial/114-constructors-and-initialization-of-derived-classes/
 
-	// Could initialize MetalOxoDeconstructor variables, etc., here
+	linker_ids_ready = false;
+	linker_ids_per_fragment = false;
+	InitInChIConversion(&inchi_conv, "inchi");
+	InitInChIConversion(&inchikey_conv, "inchikey");
 }
 
 
@@ -523,6 +819,7 @@ void MetalOxoDeconstructor::PostSimplification() {
 	// Split 4-coordinated linkers into 3+3 by convention for MIL-47, etc.
 	// This code was only necessary in the original MOFid deconstruction algorithm and will
 	// be automatically handled in the single/all-node deconstruction algorithms.
+	linker_ids_ready = false;  // the linkers are about to be finalized
 	if (infinite_node_detected) {
 		AtomSet for_net_4c = simplified_net.GetAtoms(false).GetAtoms();
 		for (AtomSet::iterator it_4c=for_net_4c.begin(); it_4c!=for_net_4c.end(); ++it_4c) {
@@ -539,30 +836,42 @@ std::vector<std::string> MetalOxoDeconstructor::PAsToUniqueInChIs(VirtualMol pa,
 	// Convert PsuedoAtoms in the simplified net to their unique InChI(key) values
 	// This code will strip the protonation state off of the InChIKey
 
-	std::vector<std::string> unique_inchi;
-	std::string conv_format;
-	bool truncate_inchikey = false;
-	if (format == "truncated inchikey") {
-		conv_format = "inchikey";
-		truncate_inchikey = true;
-	} else if (format == "inchi" || format == "inchikey") {
-		conv_format = format;
-	} else {
+	std::string conv_format = (format == "truncated inchikey") ? "inchikey" : format;
+	if (conv_format != "inchi" && conv_format != "inchikey") {
 		obErrorLog.ThrowError(__FUNCTION__, "Unexpected format flag", obError);
-		return unique_inchi;
+		return std::vector<std::string>();
 	}
 
 	OBConversion conv;
-	conv.SetOutFormat(conv_format.c_str());
-	conv.AddOption("X", OBConversion::OUTOPTIONS, "SNon");  // ignoring stereochemistry, at least for now
-	conv.AddOption("w");  // reduce verbosity about InChI behavior:
+	InitInChIConversion(&conv, conv_format);
+
+	std::vector<std::string> raw_inchis;
+	std::vector<VirtualMol> fragments = simplified_net.PseudoToOrig(pa).Separate();
+	for (std::vector<VirtualMol>::iterator frag=fragments.begin(); frag!=fragments.end(); ++frag) {
+		raw_inchis.push_back(exportNormalizedMol(*frag, conv));
+	}
+	countStat("fragments", fragments.size());
+	return FormatUniqueInChIs(raw_inchis, format);
+}
+
+
+void MetalOxoDeconstructor::InitInChIConversion(OBConversion *conv, const std::string &conv_format) {
+	conv->SetOutFormat(conv_format.c_str());
+	conv->AddOption("X", OBConversion::OUTOPTIONS, "SNon");  // ignoring stereochemistry, at least for now
+	conv->AddOption("w");  // reduce verbosity about InChI behavior:
 	// 'Omitted undefined stereo', 'Charges were rearranged', 'Proton(s) added/removed', 'Metal was disconnected'
 	// See https://openbabel.org/docs/dev/FileFormats/InChI_format.html for more information.
+}
 
-	OBMol pa_mol = simplified_net.PseudoToOrig(pa).ToOBMol();
-	std::vector<OBMol> fragments = pa_mol.Separate();
-	for (std::vector<OBMol>::iterator frag=fragments.begin(); frag!=fragments.end(); ++frag) {
-		std::string frag_inchi = exportNormalizedMol(*frag, conv);
+
+std::vector<std::string> MetalOxoDeconstructor::FormatUniqueInChIs(const std::vector<std::string> &raw_inchis, const std::string &format) {
+	// Validates and trims raw InChI(key) exports, returning the unique values sorted alphabetically
+	std::vector<std::string> unique_inchi;
+	bool truncate_inchikey = (format == "truncated inchikey");
+	std::string conv_format = truncate_inchikey ? "inchikey" : format;
+
+	for (std::vector<std::string>::const_iterator raw=raw_inchis.begin(); raw!=raw_inchis.end(); ++raw) {
+		std::string frag_inchi = *raw;
 		const std::string ob_newline = "\n";
 		if (conv_format == "inchikey") {
 			if (frag_inchi.length() != (27 + ob_newline.size())) {  // 14 + 1 + 10 + 1 + 1 + \n
@@ -590,6 +899,72 @@ std::vector<std::string> MetalOxoDeconstructor::PAsToUniqueInChIs(VirtualMol pa,
 }
 
 
+void MetalOxoDeconstructor::CalculateLinkerIdentifiers() {
+	// Normalizes each linker fragment once, deferring the exports to GetLinkerIdentifier
+	if (linker_ids_ready) {
+		return;
+	}
+	linker_ids.clear();
+	linker_fragments.clear();
+	linker_batch.Clear();
+	skeleton_batch.Clear();
+
+	// Batch the linker fragments, so repeated linkers in the unit cell only go through libinchi once
+	VirtualMol linker_export = simplified_net.GetAtomsOfRole("linker");
+	AtomSet linker_set = linker_export.GetAtoms();
+	for (AtomSet::iterator pa=linker_set.begin(); pa!=linker_set.end(); ++pa) {
+		std::vector<VirtualMol> fragments = simplified_net.PseudoToOrig(VirtualMol(*pa)).Separate();
+		for (std::vector<VirtualMol>::iterator frag=fragments.begin(); frag!=fragments.end(); ++frag) {
+			linker_ids[*pa].push_back(linker_batch.AddFragment(*frag));
+			linker_fragments.push_back(*frag);
+		}
+	}
+	countStat("fragments", linker_fragments.size());
+	countStat("distinct_fragments", linker_batch.NumDistinct());
+
+	// Bonded linker PAs would merge into a single fragment when exported together
+	std::size_t num_combined_fragments = simplified_net.PseudoToOrig(linker_export).Separate().size();
+	linker_ids_per_fragment = (num_combined_fragments == linker_fragments.size());
+	linker_ids_ready = true;
+}
+
+
+std::string MetalOxoDeconstructor::GetLinkerIdentifier(std::size_t fragment_index, LinkerIdentifier id) {
+	// Exports one identifier of a linker fragment from CalculateLinkerIdentifiers, on first request
+	CalculateLinkerIdentifiers();
+	if (id != LINKER_SKELETON_SMILES) {
+		return linker_batch.GetOutput(fragment_index, id);
+	}
+	// The skeleton SMILES needs a separate normalization, since its bond orders are reset
+	for (std::size_t i = skeleton_batch.NumFragments(); i < linker_fragments.size(); ++i) {
+		skeleton_batch.AddFragment(linker_fragments[i]);  // same insertion order, so same indices
+	}
+	return skeleton_batch.GetOutput(fragment_index, 0);
+}
+
+
+std::vector<std::string> MetalOxoDeconstructor::LinkerIdentifiersToUniqueInChIs(VirtualMol pa, const std::string &format) {
+	// Memoized equivalent of PAsToUniqueInChIs for linker PAs
+	CalculateLinkerIdentifiers();
+	if (!linker_ids_per_fragment && pa.NumAtoms() > 1) {
+		return PAsToUniqueInChIs(pa, format);
+	}
+
+	std::vector<std::string> raw_inchis;
+	AtomSet pa_set = pa.GetAtoms();
+	for (AtomSet::iterator it=pa_set.begin(); it!=pa_set.end(); ++it) {
+		if (linker_ids.find(*it) == linker_ids.end()) {
+			return PAsToUniqueInChIs(pa, format);  // not a linker
+		}
+		std::vector<std::size_t> &pa_ids = linker_ids[*it];
+		for (std::vector<std::size_t>::iterator idx=pa_ids.begin(); idx!=pa_ids.end(); ++idx) {
+			raw_inchis.push_back(GetLinkerIdentifier(*idx, (format == "inchi") ? LINKER_INCHI : LINKER_INCHIKEY));
+		}
+	}
+	return FormatUniqueInChIs(raw_inchis, format);
+}
+
+
 std::string MetalOxoDeconstructor::GetMOFkey(const std::string &topology) {
 	// Print out the detected MOFkey, optionally with the topology field.
 	// This method is implemented in MetalOxoDeconstructor instead of the others, because the
@@ -624,7 +999,7 @@ std::string MetalOxoDeconstructor::GetMOFkey(const std::string &topology) {
 
 	// Then, write unique truncated InChIKeys (sans unnecessary layers)
 	VirtualMol linker_export = simplified_net.GetAtomsOfRole("linker");
-	std::vector<std::string> unique_ikeys = PAsToUniqueInChIs(linker_export, "truncated inchikey");
+	std::vector<std::string> unique_ikeys = LinkerIdentifiersToUniqueInChIs(linker_export, "truncated inchikey");
 	if (unique_ikeys.size() == 0) {
 		unique_ikeys.push_back(MOFKEY_NO_LINKERS);
 	}
@@ -646,7 +1021,7 @@ std::string MetalOxoDeconstructor::GetLinkerInChIs() {
 	// Get unique, sorted InChI's for linkers in a MOF, delimited by newlines
 	std::stringstream inchis;
 	VirtualMol linker_export = simplified_net.GetAtomsOfRole("linker");
-	std::vector<std::string> unique_inchis = PAsToUniqueInChIs(linker_export, "inchi");
+	std::vector<std::string> unique_inchis = LinkerIdentifiersToUniqueInChIs(linker_export, "inchi");
 	for (std::vector<std::string>::iterator it=unique_inchis.begin(); it!=unique_inchis.end(); ++it) {
 		inchis << *it;  // don't need a std::endl, because Open Babel adds it by default to the export
 	}
@@ -671,7 +1046,7 @@ std::string MetalOxoDeconstructor::GetLinkerStats(std::string sep) {
 	AtomSet linker_set = linker_export.GetAtoms();
 	for (AtomSet::iterator pa=linker_set.begin(); pa!=linker_set.end(); ++pa) {
 		VirtualMol pa_vmol = VirtualMol(*pa);
-		std::vector<std::string> pa_ikey_list = PAsToUniqueInChIs(pa_vmol, "inchikey");
+		std::vector<std::string> pa_ikey_list = LinkerIdentifiersToUniqueInChIs(pa_vmol, "inchikey");
 		if (pa_ikey_list.size() != 1) {
 			obErrorLog.ThrowError(__FUNCTION__, "Failed to calculate an InChIkey!", obWarning);
 			continue;  // not updating the stats for this particular PA
@@ -685,12 +1060,27 @@ std::string MetalOxoDeconstructor::GetLinkerStats(std::string sep) {
 			ikey_to_uc_count[pa_ikey] = 1;
 		}
 
-		ikey_to_inchi[pa_ikey] = rtrimWhiteSpace(PAsToUniqueInChIs(pa_vmol, "inchi")[0]);
-		ikey_to_truncated[pa_ikey] = rtrimWhiteSpace(PAsToUniqueInChIs(pa_vmol, "truncated inchikey")[0]);
-		OBMol orig_linker = simplified_net.PseudoToOrig(pa_vmol).ToOBMol();
-		const bool skeleton_flag = true;
-		ikey_to_smiles[pa_ikey] = rtrimWhiteSpace(getSMILES(orig_linker, obconv, !skeleton_flag));
-		ikey_to_smiles_skeleton[pa_ikey] = rtrimWhiteSpace(getSMILES(orig_linker, obconv, skeleton_flag));
+		ikey_to_inchi[pa_ikey] = rtrimWhiteSpace(LinkerIdentifiersToUniqueInChIs(pa_vmol, "inchi")[0]);
+		ikey_to_truncated[pa_ikey] = rtrimWhiteSpace(LinkerIdentifiersToUniqueInChIs(pa_vmol, "truncated inchikey")[0]);
+		std::vector<std::size_t> &pa_ids = linker_ids[*pa];
+		std::string pa_smiles;
+		std::string pa_skeleton;
+		if (pa_ids.size() == 1) {
+			pa_smiles = rtrimWhiteSpace(GetLinkerIdentifier(pa_ids[0], LINKER_SMILES));
+			pa_skeleton = rtrimWhiteSpace(GetLinkerIdentifier(pa_ids[0], LINKER_SKELETON_SMILES));
+		} else {  // a disconnected PA is exported as a single, dot-separated SMILES
+			VirtualMol orig_linker = simplified_net.PseudoToOrig(pa_vmol);
+			const bool skeleton_flag = true;
+			pa_smiles = rtrimWhiteSpace(getSMILES(orig_linker, obconv, !skeleton_flag));
+			pa_skeleton = rtrimWhiteSpace(getSMILES(orig_linker, obconv, skeleton_flag));
+		}
+		// Linkers with the same InChIKey may still differ in SMILES (e.g. where radicals are placed).
+		// Report the first SMILES alphabetically, since the PA order depends on pointer values.
+		if (ikey_to_smiles.find(pa_ikey) == ikey_to_smiles.end() || pa_smiles < ikey_to_smiles[pa_ikey]
+				|| (pa_smiles == ikey_to_smiles[pa_ikey] && pa_skeleton < ikey_to_smiles_skeleton[pa_ikey])) {
+			ikey_to_smiles[pa_ikey] = pa_smiles;
+			ikey_to_smiles_skeleton[pa_ikey] = pa_skeleton;
+		}
 		ikey_to_conn[pa_ikey] = (*pa)->GetExplicitDegree();
 	}
 
@@ -733,26 +1123,38 @@ bool StandardIsolatedDeconstructor::CollapseNodes() {
 
 void StandardIsolatedDeconstructor::SimplifyTopology() {
 	// Simplify the topological net adjacency matrix
+	// Uses the same worklist of changed PA's as the base SimplifyTopology() implementation
 
-	int simplifications = 0;
-	do {
-		simplifications = 0;
-
+	AtomSet axb_sites = simplified_net.GetAtoms(false).GetAtoms();
+	AtomSet to_check = axb_sites;
+	while (!axb_sites.empty() || !to_check.empty()) {
 		// Check for duplicate connector sites, like the base SimplifyTopology() implementation
-		simplifications += simplified_net.SimplifyAxB();
+		AtomSet axb_modified;
+		simplified_net.SimplifyAxB(axb_sites, &axb_modified);
+		for (AtomSet::iterator it=axb_modified.begin(); it!=axb_modified.end(); ++it) {
+			MarkSimplifiedNbors(*it, NULL, &to_check, &to_check);
+		}
+		axb_sites = axb_modified;
 
 		// Simplify the adjacency matrix by outright deleting 0-c and 1-c sites
-		AtomSet base_pas = simplified_net.GetAtoms(false).GetAtoms();
-		for (AtomSet::iterator it=base_pas.begin(); it!=base_pas.end(); ++it) {
-			if ((*it)->GetExplicitDegree() == 1) {
-				simplified_net.DeleteAtomAndConns(*it, "deleted 1-c site");
-				++simplifications;
-			} else if ((*it)->GetExplicitDegree() == 0) {
-				simplified_net.DeleteAtomAndConns(*it, "deleted 0-c site");
-				++simplifications;
+		AtomSet next_check;
+		while (!to_check.empty()) {
+			PseudoAtom curr = *to_check.begin();
+			to_check.erase(to_check.begin());
+			if (curr->GetExplicitDegree() == 1) {
+				AtomSet nbors = simplified_net.GetNeighborPAs(curr);
+				simplified_net.DeleteAtomAndConns(curr, "deleted 1-c site");
+				ForgetSimplifiedAtom(curr, &axb_sites, &next_check);
+				for (AtomSet::iterator it=nbors.begin(); it!=nbors.end(); ++it) {
+					MarkSimplifiedNbors(*it, curr, &to_check, &next_check);
+				}
+			} else if (curr->GetExplicitDegree() == 0) {
+				simplified_net.DeleteAtomAndConns(curr, "deleted 0-c site");
+				ForgetSimplifiedAtom(curr, &axb_sites, &next_check);
 			}
 		}
-	} while(simplifications);  // repeat until self-consistent
+		to_check = next_check;
+	}  // repeat until self-consistent
 }
 
 
@@ -1195,7 +1597,7 @@ void AllNodeDeconstructor::CollapseLinkers() {
 		// To avoid those issues, remove the connectors now.  CollapseFragment and related methods in the Topology class
 		// are smart enough to grab the correct, fully updated pointers for the ConnectionTable class.
 		// The case of a connector-only PA will be handled in the branch simplification code below.
-		for (std::map<PseudoAtom,VirtualMol>::iterator it=frag_all_node.copy_pa_to_multiple.begin(); it!=frag_all_node.copy_pa_to_multiple.end(); ++it) {
+		for (ScratchMap<PseudoAtom,VirtualMol>::iterator it=frag_all_node.copy_pa_to_multiple.begin(); it!=frag_all_node.copy_pa_to_multiple.end(); ++it) {
 			if (it->second.NumAtoms() == 0) {
 				obErrorLog.ThrowError(__FUNCTION__, "Found empty fragment before connection removal", obWarning);
 			}
@@ -1394,33 +1796,70 @@ void AllNodeDeconstructor::TreeDecomposition(MappedMol *fragment_to_simplify, Vi
 
 
 	// Start simplifying the fragment
-	// First, iteratively collapse 1-c until self-consistent
+	// First, iteratively collapse 1-c until self-consistent.  Strip leaves in rounds from a queue, tracking
+	// the remaining degree of each PA instead of rescanning the fragment, and delete the PA's at the end.
 	int simplifications = 0;
-	do {
-		simplifications = 0;
-		ConnIntToExt pa_to_1c;
-		FOR_ATOMS_OF_MOL(a, *frag_molp) {
-			if (a->GetExplicitDegree() == 1 && a->GetAtomicNum() != TREE_EXT_CONN && a->GetAtomicNum() != TREE_BRANCH_POINT) {
-				FOR_NBORS_OF_ATOM(nbor, *a) {  // get the 1 neighbor (inner to fragment)
-					pa_to_1c.insert(AtomPair(&*nbor, &*a));
+	int num_frag_atoms = frag_molp->NumAtoms();
+	std::vector<int> degree(num_frag_atoms, 0);  // indexed by GetIdx()-1, which is stable until the bulk delete
+	std::vector<bool> is_pruned(num_frag_atoms, false);
+	std::vector<PseudoAtom> absorbed_by(num_frag_atoms, NULL);
+	std::vector<PseudoAtom> prune_order;
+	std::queue<PseudoAtom> leaves;
+	FOR_ATOMS_OF_MOL(a, *frag_molp) {
+		degree[a->GetIdx() - 1] = a->GetExplicitDegree();
+		if (a->GetExplicitDegree() == 1 && a->GetAtomicNum() != TREE_EXT_CONN && a->GetAtomicNum() != TREE_BRANCH_POINT) {
+			leaves.push(&*a);
+		}
+	}
+	while (!leaves.empty()) {
+		// Each round only removes the leaves present at its start, like the original rescan of the fragment
+		std::vector<PseudoAtom> round_leaves;
+		while (!leaves.empty()) {
+			round_leaves.push_back(leaves.front());
+			leaves.pop();
+		}
+		std::vector<std::pair<PseudoAtom, PseudoAtom> > round_merges;  // (pa_1c, pa_kept)
+		for (std::vector<PseudoAtom>::iterator it=round_leaves.begin(); it!=round_leaves.end(); ++it) {
+			FOR_NBORS_OF_ATOM(nbor, *it) {  // get the 1 remaining neighbor (inner to fragment)
+				if (!is_pruned[nbor->GetIdx() - 1]) {
+					round_merges.push_back(std::make_pair(*it, &*nbor));
+					break;
 				}
 			}
 		}
-
-		// Apply changes to the fragment
-		for (ConnIntToExt::iterator it=pa_to_1c.begin(); it!=pa_to_1c.end(); ++it) {
-			PseudoAtom pa_kept = it->first;
-			PseudoAtom pa_1c = it->second;
-
-			VirtualMol kept_vmol = frag_map->copy_pa_to_multiple[pa_kept];
-			kept_vmol.AddVirtualMol(frag_map->copy_pa_to_multiple[pa_1c]);
-			frag_map->copy_pa_to_multiple[pa_kept] = kept_vmol;
-			frag_map->copy_pa_to_multiple.erase(pa_1c);
-
-			frag_molp->DeleteAtom(pa_1c);
+		for (std::vector<std::pair<PseudoAtom, PseudoAtom> >::iterator it=round_merges.begin(); it!=round_merges.end(); ++it) {
+			PseudoAtom pa_1c = it->first;
+			PseudoAtom pa_kept = it->second;
+			if (is_pruned[pa_kept->GetIdx() - 1]) {
+				continue;  // an isolated pair of 1-c PA's: keep the PA that absorbed the other one
+			}
+			is_pruned[pa_1c->GetIdx() - 1] = true;
+			absorbed_by[pa_1c->GetIdx() - 1] = pa_kept;
+			prune_order.push_back(pa_1c);
+			--degree[pa_1c->GetIdx() - 1];
+			--degree[pa_kept->GetIdx() - 1];
+			if (degree[pa_kept->GetIdx() - 1] == 1 && pa_kept->GetAtomicNum() != TREE_EXT_CONN && pa_kept->GetAtomicNum() != TREE_BRANCH_POINT) {
+				leaves.push(pa_kept);
+			}
 			++simplifications;
 		}
-	} while (simplifications);
+	}
+
+	// Merge the origin atoms of each pruned branch into the PA that survives.  A PA is always absorbed
+	// before the PA which absorbed it, so walking the removals backwards resolves chains in one pass.
+	std::vector<PseudoAtom> survivor(num_frag_atoms, NULL);
+	for (std::vector<PseudoAtom>::reverse_iterator it=prune_order.rbegin(); it!=prune_order.rend(); ++it) {
+		PseudoAtom pa_kept = absorbed_by[(*it)->GetIdx() - 1];
+		if (is_pruned[pa_kept->GetIdx() - 1]) {
+			pa_kept = survivor[pa_kept->GetIdx() - 1];
+		}
+		survivor[(*it)->GetIdx() - 1] = pa_kept;
+		frag_map->copy_pa_to_multiple[pa_kept].AddVirtualMol(frag_map->copy_pa_to_multiple[*it]);
+		frag_map->copy_pa_to_multiple.erase(*it);
+	}
+	if (simplifications) {
+		frag_molp->DeleteAtoms(prune_order);
+	}
 	if (DEBUG_WITH_CIFS) {writeCIF(frag_molp, GetOutputPath("debug_tree_4_simplify_1c.cif")); }
 
 
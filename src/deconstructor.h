@@ -5,8 +5,11 @@ deconstructor.h - Deconstruct a MOF into its building blocks and simplified net
 #ifndef DECONSTRUCTOR_H
 #define DECONSTRUCTOR_H
 
+#include <deque>
+#include <map>
 #include <string>
 #include <utility>  // std::pair
+#include <vector>
 
 #include <openbabel/babelconfig.h>
 #include <openbabel/generic.h>
@@ -14,6 +17,7 @@ deconstructor.h - Deconstruct a MOF into its building blocks and simplified net
 #include <openbabel/mol.h>
 #include <openbabel/atom.h>
 
+#include "fragment_hash.h"
 #include "topology.h"
 
 namespace OpenBabel
@@ -48,14 +52,65 @@ const int TREE_INT_BRANCH = 117;  // Ts
 const int TREE_BRANCH_POINT = 116;  // Lv
 const int TREE_EXT_CONN = 115;  // Mc
 
+// Steps of Deconstructor::SimplifyMOF, in order
+enum SimplificationStage {
+	DETECT_NODES_AND_LINKERS,
+	COLLAPSE_LINKERS,
+	COLLAPSE_NODES,
+	SIMPLIFY_TOPOLOGY,  // including PostSimplification
+	NUM_SIMPLIFICATION_STAGES
+};
+const std::string SIMPLIFICATION_STAGE_NAMES[] = {"DetectInitialNodesAndLinkers", "CollapseLinkers", "CollapseNodes", "SimplifyTopology"};
+
 
 // Function prototypes
-std::string writeFragments(std::vector<OBMol> fragments, OBConversion obconv, bool only_single_bonds=false);
-std::string exportNormalizedMol(OBMol fragment, OBConversion obconv, bool only_single_bonds=false, bool unique_errors=true);
-std::string getSMILES(OBMol fragment, OBConversion obconv, bool only_single_bonds=false);
+std::string writeFragments(const std::vector<OBMol> &fragments, OBConversion &obconv, bool only_single_bonds=false);
+std::string writeFragments(VirtualMol fragment_atoms, OBConversion &obconv, bool only_single_bonds=false);
+std::string exportNormalizedMol(const OBMol &fragment, OBConversion &obconv, bool only_single_bonds=false, bool unique_errors=true);
+std::string exportNormalizedMol(VirtualMol fragment, OBConversion &obconv, bool only_single_bonds=false, bool unique_errors=true);
+std::vector<std::string> exportNormalizedMol(VirtualMol fragment, const std::vector<OBConversion*> &convs, bool only_single_bonds=false, bool unique_errors=true);
+std::string exportNormalizedMolInPlace(OBMol *fragment, OBConversion &obconv, bool only_single_bonds=false, bool unique_errors=true);
+std::vector<std::string> exportNormalizedMolInPlace(OBMol *fragment, const std::vector<OBConversion*> &convs, bool only_single_bonds=false, bool unique_errors=true);
+void normalizeFragmentMol(OBMol *fragment, bool only_single_bonds=false, bool unique_errors=true);
+std::vector<std::string> writeNormalizedMol(OBMol *fragment, const std::vector<OBConversion*> &convs, bool unique_errors=true);
+std::string getSMILES(const OBMol &fragment, OBConversion &obconv, bool only_single_bonds=false);
+std::string getSMILES(VirtualMol fragment, OBConversion &obconv, bool only_single_bonds=false);
 std::set<std::string> getUniqueErrors(const std::string lines_of_errors);
 
 
+class FragmentExportBatch {
+// Batched front end for exporting many fragments (InChI, InChIKey, SMILES, ...) with the same conversions.
+// Each fragment is normalized when added, then deduplicated by the FragmentInvariant of its labeled graph,
+// so each distinct fragment is passed through the writers (e.g. libinchi) only once.  The distinct fragments
+// are exported serially: libinchi is not reentrant (see bLibInchiSemaphore), and the error handling in
+// normalizeFragmentMol and writeNormalizedMol goes through the global, unsynchronized obErrorLog.
+// Outputs are indexed by the order fragments were added, so results are deterministic.  Each conversion is only written on first request, so callers that need a subset of
+// the conversions (e.g. the InChIKeys for a MOFkey) skip the rest.
+private:
+	std::vector<OBConversion*> convs;
+	bool only_single_bonds;
+	std::deque<MappedMol> distinct_fragments;  // normalized copies, which are noncopyable
+	std::vector<FragmentInvariant> distinct_invariants;
+	std::map<std::string, std::vector<std::size_t> > buckets;  // invariant key to distinct indices
+	std::vector<std::size_t> fragment_to_distinct;
+	std::vector<std::vector<std::string> > conv_outputs;  // per conversion, then per distinct fragment
+
+	FragmentExportBatch(const FragmentExportBatch& other);
+	FragmentExportBatch& operator=(const FragmentExportBatch&);
+	void ExportConversion(std::size_t conv_index);
+
+public:
+	FragmentExportBatch(const std::vector<OBConversion*> &conversions, bool single_bonds = false);
+	std::size_t AddFragment(VirtualMol fragment);  // returns the index for GetOutputs
+	void Export();  // exports any distinct fragments not yet converted
+	void Clear();  // drops all fragments, keeping the conversions
+	std::size_t NumFragments() const { return fragment_to_distinct.size(); };
+	std::size_t NumDistinct() const { return distinct_fragments.size(); };
+	std::vector<std::string> GetOutputs(std::size_t fragment_index);  // one string per conversion
+	std::string GetOutput(std::size_t fragment_index, std::size_t conv_index);  // only runs that conversion
+};
+
+
 class Deconstructor {
 // Base class for MOF deconstruction algorithms, to go from an OBMol of original atoms
 // to a simplified net, its topology, and the mapping of net pseudoatoms back to the MOF.
@@ -74,15 +129,16 @@ protected:
 	VirtualMol points_of_extension;  // Placeholder to track SBU points of extension separately from atom roles
 
 	virtual void InitOutputFormat();
-	static std::string GetBasicSMILES(OBMol fragment);
+	static std::string GetBasicSMILES(const OBMol &fragment);
 
 	// Network simplification steps
 	virtual void DetectInitialNodesAndLinkers();
 	virtual void CollapseLinkers();
 	virtual bool CollapseNodes();
 	virtual void SimplifyTopology();
+	void MarkSimplifiedNbors(PseudoAtom changed, PseudoAtom current, AtomSet *this_pass, AtomSet *next_pass);
+	void ForgetSimplifiedAtom(PseudoAtom deleted, AtomSet *axb_sites, AtomSet *next_pass);
 	virtual void PostSimplification() {};
-	int CheckCatenation();
 	std::string GetCatenationInfo(int num_nets);
 
 public:
@@ -90,10 +146,14 @@ public:
 	virtual ~Deconstructor() {};
 
 	void SimplifyMOF(bool write_intermediate_cifs=true);
+	// Runs one step of SimplifyMOF, which must follow the previous stages (e.g. for benchmarks)
+	void RunSimplificationStage(SimplificationStage stage);
+	int CheckCatenation();  // number of interpenetrated nets, after SimplifyMOF
 
 	// Output CIFs and building block identity.
 	void SetOutputDir(const std::string &path);
 	virtual void WriteCIFs();
+	void WriteTopology();  // Systre topology.cgd, which is cheap compared to the CIFs
 	virtual std::string GetMOFInfo();
 
 	// Utilities
@@ -103,12 +163,32 @@ public:
 };
 
 
+// Exported identifiers for each connected linker fragment, as raw Open Babel output (with newlines)
+enum LinkerIdentifier { LINKER_INCHI, LINKER_INCHIKEY, LINKER_SMILES, LINKER_SKELETON_SMILES };
+
+
 class MetalOxoDeconstructor : public Deconstructor {
 // The original MOFid algorithm and implementation of Deconstructor (originally in sbu.cpp).
 // Converts 4-c linkers in MIL-47, etc., to 2 x 3-c.
 protected:
+	// Linker fragments, normalized once and shared by GetMOFkey, etc.  Each LinkerIdentifier is only
+	// exported on first request, so e.g. a MOFkey only needs the InChIKeys.
+	bool linker_ids_ready;
+	bool linker_ids_per_fragment;  // whether the per-PA fragments match the combined linker export
+	std::map<PseudoAtom, std::vector<std::size_t> > linker_ids;  // indices in linker_batch
+	std::vector<VirtualMol> linker_fragments;  // in linker_batch order, for the skeleton SMILES
+	OBConversion inchi_conv;
+	OBConversion inchikey_conv;
+	FragmentExportBatch linker_batch;  // LINKER_INCHI, LINKER_INCHIKEY, and LINKER_SMILES
+	FragmentExportBatch skeleton_batch;  // separately normalized with only single bonds
+
 	virtual void PostSimplification();
 	std::vector<std::string> PAsToUniqueInChIs(VirtualMol pa, const std::string &format);
+	static void InitInChIConversion(OBConversion *conv, const std::string &conv_format);
+	static std::vector<std::string> FormatUniqueInChIs(const std::vector<std::string> &raw_inchis, const std::string &format);
+	void CalculateLinkerIdentifiers();
+	std::string GetLinkerIdentifier(std::size_t fragment_index, LinkerIdentifier id);
+	std::vector<std::string> LinkerIdentifiersToUniqueInChIs(VirtualMol pa, const std::string &format);
 
 public:
 	MetalOxoDeconstructor(OBMol* orig_mof = NULL);
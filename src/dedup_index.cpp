@@ -0,0 +1,52 @@
+#include "dedup_index.h"
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace OpenBabel
+{
+
+DedupIndex::DedupIndex() {
+	num_entries = 0;
+}
+
+const DedupGroup& DedupIndex::Add(const std::string &name, const std::string &key, bool *is_new) {
+	++num_entries;
+	std::unordered_map<std::string, DedupGroup>::iterator it = groups.find(key);
+	if (it != groups.end()) {
+		++(it->second.size);
+		if (is_new) { *is_new = false; }
+		return it->second;
+	}
+
+	DedupGroup group;
+	group.id = static_cast<int>(groups.size()) + 1;
+	group.representative = name;
+	group.size = 1;
+	if (is_new) { *is_new = true; }
+	return groups.insert(std::make_pair(key, group)).first->second;
+}
+
+const DedupGroup* DedupIndex::Find(const std::string &key) const {
+	std::unordered_map<std::string, DedupGroup>::const_iterator it = groups.find(key);
+	if (it == groups.end()) {
+		return NULL;
+	}
+	return &(it->second);
+}
+
+std::string nearDuplicateKey(const std::string &key) {
+	// e.g. "Zn.KKEYFWRCBNTPAC.MOFkey-v1 cat1" or "Zn.KKEYFWRCBNTPAC.MOFkey-v1.pcu.NO_REF" to
+	// "Zn.KKEYFWRCBNTPAC.MOFkey-v1", and "[Zn][O]... MOFid-v1.pcu.cat0;IRMOF-1" to its SMILES
+	const std::string mofkey_tag = "MOFkey-v1";
+	std::string near_key = key.substr(0, key.find_first_of(" \t"));
+	std::size_t tag_pos = near_key.find(mofkey_tag);
+	if (tag_pos != std::string::npos) {
+		near_key.erase(tag_pos + mofkey_tag.size());
+	}
+	return near_key;
+}
+
+} // end namespace OpenBabel
@@ -0,0 +1,52 @@
+/**********************************************************************
+dedup_index.h - Streaming hash index of MOF identifiers for deduplication
+***********************************************************************/
+
+#ifndef DEDUP_INDEX_H
+#define DEDUP_INDEX_H
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+namespace OpenBabel
+{
+
+class DedupGroup {
+// Structures sharing an identifier (e.g. MOFkey).  The first structure seen represents the group.
+public:
+	int id;  // 1-indexed, in order of first appearance
+	std::string representative;
+	int size;
+};
+
+
+class DedupIndex {
+// Hash index from identifiers to duplicate groups.  Each structure is assigned to its group as
+// soon as it is added, so duplicates are reported in a single streaming pass, without keeping
+// anything but one entry per unique identifier.
+private:
+	std::unordered_map<std::string, DedupGroup> groups;
+	std::size_t num_entries;
+
+public:
+	DedupIndex();
+	// Adds a structure, returning its group.  is_new is set if it is the group's representative.
+	const DedupGroup& Add(const std::string &name, const std::string &key, bool *is_new = NULL);
+	const DedupGroup* Find(const std::string &key) const;  // NULL if the key has not been seen
+	std::size_t NumGroups() const { return groups.size(); };
+	std::size_t NumEntries() const { return num_entries; };
+	std::size_t NumDuplicates() const { return num_entries - groups.size(); };
+};
+
+
+// Looser key for near-duplicates, which share their building blocks but may differ in catenation or
+// topology: keeps the first field (node.linker SMILES or MOFkey), and for MOFkeys drops the
+// topology and commit tags after "MOFkey-v1".
+std::string nearDuplicateKey(const std::string &key);
+
+} // end namespace OpenBabel
+#endif // DEDUP_INDEX_H
+
+//! \file dedup_index.h
+//! \brief dedup_index.h - Streaming hash index of MOF identifiers for deduplication
@@ -0,0 +1,154 @@
+#include "fragment_cache.h"
+#include "fragment_hash.h"
+#include "config_sbu.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <openbabel/babelconfig.h>
+#include <openbabel/obconversion.h>
+#include <openbabel/oberror.h>
+
+namespace OpenBabel
+{
+
+namespace {
+std::string hexHash(FragmentHash hash) {
+	std::stringstream hex;
+	hex << std::hex << std::setw(16) << std::setfill('0') << hash;
+	return hex.str();
+}
+
+bool makeDir(const std::string &path) {
+	// Creates one directory level, which may already exist (e.g. from another batch worker)
+#ifdef _WIN32
+	int result = _mkdir(path.c_str());
+#else
+	int result = mkdir(path.c_str(), 0755);
+#endif
+	return result == 0 || errno == EEXIST;
+}
+
+std::string tempSuffix() {
+	// Unique among the threads and processes writing to a shared cache directory
+	static std::atomic<unsigned long> counter(0);
+	std::stringstream suffix;
+#ifdef _WIN32
+	suffix << _getpid();
+#else
+	suffix << getpid();
+#endif
+	suffix << "." << std::hash<std::thread::id>()(std::this_thread::get_id()) << "." << counter++;
+	return suffix.str();
+}
+}  // end anonymous namespace
+
+
+bool FragmentCache::Open(const std::string &dirname) {
+	Close();
+	std::string namespace_dir = dirname + "/" + GetNamespace();
+	if (!makeDir(dirname) || !makeDir(namespace_dir)) {
+		obErrorLog.ThrowError(__FUNCTION__, "Could not open fragment cache " + dirname, obWarning);
+		return false;
+	}
+	path = namespace_dir;
+	return true;
+}
+
+std::string FragmentCache::GetNamespace() {
+	// Anything besides the fragment graph and conversion that changes the exported string
+	return hexHash(hashString(std::string(FRAGMENT_EXPORT_SIGNATURE) + "|" + BABEL_VERSION));
+}
+
+std::string FragmentCache::GetConversionKey(OBConversion &obconv) {
+	// Writers may add options of their own (e.g. "c" for canonical SMILES), so call this before writing
+	std::stringstream key;
+	OBFormat *out_format = obconv.GetOutFormat();
+	key << (out_format ? out_format->GetID() : "none");
+	const std::map<std::string, std::string> *options = obconv.GetOptions(OBConversion::OUTOPTIONS);
+	for (std::map<std::string, std::string>::const_iterator it=options->begin(); it!=options->end(); ++it) {
+		key << "|" << it->first << "=" << it->second;
+	}
+	return key.str();
+}
+
+std::string FragmentCache::GetEntryPath(const FragmentInvariant &fragment, const std::string &conv_key, bool make_dirs) const {
+	std::string graph_hash = hexHash(fragment.GetHash());
+	std::string shard = path + "/" + graph_hash.substr(0, 2);
+	if (make_dirs && !makeDir(shard)) {
+		return "";
+	}
+	return shard + "/" + graph_hash + "-" + hexHash(hashString(conv_key));
+}
+
+bool FragmentCache::Lookup(const FragmentInvariant &fragment, const std::string &conv_key, std::string *value) const {
+	// Entries are "conversion key\nserialized graph\nexported string", where the export may span lines
+	if (path.empty()) {
+		return false;
+	}
+	std::ifstream entry(GetEntryPath(fragment, conv_key, false).c_str(), std::ios::in | std::ios::binary);
+	if (!entry.is_open()) {
+		return false;
+	}
+	std::string entry_conv_key;
+	std::string entry_graph;
+	if (!std::getline(entry, entry_conv_key) || !std::getline(entry, entry_graph) || entry_conv_key != conv_key) {
+		return false;
+	}
+	FragmentInvariant cached;
+	if (!cached.Deserialize(entry_graph) || !cached.Matches(fragment)) {
+		return false;  // a different graph with the same hash
+	}
+	std::stringstream contents;
+	contents << entry.rdbuf();
+	*value = contents.str();
+	return true;
+}
+
+void FragmentCache::Store(const FragmentInvariant &fragment, const std::string &conv_key, const std::string &value) const {
+	if (path.empty()) {
+		return;
+	}
+	std::string entry_path = GetEntryPath(fragment, conv_key, true);
+	if (entry_path.empty()) {
+		obErrorLog.ThrowError(__FUNCTION__, "Could not write to fragment cache " + path, obWarning);
+		return;
+	}
+	std::string temp_path = entry_path + ".tmp" + tempSuffix();
+	{
+		std::ofstream entry(temp_path.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+		entry << conv_key << "\n" << fragment.Serialize() << "\n" << value;
+		if (!entry) {
+			std::remove(temp_path.c_str());
+			return;
+		}
+	}
+	// Readers only ever see complete entries.  On Windows, rename fails if another worker stored it first.
+	if (std::rename(temp_path.c_str(), entry_path.c_str()) != 0) {
+		std::remove(temp_path.c_str());
+	}
+}
+
+
+FragmentCache& globalFragmentCache() {
+	static FragmentCache cache;
+	return cache;
+}
+
+} // end namespace OpenBabel
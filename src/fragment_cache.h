@@ -0,0 +1,56 @@
+/**********************************************************************
+fragment_cache.h - Persistent cache of exported fragment identifiers
+***********************************************************************/
+
+#ifndef FRAGMENT_CACHE_H
+#define FRAGMENT_CACHE_H
+
+#include <string>
+
+#include <openbabel/babelconfig.h>
+
+namespace OpenBabel
+{
+// forward declarations
+class OBConversion;
+class FragmentInvariant;
+
+// Environment variable naming the cache directory shared by a batch of sbu runs
+const std::string FRAGMENT_CACHE_ENV = "MOFID_FRAGMENT_CACHE";
+
+
+class FragmentCache {
+// Cross-run cache of normalized fragment exports (SMILES, InChI, InChIKey), with one small file per
+// fragment graph and conversion: dir/<namespace>/<2 hex>/<graph hash>-<conversion hash>.  Each lookup
+// only reads that one file, which also holds the full conversion key and labeled graph, so a hash
+// collision is a miss instead of a wrong identifier.  The namespace hashes the build's signature of the
+// export sources (see CMakeLists.txt) and the Open Babel version, so changing either starts a new,
+// empty namespace instead of reusing stale entries.  Entries are written to a temporary file and
+// renamed into place, so concurrent batch workers can share a directory.
+private:
+	std::string path;  // namespace directory, or empty if closed
+
+	FragmentCache(const FragmentCache& other);
+	FragmentCache& operator=(const FragmentCache&);
+	std::string GetEntryPath(const FragmentInvariant &fragment, const std::string &conv_key, bool make_dirs) const;
+
+public:
+	FragmentCache() {};
+	~FragmentCache() {};
+	bool Open(const std::string &dirname);  // creates the directories if needed
+	void Close() { path = ""; };
+	bool IsOpen() const { return !path.empty(); };
+	std::string GetPath() const { return path; };
+	bool Lookup(const FragmentInvariant &fragment, const std::string &conv_key, std::string *value) const;
+	void Store(const FragmentInvariant &fragment, const std::string &conv_key, const std::string &value) const;
+	static std::string GetNamespace();
+	static std::string GetConversionKey(OBConversion &obconv);  // output format and options, before writing
+};
+
+FragmentCache& globalFragmentCache();  // process-wide cache used by writeNormalizedMol
+
+} // end namespace OpenBabel
+#endif // FRAGMENT_CACHE_H
+
+//! \file fragment_cache.h
+//! \brief fragment_cache.h - Persistent cache of exported fragment identifiers
@@ -0,0 +1,270 @@
+#include "fragment_hash.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <queue>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <openbabel/babelconfig.h>
+#include <openbabel/mol.h>
+#include <openbabel/atom.h>
+#include <openbabel/bond.h>
+#include <openbabel/obiter.h>
+#include <openbabel/elements.h>
+
+namespace OpenBabel
+{
+
+namespace {
+FragmentHash mixHash(FragmentHash seed, FragmentHash value) {
+	// Order-dependent combination of two hashes, based on the splitmix64 finalizer
+	FragmentHash x = seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+std::size_t countClasses(const std::vector<FragmentHash> &labels) {
+	return std::set<FragmentHash>(labels.begin(), labels.end()).size();
+}
+}  // end anonymous namespace
+
+
+FragmentHash hashString(const std::string &data) {
+	FragmentHash hash = mixHash(0, data.size());
+	for (std::string::const_iterator it=data.begin(); it!=data.end(); ++it) {
+		hash = mixHash(hash, static_cast<unsigned char>(*it));
+	}
+	return hash;
+}
+
+
+FragmentInvariant::FragmentInvariant(const OBMol &normalized) {
+	OBMol &mol = const_cast<OBMol&>(normalized);  // the FOR_*_OF_MOL iterators need a non-const mol
+	std::size_t num_atoms = mol.NumAtoms();
+
+	// Formula, sorted by atomic number like getNumericFormula
+	std::map<int,int> element_counts;
+	FOR_ATOMS_OF_MOL(a, mol) {
+		++element_counts[a->GetAtomicNum()];
+	}
+	std::stringstream formula_stream;
+	for (std::map<int,int>::iterator it=element_counts.begin(); it!=element_counts.end(); ++it) {
+		formula_stream << OBElements::GetSymbol(it->first) << it->second;
+	}
+	formula = formula_stream.str();
+
+	// Labeled graph, with atoms indexed from 0 in the mol's order
+	adjacency.resize(num_atoms);
+	FOR_BONDS_OF_MOL(b, mol) {
+		int begin = b->GetBeginAtom()->GetIdx() - 1;
+		int end = b->GetEndAtom()->GetIdx() - 1;
+		adjacency[begin].push_back(std::make_pair(end, static_cast<int>(b->GetBondOrder())));
+		adjacency[end].push_back(std::make_pair(begin, static_cast<int>(b->GetBondOrder())));
+	}
+	FOR_ATOMS_OF_MOL(a, mol) {
+		FragmentHash label = mixHash(a->GetAtomicNum(), static_cast<FragmentHash>(a->GetFormalCharge()));
+		label = mixHash(label, a->GetSpinMultiplicity());
+		label = mixHash(label, a->GetIsotope());
+		label = mixHash(label, a->GetImplicitHCount());
+		label = mixHash(label, adjacency[a->GetIdx() - 1].size());
+		atom_labels.push_back(label);
+	}
+
+	// WL refinement: each label absorbs the sorted labels of its neighbors and their bond orders,
+	// until a round no longer splits any class of atoms
+	std::size_t num_classes = countClasses(atom_labels);
+	for (std::size_t round = 0; round < num_atoms; ++round) {
+		std::vector<FragmentHash> next_labels;
+		for (std::size_t i = 0; i < num_atoms; ++i) {
+			std::vector<FragmentHash> nbor_labels;
+			for (std::vector<std::pair<int, int> >::iterator nbor=adjacency[i].begin(); nbor!=adjacency[i].end(); ++nbor) {
+				nbor_labels.push_back(mixHash(atom_labels[nbor->first], nbor->second));
+			}
+			std::sort(nbor_labels.begin(), nbor_labels.end());
+			FragmentHash label = atom_labels[i];
+			for (std::vector<FragmentHash>::iterator nl=nbor_labels.begin(); nl!=nbor_labels.end(); ++nl) {
+				label = mixHash(label, *nl);
+			}
+			next_labels.push_back(label);
+		}
+		atom_labels.swap(next_labels);
+		std::size_t next_classes = countClasses(atom_labels);
+		if (next_classes == num_classes) {
+			break;
+		}
+		num_classes = next_classes;
+	}
+
+	std::vector<FragmentHash> sorted_labels(atom_labels);
+	std::sort(sorted_labels.begin(), sorted_labels.end());
+	wl_hash = mixHash(0, sorted_labels.size());
+	for (std::vector<FragmentHash>::iterator it=sorted_labels.begin(); it!=sorted_labels.end(); ++it) {
+		wl_hash = mixHash(wl_hash, *it);
+	}
+}
+
+std::string FragmentInvariant::GetKey() const {
+	std::stringstream key;
+	key << formula << ":" << std::hex << std::setw(16) << std::setfill('0') << wl_hash;
+	return key.str();
+}
+
+std::string FragmentInvariant::Serialize() const {
+	// "formula hash num_atoms" then "label degree nbor:order ..." for each atom
+	std::stringstream data;
+	data << formula << " " << std::hex << wl_hash << std::dec << " " << atom_labels.size();
+	for (std::size_t i = 0; i < atom_labels.size(); ++i) {
+		data << " " << std::hex << atom_labels[i] << std::dec << " " << adjacency[i].size();
+		for (std::vector<std::pair<int, int> >::const_iterator nbor=adjacency[i].begin(); nbor!=adjacency[i].end(); ++nbor) {
+			data << " " << nbor->first << ":" << nbor->second;
+		}
+	}
+	return data.str();
+}
+
+bool FragmentInvariant::Deserialize(const std::string &data) {
+	// Returns false, leaving an empty graph, if the data is malformed
+	std::stringstream parser(data);
+	std::size_t num_atoms = 0;
+	formula = "";
+	atom_labels.clear();
+	adjacency.clear();
+	if (!(parser >> formula >> std::hex >> wl_hash >> std::dec >> num_atoms)) {
+		*this = FragmentInvariant();
+		return false;
+	}
+	for (std::size_t i = 0; i < num_atoms; ++i) {
+		FragmentHash label = 0;
+		std::size_t degree = 0;
+		if (!(parser >> std::hex >> label >> std::dec >> degree)) {
+			*this = FragmentInvariant();
+			return false;
+		}
+		atom_labels.push_back(label);
+		adjacency.push_back(std::vector<std::pair<int, int> >());
+		for (std::size_t j = 0; j < degree; ++j) {
+			int nbor = -1;
+			int order = 0;
+			char sep = '\0';
+			if (!(parser >> nbor >> sep >> order) || sep != ':' || nbor < 0 || static_cast<std::size_t>(nbor) >= num_atoms) {
+				*this = FragmentInvariant();
+				return false;
+			}
+			adjacency.back().push_back(std::make_pair(nbor, order));
+		}
+	}
+	return true;
+}
+
+bool FragmentInvariant::Matches(const FragmentInvariant &other) const {
+	if (wl_hash != other.wl_hash || formula != other.formula || atom_labels.size() != other.atom_labels.size()) {
+		return false;
+	}
+	std::vector<FragmentHash> sorted_labels(atom_labels);
+	std::vector<FragmentHash> other_labels(other.atom_labels);
+	std::sort(sorted_labels.begin(), sorted_labels.end());
+	std::sort(other_labels.begin(), other_labels.end());
+	if (sorted_labels != other_labels) {
+		return false;
+	}
+
+	// Map atoms in breadth-first order, so each atom after the first of its component is
+	// constrained to the neighbors of an atom that is already mapped
+	std::size_t num_atoms = atom_labels.size();
+	std::vector<int> order;
+	std::vector<bool> seen(num_atoms, false);
+	for (std::size_t start = 0; start < num_atoms; ++start) {
+		if (seen[start]) {
+			continue;
+		}
+		std::queue<int> to_visit;
+		to_visit.push(start);
+		seen[start] = true;
+		while (!to_visit.empty()) {
+			int current = to_visit.front();
+			to_visit.pop();
+			order.push_back(current);
+			for (std::vector<std::pair<int, int> >::const_iterator nbor=adjacency[current].begin(); nbor!=adjacency[current].end(); ++nbor) {
+				if (!seen[nbor->first]) {
+					seen[nbor->first] = true;
+					to_visit.push(nbor->first);
+				}
+			}
+		}
+	}
+
+	std::vector<int> mapping(num_atoms, -1);
+	std::vector<bool> used(num_atoms, false);
+	long steps = 0;
+	return ExtendMatch(other, order, 0, &mapping, &used, &steps);
+}
+
+bool FragmentInvariant::ExtendMatch(const FragmentInvariant &other, const std::vector<int> &order, std::size_t depth,
+	std::vector<int> *mapping, std::vector<bool> *used, long *steps) const {
+	// Backtracking search for a label-preserving isomorphism, mapping order[depth] onward.
+	// Every atom has the same degree as its image, so mapping all of an atom's bonds to earlier
+	// atoms onto bonds in other is enough to prove that the bonds correspond 1:1.
+	if (depth == order.size()) {
+		return true;
+	}
+	if (++(*steps) > MAX_MATCH_STEPS) {
+		return false;  // too expensive to prove, so export both fragments
+	}
+	int atom = order[depth];
+	const std::vector<std::pair<int, int> > &bonds = adjacency[atom];
+
+	std::vector<int> candidates;
+	int anchor = -1;
+	for (std::vector<std::pair<int, int> >::const_iterator nbor=bonds.begin(); nbor!=bonds.end(); ++nbor) {
+		if ((*mapping)[nbor->first] >= 0) {
+			anchor = (*mapping)[nbor->first];
+			break;
+		}
+	}
+	if (anchor >= 0) {
+		for (std::vector<std::pair<int, int> >::const_iterator nbor=other.adjacency[anchor].begin(); nbor!=other.adjacency[anchor].end(); ++nbor) {
+			candidates.push_back(nbor->first);
+		}
+	} else {
+		for (std::size_t i = 0; i < other.atom_labels.size(); ++i) {
+			candidates.push_back(i);
+		}
+	}
+
+	for (std::vector<int>::iterator cand=candidates.begin(); cand!=candidates.end(); ++cand) {
+		if ((*used)[*cand] || other.atom_labels[*cand] != atom_labels[atom]
+				|| other.adjacency[*cand].size() != bonds.size()) {
+			continue;
+		}
+		bool consistent = true;
+		for (std::vector<std::pair<int, int> >::const_iterator nbor=bonds.begin(); nbor!=bonds.end() && consistent; ++nbor) {
+			int mapped_nbor = (*mapping)[nbor->first];
+			if (mapped_nbor >= 0) {
+				const std::vector<std::pair<int, int> > &cand_bonds = other.adjacency[*cand];
+				consistent = std::find(cand_bonds.begin(), cand_bonds.end(),
+					std::make_pair(mapped_nbor, nbor->second)) != cand_bonds.end();
+			}
+		}
+		if (!consistent) {
+			continue;
+		}
+		(*mapping)[atom] = *cand;
+		(*used)[*cand] = true;
+		if (ExtendMatch(other, order, depth + 1, mapping, used, steps)) {
+			return true;
+		}
+		(*mapping)[atom] = -1;
+		(*used)[*cand] = false;
+	}
+	return false;
+}
+
+} // end namespace OpenBabel
@@ -0,0 +1,58 @@
+/**********************************************************************
+fragment_hash.h - Canonical graph invariants to deduplicate normalized fragments
+***********************************************************************/
+
+#ifndef FRAGMENT_HASH_H
+#define FRAGMENT_HASH_H
+
+#include <string>
+#include <utility>  // std::pair
+#include <vector>
+
+#include <openbabel/babelconfig.h>
+
+namespace OpenBabel
+{
+// forward declarations
+class OBMol;
+
+typedef unsigned long long FragmentHash;
+
+// Give up on proving an isomorphism after this many backtracking steps, treating the fragments as distinct
+const long MAX_MATCH_STEPS = 100000;
+
+FragmentHash hashString(const std::string &data);  // stable across runs and platforms, unlike std::hash
+
+
+class FragmentInvariant {
+// Key for a normalized fragment (after resetBonds, etc.), whose exported SMILES and InChI only depend
+// on its labeled graph: atoms labeled by element, charge, spin, isotope, and implicit hydrogens, and
+// bonds labeled by bond order.  The labels are refined Weisfeiler-Lehman style until the partition of
+// atoms is stable, so isomorphic fragments always share a key regardless of atom order or geometry.
+// Unrelated fragments only share one on a hash collision, which Matches rules out.
+private:
+	std::string formula;
+	FragmentHash wl_hash;
+	std::vector<FragmentHash> atom_labels;  // refined label of each atom, in atom order
+	std::vector<std::vector<std::pair<int, int> > > adjacency;  // neighbor index and bond order of each atom
+
+	bool ExtendMatch(const FragmentInvariant &other, const std::vector<int> &order, std::size_t depth,
+		std::vector<int> *mapping, std::vector<bool> *used, long *steps) const;
+public:
+	FragmentInvariant() { wl_hash = 0; };  // empty graph, e.g. to Deserialize into
+	explicit FragmentInvariant(const OBMol &normalized);
+	std::string GetFormula() const { return formula; };
+	FragmentHash GetHash() const { return wl_hash; };
+	std::string GetKey() const;  // formula and hash, e.g. for bucketing in a std::map
+	// Exact check when two keys collide: searches for a label-preserving isomorphism
+	bool Matches(const FragmentInvariant &other) const;
+	// Single-line text form of the labeled graph, e.g. for a FragmentCache entry
+	std::string Serialize() const;
+	bool Deserialize(const std::string &data);
+};
+
+} // end namespace OpenBabel
+#endif // FRAGMENT_HASH_H
+
+//! \file fragment_hash.h
+//! \brief fragment_hash.h - Canonical graph invariants to deduplicate normalized fragments
@@ -1,6 +1,7 @@
 #include "framework.h"
 #include "obdetails.h"
 #include "periodic.h"
+#include "run_stats.h"
 
 #include <string>
 #include <vector>
@@ -31,6 +32,7 @@ bool importCIF(OBMol* molp, std::string filepath, bool bond_orders, bool makeP1)
 	obconversion.AddOption("p", OBConversion::INOPTIONS);
 	// Defer bond detection until later, once symmetry options are applied
 	obconversion.AddOption("b", OBConversion::INOPTIONS);
+	StageTimer read_timer("ReadCIF", "io");
 	bool success = obconversion.ReadFile(molp, filepath);
 
 	if (success && makeP1) {
@@ -45,9 +47,17 @@ bool importCIF(OBMol* molp, std::string filepath, bool bond_orders, bool makeP1)
 		}
 	}
 
-	detectSingleBonds(molp);  // Run single bond detection after filling in the unit cell to avoid running it twice
-	detectPaddlewheels(molp);
+	read_timer.Stop();
+	{
+		StageTimer timer("detectSingleBonds", "perception");
+		detectSingleBonds(molp);  // Run single bond detection after filling in the unit cell to avoid running it twice
+	}
+	{
+		StageTimer timer("detectPaddlewheels", "perception");
+		detectPaddlewheels(molp);
+	}
 	if (bond_orders) {
+		StageTimer timer("PerceiveBondOrders", "perception");
 		molp->PerceiveBondOrders();
 	}
 
@@ -171,6 +181,33 @@ void copyMOF(OBMol *src, OBMol *dest) {
 	}
 }
 
+OBMol makeSupercell(OBMol *orig_in_uc, int na, int nb, int nc) {
+	// Translated copies of every atom, for scaling tests on large cells.
+	// Like importCIF, run detectSingleBonds and detectPaddlewheels on the result.
+	std::vector<vector3> cell = getPeriodicLattice(orig_in_uc)->GetCellVectors();
+	OBMol dest;
+	OBUnitCell* super_uc = new OBUnitCell;
+	super_uc->SetData(cell[0] * na, cell[1] * nb, cell[2] * nc);
+	super_uc->SetSpaceGroup(1);  // P1
+	dest.SetData(super_uc);
+	dest.SetPeriodicMol();
+
+	dest.BeginModify();
+	for (int i = 0; i < na; ++i) {
+		for (int j = 0; j < nb; ++j) {
+			for (int k = 0; k < nc; ++k) {
+				vector3 offset = cell[0] * i + cell[1] * j + cell[2] * k;
+				FOR_ATOMS_OF_MOL(a, *orig_in_uc) {
+					OBAtom* copied_atom = formAtom(&dest, a->GetVector() + offset, a->GetAtomicNum());
+					copied_atom->SetFormalCharge(a->GetFormalCharge());
+				}
+			}
+		}
+	}
+	dest.EndModify();
+	return dest;
+}
+
 void resetBonds(OBMol *mol) {
 	// Resets bond orders and bond detection for molecular fragments
 	// Starting with a "clean" OBMol is the easiest way to handle this
@@ -29,6 +29,8 @@ void writeCIF(OBMol* molp, std::string filepath, bool write_bonds = true);
 void writePDB(OBMol* orig_molp, std::string pdb_filepath, bool write_bonds = true, bool exclude_pbc = true);
 OBMol initMOFwithUC(OBMol *orig_in_uc);
 void copyMOF(OBMol *src, OBMol *dest);
+// Replicates the atoms of a P1 MOF into an na x nb x nc supercell, without bonds
+OBMol makeSupercell(OBMol *orig_in_uc, int na, int nb, int nc);
 
 void resetBonds(OBMol *mol);
 void detectSingleBonds(OBMol *mol, double skin = 0.45, bool only_override_oxygen = true);
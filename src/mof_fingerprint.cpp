@@ -0,0 +1,277 @@
+#include "mof_fingerprint.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cctype>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <istream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <openbabel/babelconfig.h>
+#include <openbabel/mol.h>
+#include <openbabel/obconversion.h>
+#include <openbabel/fingerprint.h>
+#include <openbabel/oberror.h>
+
+namespace OpenBabel
+{
+
+namespace {
+inline int popcount(FingerprintWord word) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_popcountll(word);
+#else
+	return static_cast<int>(std::bitset<64>(word).count());
+#endif
+}
+
+FingerprintWord fnv1a(const std::string &text) {
+	// Stable across platforms and runs, unlike std::hash
+	FingerprintWord hash = 0xcbf29ce484222325ULL;
+	for (std::string::const_iterator it=text.begin(); it!=text.end(); ++it) {
+		hash ^= static_cast<unsigned char>(*it);
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+void setBit(FingerprintWord *fp, int bit) {
+	fp[bit / 64] |= (1ULL << (bit % 64));
+}
+
+bool moreSimilar(const std::pair<double, std::size_t> &a, const std::pair<double, std::size_t> &b) {
+	// Best first, breaking ties by database order
+	if (a.first != b.first) {
+		return a.first > b.first;
+	}
+	return a.second < b.second;
+}
+}  // end anonymous namespace
+
+
+MOFidParts::MOFidParts(const std::string &mofid) {
+	catenation = -1;
+	std::string smiles = mofid;
+	std::string tags;
+	std::string::size_type name_start = mofid.find(';');
+	if (name_start != std::string::npos) {
+		name = mofid.substr(name_start + 1);
+		smiles = mofid.substr(0, name_start);
+	}
+	std::string::size_type space = smiles.find(' ');
+	if (space != std::string::npos) {
+		tags = smiles.substr(space + 1);
+		smiles = smiles.substr(0, space);
+	}
+
+	std::stringstream smiles_parts(smiles);
+	std::string fragment;
+	while (std::getline(smiles_parts, fragment, '.')) {
+		if (!fragment.empty()) {
+			fragments.push_back(fragment);
+		}
+	}
+
+	// Tags look like MOFid-v1.rtl.cat0
+	std::stringstream tag_parts(tags);
+	std::string tag;
+	while (std::getline(tag_parts, tag, '.')) {
+		if (tag.find("MOFid") == 0 || tag.empty()) {
+			continue;
+		} else if (tag.find("cat") == 0 && tag.size() > 3 && isdigit(tag[3])) {
+			catenation = atoi(tag.c_str() + 3);
+		} else if (topology.empty()) {
+			topology = tag;
+		}
+	}
+}
+
+
+MOFFingerprinter::MOFFingerprinter(const std::string &fp_id) {
+	fp_type = OBFingerprint::FindFingerprint(fp_id.c_str());
+	if (!fp_type) {
+		obErrorLog.ThrowError(__FUNCTION__, "Unknown fingerprint type " + fp_id, obError);
+	}
+	obconv.SetInFormat("smi");
+}
+
+const std::vector<FingerprintWord>& MOFFingerprinter::FragmentFingerprint(const std::string &smiles) {
+	std::map<std::string, std::vector<FingerprintWord> >::iterator cached = fragment_fps.find(smiles);
+	if (cached != fragment_fps.end()) {
+		return cached->second;
+	}
+
+	// An empty fingerprint marks fragments that could not be parsed
+	std::vector<FingerprintWord> &words = fragment_fps[smiles];
+	OBMol fragment;
+	std::vector<unsigned int> ob_fp;
+	if (!obconv.ReadString(&fragment, smiles) || !fp_type->GetFingerprint(&fragment, ob_fp, FRAGMENT_FP_BITS)) {
+		return words;
+	}
+	// Pack OB's 32-bit words into 64-bit words for the popcount scans
+	words.assign(FRAGMENT_FP_BITS / 64, 0);
+	for (std::size_t i = 0; i < ob_fp.size() && i / 2 < words.size(); ++i) {
+		words[i / 2] |= static_cast<FingerprintWord>(ob_fp[i]) << (32 * (i % 2));
+	}
+	return words;
+}
+
+bool MOFFingerprinter::Calculate(const std::string &mofid, FingerprintWord *fp) {
+	std::fill(fp, fp + MOF_FP_WORDS, 0);
+	if (!fp_type) {
+		return false;
+	}
+
+	MOFidParts parts(mofid);
+	bool any_fragment = false;
+	for (std::vector<std::string>::iterator it=parts.fragments.begin(); it!=parts.fragments.end(); ++it) {
+		const std::vector<FingerprintWord> &fragment_fp = FragmentFingerprint(*it);
+		for (std::size_t i = 0; i < fragment_fp.size(); ++i) {
+			fp[i] |= fragment_fp[i];
+		}
+		any_fragment = any_fragment || !fragment_fp.empty();
+	}
+
+	// The last word holds the topology hash bits, and its top bits mark the catenation
+	const int topology_start = FRAGMENT_FP_BITS;
+	const int num_cat_bits = 8;
+	if (!parts.topology.empty()) {
+		FingerprintWord hash = fnv1a(parts.topology);
+		for (int i = 0; i < TOPOLOGY_HASH_BITS; ++i) {
+			int bit = static_cast<int>((hash >> (16 * i)) % (TOPOLOGY_FP_BITS - num_cat_bits));
+			setBit(fp, topology_start + bit);
+		}
+	}
+	if (parts.catenation >= 0) {
+		int cat_bit = std::min(parts.catenation, num_cat_bits - 1);
+		setBit(fp, topology_start + TOPOLOGY_FP_BITS - num_cat_bits + cat_bit);
+	}
+	return any_fragment;
+}
+
+
+std::size_t MOFFingerprintDB::Load(std::istream &db, MOFFingerprinter *fingerprinter) {
+	std::string line;
+	FingerprintWord fp[MOF_FP_WORDS];
+	while (std::getline(db, line)) {
+		if (!line.empty() && line[line.size() - 1] == '\r') {
+			line.erase(line.size() - 1);
+		}
+		if (line.empty()) {
+			continue;
+		}
+		fingerprinter->Calculate(line, fp);  // unparseable entries keep an empty fingerprint
+		AddEntry(line, fp);
+	}
+	return lines.size();
+}
+
+bool MOFFingerprintDB::SaveIndex(const std::string &path, const std::string &fp_id, const std::string &stamp) const {
+	// Text header, then each line prefixed by its length, then the packed fingerprints
+	std::ofstream index(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!index) {
+		return false;
+	}
+	index << MOF_FP_INDEX_VERSION << "\n" << fp_id << "\n" << stamp << "\n"
+		<< MOF_FP_WORDS << " " << lines.size() << "\n";
+	for (std::vector<std::string>::const_iterator it=lines.begin(); it!=lines.end(); ++it) {
+		index << it->size() << "\n" << *it;
+	}
+	if (!fps.empty()) {
+		index.write(reinterpret_cast<const char*>(&fps[0]), fps.size() * sizeof(FingerprintWord));
+	}
+	return index.good();
+}
+
+bool MOFFingerprintDB::LoadIndex(const std::string &path, const std::string &fp_id, const std::string &stamp) {
+	// Returns false, leaving the DB empty, if the index is missing, stale, or truncated
+	lines.clear();
+	fps.clear();
+	bit_counts.clear();
+	std::ifstream index(path.c_str(), std::ios::in | std::ios::binary);
+	std::string version, index_fp_id, index_stamp;
+	int num_words = 0;
+	std::size_t num_lines = 0;
+	if (!std::getline(index, version) || !std::getline(index, index_fp_id) || !std::getline(index, index_stamp)
+			|| !(index >> num_words >> num_lines) || index.get() != '\n') {
+		return false;
+	}
+	if (version != MOF_FP_INDEX_VERSION || index_fp_id != fp_id || index_stamp != stamp || num_words != MOF_FP_WORDS) {
+		return false;
+	}
+
+	std::vector<std::string> index_lines;
+	for (std::size_t i = 0; i < num_lines; ++i) {
+		std::size_t length = 0;
+		if (!(index >> length) || index.get() != '\n') {
+			return false;
+		}
+		std::string line(length, '\0');
+		if (length && !index.read(&line[0], length)) {
+			return false;
+		}
+		index_lines.push_back(line);
+	}
+	std::vector<FingerprintWord> index_fps(num_lines * MOF_FP_WORDS);
+	if (!index_fps.empty() && !index.read(reinterpret_cast<char*>(&index_fps[0]), index_fps.size() * sizeof(FingerprintWord))) {
+		return false;
+	}
+
+	for (std::size_t i = 0; i < num_lines; ++i) {
+		AddEntry(index_lines[i], &index_fps[i * MOF_FP_WORDS]);
+	}
+	return true;
+}
+
+void MOFFingerprintDB::AddEntry(const std::string &line, const FingerprintWord *fp) {
+	lines.push_back(line);
+	fps.insert(fps.end(), fp, fp + MOF_FP_WORDS);
+	bit_counts.push_back(countBits(fp));
+}
+
+std::vector<std::pair<double, std::size_t> > MOFFingerprintDB::Rank(const FingerprintWord *query, std::size_t num_results) const {
+	std::vector<std::pair<double, std::size_t> > ranked;
+	ranked.reserve(lines.size());
+	const int query_bits = countBits(query);
+	const FingerprintWord *fp = fps.empty() ? NULL : &fps[0];
+	for (std::size_t i = 0; i < lines.size(); ++i, fp += MOF_FP_WORDS) {
+		int common = 0;
+		for (int w = 0; w < MOF_FP_WORDS; ++w) {
+			common += popcount(query[w] & fp[w]);
+		}
+		int total = query_bits + bit_counts[i] - common;
+		ranked.push_back(std::make_pair(total ? static_cast<double>(common) / total : 0.0, i));
+	}
+
+	num_results = std::min(num_results, ranked.size());
+	std::partial_sort(ranked.begin(), ranked.begin() + num_results, ranked.end(), moreSimilar);
+	ranked.resize(num_results);
+	return ranked;
+}
+
+
+int countBits(const FingerprintWord *fp) {
+	int bits = 0;
+	for (int w = 0; w < MOF_FP_WORDS; ++w) {
+		bits += popcount(fp[w]);
+	}
+	return bits;
+}
+
+double tanimoto(const FingerprintWord *fp1, const FingerprintWord *fp2) {
+	int common = 0;
+	int total = 0;
+	for (int w = 0; w < MOF_FP_WORDS; ++w) {
+		common += popcount(fp1[w] & fp2[w]);
+		total += popcount(fp1[w] | fp2[w]);
+	}
+	return total ? static_cast<double>(common) / total : 0.0;
+}
+
+} // end namespace OpenBabel
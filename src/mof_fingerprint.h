@@ -0,0 +1,93 @@
+/**********************************************************************
+mof_fingerprint.h - Fixed-length building block fingerprints for MOF similarity
+***********************************************************************/
+
+#ifndef MOF_FINGERPRINT_H
+#define MOF_FINGERPRINT_H
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <openbabel/babelconfig.h>
+#include <openbabel/obconversion.h>
+
+namespace OpenBabel
+{
+// forward declarations
+class OBFingerprint;
+
+typedef unsigned long long FingerprintWord;
+
+// Any OB fingerprint plugin works, but FP2 enumerates paths, which explodes on the dense ring
+// systems of infinite (rod) nodes.  ECFP4 is linear in the fragment size.
+const std::string DEFAULT_MOF_FINGERPRINT = "ECFP4";
+const std::string MOF_FP_INDEX_VERSION = "mofid-fp-v1";
+const int FRAGMENT_FP_BITS = 1024;  // node and linker fragments, folded to this length
+const int TOPOLOGY_FP_BITS = 64;  // hashed topology and catenation
+const int MOF_FP_WORDS = (FRAGMENT_FP_BITS + TOPOLOGY_FP_BITS) / 64;
+const int TOPOLOGY_HASH_BITS = 3;  // bits set per topology name, like a small Bloom filter
+
+
+class MOFidParts {
+// Fields of a MOFid line from a .smi database, e.g. "[Co].[O-]C(=O)c1ccncc1 MOFid-v1.rtl.cat0;ABAVIJ_clean".
+// Bare SMILES are also accepted, with an empty topology and catenation.
+public:
+	std::vector<std::string> fragments;  // node and linker SMILES, split on "."
+	std::string topology;
+	int catenation;  // -1 if unknown
+	std::string name;
+	MOFidParts(const std::string &mofid);
+};
+
+
+class MOFFingerprinter {
+// Builds a MOF fingerprint as the union of its fragments' fingerprints plus topology and
+// catenation bits.  Linkers repeat across a database, so fragment fingerprints are memoized.
+private:
+	OBFingerprint *fp_type;
+	OBConversion obconv;
+	std::map<std::string, std::vector<FingerprintWord> > fragment_fps;
+
+	const std::vector<FingerprintWord>& FragmentFingerprint(const std::string &smiles);
+
+public:
+	MOFFingerprinter(const std::string &fp_id = DEFAULT_MOF_FINGERPRINT);
+	bool IsValid() const { return fp_type != NULL; };
+	// Writes MOF_FP_WORDS words to fp.  Returns false if none of the fragments could be parsed.
+	bool Calculate(const std::string &mofid, FingerprintWord *fp);
+	std::size_t NumCachedFragments() const { return fragment_fps.size(); };
+};
+
+
+class MOFFingerprintDB {
+// A .smi database with its fingerprints packed into one contiguous array, which keeps
+// a similarity scan over 100k+ entries to a tight loop of popcounts.
+private:
+	std::vector<std::string> lines;
+	std::vector<FingerprintWord> fps;  // MOF_FP_WORDS per line
+	std::vector<int> bit_counts;
+
+public:
+	std::size_t Load(std::istream &db, MOFFingerprinter *fingerprinter);  // returns the number of entries
+	// Binary index of the lines and fingerprints, so later searches skip parsing the SMILES.
+	// The stamp identifies the database version (e.g. size and modification time).
+	bool SaveIndex(const std::string &path, const std::string &fp_id, const std::string &stamp) const;
+	bool LoadIndex(const std::string &path, const std::string &fp_id, const std::string &stamp);
+	void AddEntry(const std::string &line, const FingerprintWord *fp);
+	std::size_t NumEntries() const { return lines.size(); };
+	const std::string& GetLine(std::size_t index) const { return lines[index]; };
+	// Top num_results entries by Tanimoto similarity to query, as (similarity, index), best first
+	std::vector<std::pair<double, std::size_t> > Rank(const FingerprintWord *query, std::size_t num_results) const;
+};
+
+int countBits(const FingerprintWord *fp);
+double tanimoto(const FingerprintWord *fp1, const FingerprintWord *fp2);
+
+} // end namespace OpenBabel
+#endif // MOF_FINGERPRINT_H
+
+//! \file mof_fingerprint.h
+//! \brief mof_fingerprint.h - Fixed-length building block fingerprints for MOF similarity
@@ -0,0 +1,198 @@
+// Finds duplicate MOFs across one or more databases in a single streaming pass.
+// Each structure is keyed by its MOFkey (or MOFid SMILES) and catenation, e.g. "Co.TWBYWOBDOCUKOW.MOFkey-v1 cat0",
+// and looked up in a hash index, so a duplicate is reported as soon as it is read, without pairwise comparisons.
+// The calculated keys do not include the topology, which needs Systre (see Python/run_mofid.py), so
+// frameworks that only differ in topology are grouped together.  To tell them apart, pass the full
+// MOFids or MOFkeys from run_mofid.py with --precomputed instead.
+// Near-duplicates are grouped by a looser key, which drops the catenation and topology (see
+// nearDuplicateKey), so e.g. an interpenetrated copy of a framework is linked to the single net.
+// Differences in charges or bond orders are still not matched.
+//
+// Usage: bin/mofid_dedup [--key mofkey|mofid] [--precomputed] [FILES...]
+// Structures are read from the listed CIFs, or from stdin (one CIF path per line) if none
+// are given.  With --precomputed, stdin lines are instead "name<TAB>key" pairs, such as the
+// output of a previous run, so several databases can be merged without recalculating keys.
+//
+// Writes one tab-separated line per structure to stdout as soon as it is processed:
+// name, group number, group representative (first structure seen with that key),
+// near-duplicate group number and representative, and key.
+// A summary is written to stderr at the end.
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+
+#include <openbabel/mol.h>
+#include <openbabel/babelconfig.h>
+
+#include "config_sbu.h"
+#include "dedup_index.h"
+#include "deconstructor.h"
+#include "fragment_cache.h"
+#include "framework.h"
+#include "obdetails.h"
+#include "scratch_arena.h"
+
+
+using namespace OpenBabel;  // See http://openbabel.org/dev-api/namespaceOpenBabel.shtml
+
+
+// Function prototypes
+bool calculateKey(const std::string &filename, bool use_mofid, std::string *key);
+std::string mofInfoToKey(const std::string &mof_info);
+bool reportStructure(DedupIndex *index, DedupIndex *near_index, const std::string &name, const std::string &key);
+
+
+int main(int argc, char* argv[])
+{
+	obErrorLog.SetOutputLevel(obError);  // Per-structure warnings would drown out the results
+
+	bool use_mofid = false;
+	bool precomputed = false;
+	std::vector<std::string> filenames;
+	for (int i = 1; i < argc; ++i) {  // The program name also counts as an arg
+		std::string arg = argv[i];
+		if (arg == "--key" && i + 1 < argc) {
+			std::string key_type = argv[++i];
+			if (key_type != "mofkey" && key_type != "mofid") {
+				std::cerr << "Unknown key type " << key_type << ".  Use mofkey or mofid." << std::endl;
+				return(2);
+			}
+			use_mofid = (key_type == "mofid");
+		} else if (arg == "--precomputed") {
+			precomputed = true;
+		} else if (arg.substr(0, 2) == "--") {
+			std::cerr << "Usage: mofid_dedup [--key mofkey|mofid] [--precomputed] [FILES...]" << std::endl;
+			std::cerr << "Calculated keys include the catenation but not the topology, so frameworks that only differ" << std::endl;
+			std::cerr << "in topology share a key.  Use --precomputed with full MOFids/MOFkeys to compare topologies." << std::endl;
+			return(2);
+		} else {
+			filenames.push_back(arg);
+		}
+	}
+	if (precomputed && !filenames.empty()) {
+		std::cerr << "--precomputed reads name/key pairs from stdin, not files" << std::endl;
+		return(2);
+	}
+
+#ifdef _WIN32
+	_putenv_s("BABEL_DATADIR", LOCAL_OB_DATADIR);
+	_putenv_s("BABEL_LIBDIR", LOCAL_OB_LIBDIR);
+#else
+	setenv("BABEL_DATADIR", LOCAL_OB_DATADIR, 1);
+	setenv("BABEL_LIBDIR", LOCAL_OB_LIBDIR, 1);
+#endif
+
+	// Linkers repeat heavily across a database, so share their identifiers between structures
+	const char* fragment_cache_path = getenv(FRAGMENT_CACHE_ENV.c_str());
+	if (fragment_cache_path && fragment_cache_path[0] != '\0') {
+		globalFragmentCache().Open(std::string(fragment_cache_path));
+	}
+
+	DedupIndex index;
+	DedupIndex near_index;  // by nearDuplicateKey
+	int num_near_duplicates = 0;
+	int num_failed = 0;
+	bool from_stdin = filenames.empty();
+	std::vector<std::string>::iterator next_file = filenames.begin();
+	while (true) {
+		std::string line;
+		if (from_stdin) {
+			if (!std::getline(std::cin, line)) { break; }
+			line = rtrimWhiteSpace(line);
+			if (line.empty()) { continue; }
+		} else {
+			if (next_file == filenames.end()) { break; }
+			line = *next_file;
+			++next_file;
+		}
+
+		if (precomputed) {
+			std::stringstream fields(line);
+			std::string name, key;
+			if (!std::getline(fields, name, '\t') || !std::getline(fields, key, '\t')) {
+				std::cerr << "Skipping malformed line: " << line << std::endl;
+				++num_failed;
+				continue;
+			}
+			// Accept our own output format, where the key is the last column
+			std::string column;
+			while (std::getline(fields, column, '\t')) { key = column; }
+			if (reportStructure(&index, &near_index, name, key)) { ++num_near_duplicates; }
+		} else {
+			std::string key;
+			if (!calculateKey(line, use_mofid, &key)) {
+				std::cerr << "Error reading file: " << line << std::endl;
+				++num_failed;
+				continue;
+			}
+			if (reportStructure(&index, &near_index, line, key)) { ++num_near_duplicates; }
+		}
+	}
+
+	std::cerr << index.NumEntries() << " structures, " << index.NumGroups() << " unique, "
+		<< index.NumDuplicates() << " duplicates, " << num_near_duplicates << " near-duplicates, "
+		<< num_failed << " failed" << std::endl;
+	return(0);
+}
+
+bool calculateKey(const std::string &filename, bool use_mofid, std::string *key) {
+	// Runs the MetalOxo deconstruction without any of the CIF outputs, then gets its identifier
+	ScratchArenaScope scratch;  // declared first so it outlives the deconstructor
+
+	OBMol orig_mol;
+	if (!importCIF(&orig_mol, filename, false)) {
+		return false;
+	}
+	MetalOxoDeconstructor simplifier(&orig_mol);
+	simplifier.SimplifyMOF(false);
+	if (use_mofid) {
+		*key = mofInfoToKey(simplifier.GetMOFInfo());
+	} else {
+		// Same catenation field as mofInfoToKey, since the MOFkey alone does not distinguish it
+		std::stringstream mofkey;
+		mofkey << simplifier.GetMOFkey() << " cat" << (simplifier.CheckCatenation() - 1);
+		*key = mofkey.str();
+	}
+	return true;
+}
+
+std::string mofInfoToKey(const std::string &mof_info) {
+	// Flattens the node/linker SMILES and catenation from GetMOFInfo into one line,
+	// similar to the MOFid without topology: "node.linker cat0"
+	std::stringstream lines(mof_info);
+	std::string line;
+	std::string smiles;
+	std::string catenation;
+	while (std::getline(lines, line)) {
+		line = rtrimWhiteSpace(line);
+		if (line.empty()) {
+			continue;
+		} else if (line.find("# Found ") == 0) {
+			// Like Python/id_constructor.py, a single net is cat0
+			std::stringstream cat_text(line.substr(std::string("# Found ").size()));
+			int num_nets = 0;
+			cat_text >> num_nets;
+			std::stringstream cat;
+			cat << "cat" << (num_nets - 1);
+			catenation = cat.str();
+		} else if (line[0] != '#') {
+			smiles += (smiles.empty() ? "" : ".") + line;
+		}
+	}
+	return smiles + " " + catenation;
+}
+
+bool reportStructure(DedupIndex *index, DedupIndex *near_index, const std::string &name, const std::string &key) {
+	// Flush each line, so downstream tools can act on duplicates while the pass continues.
+	// Returns true for a near-duplicate: a new exact key whose near-duplicate key was already seen.
+	bool is_new = false;
+	bool is_new_near = false;
+	const DedupGroup &group = index->Add(name, key, &is_new);
+	const DedupGroup &near_group = near_index->Add(name, nearDuplicateKey(key), &is_new_near);
+	std::cout << name << "\t" << group.id << "\t" << group.representative << "\t"
+		<< near_group.id << "\t" << near_group.representative << "\t" << key << std::endl;
+	return is_new && !is_new_near;
+}
@@ -0,0 +1,257 @@
+#include "mofid_index.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdlib>
+#include <istream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <openbabel/babelconfig.h>
+#include <openbabel/mol.h>
+#include <openbabel/elements.h>
+#include <openbabel/obconversion.h>
+#include <openbabel/oberror.h>
+#include <openbabel/parsmart.h>
+
+#include "invector.h"
+#include "mof_fingerprint.h"
+#include "obdetails.h"
+
+namespace OpenBabel
+{
+
+namespace {
+const PostingList NO_ENTRIES;
+
+bool shorterPostings(const PostingList *a, const PostingList *b) {
+	return a->size() < b->size();
+}
+
+void addPosting(PostingList *postings, std::size_t entry) {
+	// Entries are added in order, but a value may repeat within an entry (e.g. two Zn nodes)
+	if (postings->empty() || postings->back() != entry) {
+		postings->push_back(entry);
+	}
+}
+}  // end anonymous namespace
+
+
+MOFidQuery::MOFidQuery() {
+	catenation = -1;
+}
+
+bool MOFidQuery::AddCondition(const std::string &condition) {
+	std::string::size_type equals = condition.find('=');
+	if (equals == std::string::npos || equals + 1 == condition.size()) {
+		obErrorLog.ThrowError(__FUNCTION__, "Expected a field=value condition, not " + condition, obError);
+		return false;
+	}
+	std::string field = condition.substr(0, equals);
+	std::string value = condition.substr(equals + 1);
+
+	if (field == "topology") {
+		topology = value;
+	} else if (field == "cat") {
+		if (value.find("cat") == 0) {
+			value = value.substr(3);  // also accept the MOFid form, cat0
+		}
+		if (value.empty() || !isdigit(value[0])) {
+			obErrorLog.ThrowError(__FUNCTION__, "Catenation must be a number, not " + value, obError);
+			return false;
+		}
+		catenation = atoi(value.c_str());
+	} else if (field == "metal") {
+		unsigned int element = OBElements::GetAtomicNum(value.c_str());
+		if (element == 0 || !isMetalElement(element)) {
+			obErrorLog.ThrowError(__FUNCTION__, "Unknown metal " + value, obError);
+			return false;
+		}
+		metals.push_back(element);
+	} else if (field == "node") {
+		node_smarts.push_back(value);
+	} else if (field == "linker") {
+		linker_smarts.push_back(value);
+	} else {
+		obErrorLog.ThrowError(__FUNCTION__, "Unknown field " + field + ".  Use topology, cat, metal, node, or linker.", obError);
+		return false;
+	}
+	return true;
+}
+
+bool MOFidQuery::Empty() const {
+	return topology.empty() && catenation < 0 && metals.empty() && node_smarts.empty() && linker_smarts.empty();
+}
+
+
+std::size_t MOFidIndex::Load(std::istream &db) {
+	std::string line;
+	while (std::getline(db, line)) {
+		if (!line.empty() && line[line.size() - 1] == '\r') {
+			line.erase(line.size() - 1);
+		}
+		if (!line.empty()) {
+			AddEntry(line);
+		}
+	}
+	return lines.size();
+}
+
+void MOFidIndex::AddEntry(const std::string &line) {
+	const std::size_t entry = lines.size();
+	lines.push_back(line);
+	MOFidParts parts(line);
+
+	// Interpenetrated or ambiguous nets list several topologies, e.g. nbo,pcu-h
+	std::stringstream topology_names(parts.topology);
+	std::string topology;
+	while (std::getline(topology_names, topology, ',')) {
+		if (!topology.empty()) {
+			addPosting(&topologies[topology], entry);
+		}
+	}
+	if (parts.catenation >= 0) {
+		addPosting(&catenations[parts.catenation], entry);
+	}
+
+	// Like Python/remove_metals.py, components with a metal are nodes, and the rest are linkers
+	entry_components.push_back(std::vector<std::size_t>());
+	for (std::vector<std::string>::iterator it=parts.fragments.begin(); it!=parts.fragments.end(); ++it) {
+		std::vector<int> node_metals = smilesMetals(*it);
+		std::map<std::string, std::size_t>::iterator known = component_ids.find(*it);
+		std::size_t id;
+		if (known != component_ids.end()) {
+			id = known->second;
+		} else {
+			id = components.size();
+			component_ids[*it] = id;
+			components.push_back(*it);
+			component_is_node.push_back(!node_metals.empty());
+		}
+		if (!inVector<std::size_t>(id, entry_components.back())) {
+			entry_components.back().push_back(id);
+		}
+		for (std::vector<int>::iterator metal=node_metals.begin(); metal!=node_metals.end(); ++metal) {
+			addPosting(&metals[*metal], entry);
+		}
+	}
+}
+
+PostingList MOFidIndex::Search(const MOFidQuery &query) const {
+	// Intersect the cheap columns first, starting from the rarest value
+	std::vector<const PostingList*> columns;
+	if (!query.topology.empty()) {
+		std::map<std::string, PostingList>::const_iterator it = topologies.find(query.topology);
+		columns.push_back((it != topologies.end()) ? &(it->second) : &NO_ENTRIES);
+	}
+	if (query.catenation >= 0) {
+		std::map<int, PostingList>::const_iterator it = catenations.find(query.catenation);
+		columns.push_back((it != catenations.end()) ? &(it->second) : &NO_ENTRIES);
+	}
+	for (std::vector<int>::const_iterator metal=query.metals.begin(); metal!=query.metals.end(); ++metal) {
+		std::map<int, PostingList>::const_iterator it = metals.find(*metal);
+		columns.push_back((it != metals.end()) ? &(it->second) : &NO_ENTRIES);
+	}
+	std::sort(columns.begin(), columns.end(), shorterPostings);
+
+	PostingList candidates;
+	if (columns.empty()) {
+		for (std::size_t i = 0; i < lines.size(); ++i) {
+			candidates.push_back(i);
+		}
+	} else {
+		candidates = *columns[0];
+		for (std::size_t i = 1; i < columns.size() && !candidates.empty(); ++i) {
+			candidates = intersectPostings(candidates, *columns[i]);
+		}
+	}
+
+	// Then the SMARTS conditions, which only see the components of the surviving entries
+	for (std::vector<std::string>::const_iterator it=query.node_smarts.begin(); it!=query.node_smarts.end(); ++it) {
+		candidates = FilterByComponents(candidates, *it, true);
+	}
+	for (std::vector<std::string>::const_iterator it=query.linker_smarts.begin(); it!=query.linker_smarts.end(); ++it) {
+		candidates = FilterByComponents(candidates, *it, false);
+	}
+	return candidates;
+}
+
+PostingList MOFidIndex::FilterByComponents(const PostingList &candidates, const std::string &smarts, bool nodes) const {
+	// Keeps the candidates with a node (or linker) component matching the SMARTS.
+	// Each distinct component is parsed and matched at most once, however many MOFs share it.
+	PostingList kept;
+	OBSmartsPattern pattern;
+	if (candidates.empty() || !pattern.Init(smarts)) {
+		return kept;
+	}
+	const bool add_hydrogens = (smarts.find("#1]") != std::string::npos);  // as in ops/opisomorph.cpp
+	OBConversion obconv;
+	obconv.SetInFormat("smi");
+	std::vector<signed char> matched(components.size(), -1);  // -1 if not matched yet
+
+	for (PostingList::const_iterator entry=candidates.begin(); entry!=candidates.end(); ++entry) {
+		const std::vector<std::size_t> &entry_ids = entry_components[*entry];
+		for (std::vector<std::size_t>::const_iterator id=entry_ids.begin(); id!=entry_ids.end(); ++id) {
+			if (component_is_node[*id] != nodes) {
+				continue;
+			}
+			if (matched[*id] < 0) {
+				OBMol component;
+				matched[*id] = 0;
+				if (obconv.ReadString(&component, components[*id])) {
+					if (add_hydrogens) {
+						component.AddHydrogens(false, false);
+					}
+					matched[*id] = pattern.HasMatch(component) ? 1 : 0;
+				}
+			}
+			if (matched[*id] > 0) {
+				kept.push_back(*entry);
+				break;
+			}
+		}
+	}
+	return kept;
+}
+
+
+PostingList intersectPostings(const PostingList &a, const PostingList &b) {
+	PostingList common;
+	std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(common));
+	return common;
+}
+
+std::vector<int> smilesMetals(const std::string &smiles) {
+	// Scans the bracket atoms, e.g. [Zn], [Cu+2], or [63Cu], without parsing the SMILES.
+	// Metals are never in the organic subset, and aromatic symbols are all nonmetals.
+	std::vector<int> found;
+	for (std::string::size_type i = 0; i < smiles.size(); ++i) {
+		if (smiles[i] != '[') {
+			continue;
+		}
+		std::string::size_type start = i + 1;
+		while (start < smiles.size() && isdigit(smiles[start])) {
+			++start;  // isotope
+		}
+		if (start >= smiles.size() || !isupper(smiles[start])) {
+			continue;
+		}
+		std::string symbol(1, smiles[start]);
+		if (start + 1 < smiles.size() && islower(smiles[start + 1])) {
+			symbol += smiles[start + 1];
+		}
+		unsigned int element = OBElements::GetAtomicNum(symbol.c_str());
+		if (element != 0 && isMetalElement(element)
+				&& std::find(found.begin(), found.end(), static_cast<int>(element)) == found.end()) {
+			found.push_back(element);
+		}
+	}
+	std::sort(found.begin(), found.end());  // by atomic number, like the MOFkey
+	return found;
+}
+
+} // end namespace OpenBabel
@@ -0,0 +1,75 @@
+/**********************************************************************
+mofid_index.h - Columnar index of the fields of a MOFid database
+***********************************************************************/
+
+#ifndef MOFID_INDEX_H
+#define MOFID_INDEX_H
+
+#include <cstddef>
+#include <istream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <openbabel/babelconfig.h>
+
+namespace OpenBabel
+{
+
+typedef std::vector<std::size_t> PostingList;  // sorted entry indices
+
+
+class MOFidQuery {
+// Conditions on the fields of a MOFid, all of which must hold, e.g. topology=pcu, cat=0, metal=Zn,
+// and linker=C(=O)[O-].  The node and linker conditions are SMARTS patterns, which must match at
+// least one component of that role.
+public:
+	std::string topology;  // empty for any
+	int catenation;  // -1 for any
+	std::vector<int> metals;  // atomic numbers
+	std::vector<std::string> node_smarts;
+	std::vector<std::string> linker_smarts;
+
+	MOFidQuery();
+	// Adds a "field=value" condition.  Returns false for unknown fields or values.
+	bool AddCondition(const std::string &condition);
+	bool Empty() const;
+};
+
+
+class MOFidIndex {
+// Splits each MOFid into columns with posting lists per value: topology, catenation, node metals
+// (like the MOFkey), and components by role.  A query intersects the posting lists, smallest first,
+// then runs each SMARTS once per distinct component of the remaining entries instead of once per line.
+// Everything is read from the MOFid text, so the index is built without parsing any SMILES.
+private:
+	std::vector<std::string> lines;
+	std::map<std::string, PostingList> topologies;
+	std::map<int, PostingList> catenations;
+	std::map<int, PostingList> metals;
+	std::map<std::string, std::size_t> component_ids;
+	std::vector<std::string> components;  // node and linker SMILES
+	std::vector<bool> component_is_node;
+	std::vector<std::vector<std::size_t> > entry_components;
+
+	PostingList FilterByComponents(const PostingList &candidates, const std::string &smarts, bool nodes) const;
+
+public:
+	std::size_t Load(std::istream &db);  // returns the number of entries
+	void AddEntry(const std::string &line);
+	std::size_t NumEntries() const { return lines.size(); };
+	std::size_t NumComponents() const { return components.size(); };
+	const std::string& GetLine(std::size_t index) const { return lines[index]; };
+	// Entries satisfying every condition of the query, in DB order
+	PostingList Search(const MOFidQuery &query) const;
+};
+
+PostingList intersectPostings(const PostingList &a, const PostingList &b);
+// Atomic numbers of the metals in a SMILES, which are always written as bracket atoms
+std::vector<int> smilesMetals(const std::string &smiles);
+
+} // end namespace OpenBabel
+#endif // MOFID_INDEX_H
+
+//! \file mofid_index.h
+//! \brief mofid_index.h - Columnar index of the fields of a MOFid database
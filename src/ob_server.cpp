@@ -0,0 +1,219 @@
+/* ob_server: long-lived Open Babel helper for Python/cpp_cheminformatics.py */
+/* Replaces one obabel or tsfm_smiles process per call with a line-oriented protocol on stdin/stdout.
+ * Each request is one tab-separated line, answered by one line, "OK\t<result>" or "ERR\t<message>":
+ *   normalize	SMILES                          canonical SMILES, like obabel -:SMILES -xi -ocan
+ *   contains	SMILES	SMARTS                  1 or 0, like obabel -:SMILES -s SMARTS
+ *   formula	INPUT	1|0                     formula of a SMILES (1) or the first molecule of a file (0)
+ *   transform	SMILES	QUERY	REPLACEMENT     OBChemTsfm result, normalized, like tsfm_smiles
+ * Compiled SMARTS and transforms are cached across requests.  Open Babel warnings go to stderr.
+ */
+
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <openbabel/obconversion.h>
+#include <openbabel/mol.h>
+#include <openbabel/kekulize.h>
+#include <openbabel/babelconfig.h>
+#include <openbabel/oberror.h>
+#include <openbabel/parsmart.h>
+#include <openbabel/phmodel.h>
+#include "config_sbu.h"
+
+
+using namespace OpenBabel;  // See http://openbabel.org/dev-api/namespaceOpenBabel.shtml
+
+// Bounds the caches in case a client sends an unbounded stream of distinct patterns
+const std::size_t MAX_CACHED_PATTERNS = 10000;
+
+std::map<std::string, OBSmartsPattern> smarts_cache;
+std::map<std::pair<std::string, std::string>, OBChemTsfm> tsfm_cache;
+
+
+std::vector<std::string> splitFields(const std::string &line) {
+	std::vector<std::string> fields;
+	std::stringstream line_stream(line);
+	std::string field;
+	while (std::getline(line_stream, field, '\t')) {
+		fields.push_back(field);
+	}
+	return fields;
+}
+
+bool readSMILES(const std::string &smiles, OBMol *mol, bool skip_stereo = false) {
+	OBConversion reader;
+	reader.SetInFormat("smi");
+	if (skip_stereo) {
+		reader.AddOption("s", OBConversion::INOPTIONS);  // as in tsfm_smiles.cpp
+	}
+	return reader.ReadString(mol, smiles);
+}
+
+std::string writeCanonical(OBMol *mol) {
+	OBConversion writer;
+	writer.SetOutFormat("can");
+	writer.AddOption("i");  // Ignore SMILES chirality for now
+	std::string smiles = writer.WriteString(mol);
+	// Drop the tab-separated title and newline
+	std::string::size_type end = smiles.find_first_of("\t\r\n");
+	if (end != std::string::npos) {
+		smiles.erase(end);
+	}
+	return smiles;
+}
+
+const OBSmartsPattern* cachedSMARTS(const std::string &smarts) {
+	std::map<std::string, OBSmartsPattern>::iterator it = smarts_cache.find(smarts);
+	if (it != smarts_cache.end()) {
+		return &(it->second);
+	}
+	if (smarts_cache.size() >= MAX_CACHED_PATTERNS) {
+		smarts_cache.clear();
+	}
+	OBSmartsPattern &pattern = smarts_cache[smarts];
+	if (!pattern.Init(smarts)) {
+		smarts_cache.erase(smarts);
+		return NULL;
+	}
+	return &pattern;
+}
+
+OBChemTsfm* cachedTransform(const std::string &query, const std::string &replacement) {
+	std::pair<std::string, std::string> key(query, replacement);
+	std::map<std::pair<std::string, std::string>, OBChemTsfm>::iterator it = tsfm_cache.find(key);
+	if (it != tsfm_cache.end()) {
+		return &(it->second);
+	}
+	if (tsfm_cache.size() >= MAX_CACHED_PATTERNS) {
+		tsfm_cache.clear();
+	}
+	OBChemTsfm &tsfm = tsfm_cache[key];
+	// Init takes non-const references, so pass copies
+	std::string query_copy(query), replacement_copy(replacement);
+	if (!tsfm.Init(query_copy, replacement_copy)) {
+		tsfm_cache.erase(key);
+		return NULL;
+	}
+	return &tsfm;
+}
+
+
+bool normalize(const std::string &smiles, std::string *result) {
+	OBMol mol;
+	if (!readSMILES(smiles, &mol)) {
+		*result = "Error reading input SMILES";
+		return false;
+	}
+	*result = writeCanonical(&mol);
+	return true;
+}
+
+bool contains(const std::string &smiles, const std::string &smarts, std::string *result) {
+	const OBSmartsPattern *pattern = cachedSMARTS(smarts);
+	if (!pattern) {
+		*result = "Could not parse SMARTS " + smarts;
+		return false;
+	}
+	OBMol mol;
+	if (!readSMILES(smiles, &mol)) {
+		*result = "Error reading input SMILES";
+		return false;
+	}
+	if (smarts.find("#1]") != std::string::npos) {
+		mol.AddHydrogens(false, false);  // as in ops/opisomorph.cpp
+	}
+	*result = pattern->HasMatch(mol) ? "1" : "0";
+	return true;
+}
+
+bool formula(const std::string &input, bool is_smiles, std::string *result) {
+	// Same formula as obabel --append FORMULA (descriptors/filters.cpp), without the spaces
+	OBMol mol;
+	OBConversion reader;
+	reader.AddOption("b", OBConversion::INOPTIONS);  // disables bonding for non-SMILES formats, like -ab
+	bool read_ok;
+	if (is_smiles) {
+		reader.SetInFormat("smi");
+		read_ok = reader.ReadString(&mol, input);
+	} else {
+		OBFormat *format = OBConversion::FormatFromExt(input);
+		if (!format) {
+			*result = "Unknown file format for " + input;
+			return false;
+		}
+		reader.SetInFormat(format);
+		read_ok = reader.ReadFile(&mol, input);
+	}
+	if (!read_ok) {
+		*result = "Error reading " + input;
+		return false;
+	}
+	*result = mol.GetSpacedFormula(1, "");
+	return true;
+}
+
+bool transform(const std::string &smiles, const std::string &query, const std::string &replacement, std::string *result) {
+	OBChemTsfm *tsfm = cachedTransform(query, replacement);
+	if (!tsfm) {
+		*result = "Internal error: could not parse reaction transform";
+		return false;
+	}
+	OBMol mol;
+	if (!readSMILES(smiles, &mol, true)) {
+		*result = "Error reading input SMILES";
+		return false;
+	}
+	tsfm->Apply(mol);
+	mol.SetAromaticPerceived(false);
+	OBKekulize(&mol);
+	// Round trip through normalize, like cpp_cheminformatics.py did with the tsfm_smiles output
+	return normalize(writeCanonical(&mol), result);
+}
+
+bool handleRequest(const std::vector<std::string> &fields, std::string *result) {
+	const std::string command = fields.empty() ? "" : fields[0];
+	if (command == "normalize" && fields.size() == 2) {
+		return normalize(fields[1], result);
+	} else if (command == "contains" && fields.size() == 3) {
+		return contains(fields[1], fields[2], result);
+	} else if (command == "formula" && fields.size() == 3) {
+		return formula(fields[1], fields[2] != "0", result);
+	} else if (command == "transform" && fields.size() == 4) {
+		return transform(fields[1], fields[2], fields[3], result);
+	}
+	*result = "Unknown request: expected normalize, contains, formula, or transform with tab-separated arguments";
+	return false;
+}
+
+
+int main()
+{
+	// Set up the babel data directory and shared libraries
+	std::stringstream dataMsg;
+	dataMsg << "Using local Open Babel data saved in " << LOCAL_OB_DATADIR << std::endl;
+	obErrorLog.ThrowError(__FUNCTION__, dataMsg.str(), obAuditMsg);
+	dataMsg << "Using local Open Babel shared libraries saved in " << LOCAL_OB_LIBDIR << std::endl;
+	obErrorLog.ThrowError(__FUNCTION__, dataMsg.str(), obAuditMsg);
+#ifdef _WIN32
+	_putenv_s("BABEL_DATADIR", LOCAL_OB_DATADIR);
+	_putenv_s("BABEL_LIBDIR", LOCAL_OB_LIBDIR);
+#else
+	setenv("BABEL_DATADIR", LOCAL_OB_DATADIR, 1);
+	setenv("BABEL_LIBDIR", LOCAL_OB_LIBDIR, 1);
+#endif
+
+	std::string line;
+	while (std::getline(std::cin, line)) {
+		if (!line.empty() && line[line.size() - 1] == '\r') {
+			line.erase(line.size() - 1);
+		}
+		std::string result;
+		bool ok = handleRequest(splitFields(line), &result);
+		// One line per request, flushed so the client can wait on it
+		std::cout << (ok ? "OK\t" : "ERR\t") << result << std::endl;
+	}
+	return 0;
+}
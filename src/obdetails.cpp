@@ -18,12 +18,15 @@ namespace OpenBabel
 {
 
 bool isMetal(const OBAtom* atom) {
+	return isMetalElement(atom->GetAtomicNum());
+}
+
+bool isMetalElement(unsigned int element) {
 	// Use the InChI definition of metals from https://jcheminf.springeropen.com/articles/10.1186/s13321-015-0068-4
 	// Nonmetals are H, He, B, C, N, O, F, Ne, Si, P, S, Cl, Ar, Ge, As, Se, Br, Kr, Te, I, Xe, At, Rn
 	const int NUM_NONMETALS = 23;
 	unsigned int nonmetals[NUM_NONMETALS] = {1, 2, 5, 6, 7, 8, 9, 10, 14, 15, 16, 17, 18, 32, 33, 34, 35, 36, 52, 53, 54, 85, 86};
 
-	unsigned int element = atom->GetAtomicNum();
 	for (int i=0; i<NUM_NONMETALS; ++i) {
 		if (nonmetals[i] == element) {
 			return false;  // Atom is a nonmetal
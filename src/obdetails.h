@@ -18,6 +18,7 @@ class OBMol;
 class vector3;
 
 bool isMetal(const OBAtom* atom);
+bool isMetalElement(unsigned int element);
 OBBond* formBond(OBMol *mol, OBAtom *begin, OBAtom *end, int order = 1);
 OBAtom* formAtom(OBMol *mol, vector3 loc, int element);
 void changeAtomElement(OBAtom* atom, int element);
@@ -20,7 +20,7 @@ VirtualMol& PseudoAtomMap::operator[] (PseudoAtom i) {
 
 OBMol PseudoAtomMap::ToCombinedMol(bool export_bonds, bool copy_bonds) {
 	VirtualMol combined(_full_mol);
-	for (std::map<PseudoAtom, VirtualMol>::iterator it=_mapping.begin(); it!=_mapping.end(); ++it) {
+	for (ScratchMap<PseudoAtom, VirtualMol>::iterator it=_mapping.begin(); it!=_mapping.end(); ++it) {
 		combined.AddVirtualMol(it->second);
 	}
 	return combined.ToOBMol(export_bonds, copy_bonds);
@@ -24,7 +24,7 @@ class PseudoAtomMap {
 private:
 	OBMol *_pseudo_mol;
 	OBMol *_full_mol;
-	std::map<PseudoAtom, VirtualMol> _mapping;  // between _pseudo_mol and _full_mol
+	ScratchMap<PseudoAtom, VirtualMol> _mapping;  // between _pseudo_mol and _full_mol
 public:
 	// PseudoAtomMap() = delete;  // this is difficult to work with.  Just set to NULL by default
 	PseudoAtomMap(OBMol *psuedo = NULL, OBMol *orig = NULL);
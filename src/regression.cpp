@@ -0,0 +1,392 @@
+// Regression and timing check of bin/sbu against the known outputs in Resources/KnownCIFs.
+// Runs sbu on every known CIF in parallel worker processes, then compares each output tree
+// semantically against Resources/KnownCIFs/Outputs as the runs finish:
+//   CIFs: atoms matched by element and periodic position within a tolerance, and the bond graph (see compare)
+//   topology.cgd: cell, node multiset, and edges, up to lattice translations and node numbering
+//   identifiers (MOFkey, linker InChIs, linker stats): the same lines in any order
+// and records the CPU time of each sbu run against a stored baseline (name, CPU and wall seconds).
+//
+// Usage: bin/regression [--jobs N] [--sbu bin/sbu] [--known Resources/KnownCIFs] [--output Output]
+//                       [--baseline FILE] [--update-baseline] [--max-slowdown RATIO] [--tolerance ANGSTROMS]
+//                       [--mismatch-dir Mismatch]
+// Exits with 0 if every structure matches, 1 if any output differs, sbu fails, or (with --max-slowdown)
+// a structure takes more than RATIO times its baseline CPU time.  Differing outputs are copied to the
+// mismatch directory for inspection.  CPU time is used since it is mostly unaffected by the other jobs.
+// Outputs in EXPECTED_DIFFERENCES are still compared, but reported as expected instead of failing.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "config_sbu.h"
+#include "cif_compare.h"
+
+extern char** environ;
+
+using namespace OpenBabel;
+
+const std::string DEFAULT_KNOWN_DIR{"Resources/KnownCIFs"};
+const std::string DEFAULT_BASELINE{"Resources/KnownCIFs/timing_baseline.tsv"};
+// Slowdowns shorter than this are noise, e.g. for the smallest structures
+const double MIN_SLOWDOWN_SECONDS{0.2};
+// Known outputs that sbu does not reproduce, keyed by name/file, with the reason
+const std::string POINTER_ORDER_REASON{"the 2-c sites depend on pointer order, which changes with the output path"};
+const std::map<std::string, std::string> EXPECTED_DIFFERENCES{
+    {"29_DUT_42_metal_swap/MetalOxo/simplified_topology_with_two_conn.cif", POINTER_ORDER_REASON},
+    {"29_DUT_42_metal_swap/StandardIsolated/simplified_topology_with_two_conn.cif", POINTER_ORDER_REASON},
+    {"80_PCN-250/AllNode/simplified_topology_with_two_conn.cif", POINTER_ORDER_REASON},
+    {"80_PCN-250/AllNode/test_partial.cif", POINTER_ORDER_REASON},
+    {"80_PCN-250/AllNode/test_with_simplified_nodes.cif", POINTER_ORDER_REASON},
+};
+
+struct RegressionRun {
+    std::string name;  // CIF basename without .cif, also the name of its output directory
+    int exitStatus{-1};  // -1 if sbu could not be started or did not exit normally
+    double cpuSeconds{0.0};
+    double wallSeconds{0.0};
+    bool done{false};
+};
+
+struct RegressionOptions {
+    int jobs{0};
+    std::string sbu{"bin/sbu"};
+    std::string knownDir{DEFAULT_KNOWN_DIR};
+    std::string outputDir{"Output"};
+    std::string baseline{DEFAULT_BASELINE};
+    bool updateBaseline{false};
+    double maxSlowdown{0.0};  // 0 to only report the timings
+    double tolerance{DEFAULT_POSITION_TOLERANCE};
+    std::string mismatchDir{"Mismatch"};
+};
+
+void runSbu(const RegressionOptions& options, RegressionRun& run);
+int compareOutputs(const RegressionOptions& options, const RegressionRun& run);
+bool isOutputSame(const std::string& knownPath, const std::string& outputPath, double tolerance);
+std::map<std::string, std::pair<double, double>> readBaseline(const std::string& path);
+bool writeBaseline(const std::string& path, const std::vector<RegressionRun>& runs);
+void makeDirectories(const std::string& path);
+void removeDirectory(const std::string& path);
+void copyFile(const std::string& from, const std::string& to);
+
+int main(int argc, char* argv[]) {
+    const std::string usage{"Usage: regression [--jobs N] [--sbu bin/sbu] [--known Resources/KnownCIFs] [--output Output] "
+        "[--baseline FILE] [--update-baseline] [--max-slowdown RATIO] [--tolerance ANGSTROMS] [--mismatch-dir Mismatch]"};
+    RegressionOptions options{};
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg{argv[i]};
+        if (arg == "--update-baseline") {
+            options.updateBaseline = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << usage << std::endl;
+            return 2;
+        }
+        const std::string value{argv[++i]};
+        if (arg == "--jobs") {
+            options.jobs = std::atoi(value.c_str());
+        } else if (arg == "--sbu") {
+            options.sbu = value;
+        } else if (arg == "--known") {
+            options.knownDir = value;
+        } else if (arg == "--output") {
+            options.outputDir = value;
+        } else if (arg == "--baseline") {
+            options.baseline = value;
+        } else if (arg == "--max-slowdown") {
+            options.maxSlowdown = std::atof(value.c_str());
+        } else if (arg == "--tolerance") {
+            options.tolerance = std::atof(value.c_str());
+        } else if (arg == "--mismatch-dir") {
+            options.mismatchDir = value;
+        } else {
+            std::cerr << "Unknown option " << arg << std::endl << usage << std::endl;
+            return 2;
+        }
+    }
+    if (options.jobs <= 0) {
+        options.jobs = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (!(options.tolerance > 0) || options.maxSlowdown < 0) {
+        std::cerr << usage << std::endl;
+        return 2;
+    }
+#ifdef _WIN32
+	_putenv_s("BABEL_DATADIR", LOCAL_OB_DATADIR);
+	_putenv_s("BABEL_LIBDIR", LOCAL_OB_LIBDIR);
+#else
+	setenv("BABEL_DATADIR", LOCAL_OB_DATADIR, 1);
+	setenv("BABEL_LIBDIR", LOCAL_OB_LIBDIR, 1);
+#endif
+
+    // Only the CIFs directly in the known directory, not the reference outputs below it
+    std::vector<std::string> cifs{};
+    findFiles(options.knownDir, "", ".cif", cifs);
+    std::vector<RegressionRun> runs{};
+    for (const std::string& cif : cifs) {
+        if (cif.find('/') == std::string::npos) {
+            RegressionRun run{};
+            run.name = cif.substr(0, cif.size() - 4);
+            runs.push_back(run);
+        }
+    }
+    if (runs.empty()) {
+        std::cerr << "No CIFs found in " << options.knownDir << std::endl;
+        return 2;
+    }
+    makeDirectories(options.outputDir);
+
+    // Workers run sbu on the next structure, while the main thread compares finished runs in order
+    std::atomic<std::size_t> nextRun{0};
+    std::mutex doneMutex{};
+    std::condition_variable doneChanged{};
+    std::vector<std::thread> workers{};
+    for (int i = 0; i < std::min<int>(options.jobs, runs.size()); ++i) {
+        workers.push_back(std::thread([&]() {
+            for (std::size_t r = nextRun++; r < runs.size(); r = nextRun++) {
+                RegressionRun result{runs[r]};
+                runSbu(options, result);
+                std::lock_guard<std::mutex> guard{doneMutex};
+                runs[r] = result;
+                runs[r].done = true;
+                doneChanged.notify_all();
+            }
+        }));
+    }
+
+    const std::map<std::string, std::pair<double, double>> baseline{readBaseline(options.baseline)};
+    int numFailed{0};
+    int numSlower{0};
+    for (RegressionRun& run : runs) {
+        {
+            std::unique_lock<std::mutex> lock{doneMutex};
+            doneChanged.wait(lock, [&run]() { return run.done; });
+        }
+        std::cout << "CHECKING " << run.name << std::endl;
+        int numDifferent{0};
+        if (run.exitStatus != 0) {
+            std::cout << "FAILED: sbu exited with status " << run.exitStatus << ", see "
+                << options.outputDir << "/" << run.name << ".log" << std::endl;
+            numDifferent = 1;
+        } else {
+            numDifferent = compareOutputs(options, run);
+        }
+
+        std::ostringstream timing{};
+        timing << std::fixed << std::setprecision(2) << "TIME: " << run.cpuSeconds << " s CPU, "
+            << run.wallSeconds << " s wall";
+        const auto known = baseline.find(run.name);
+        bool isSlower{false};
+        if (known != baseline.end() && known->second.first > 0) {
+            const double ratio{run.cpuSeconds / known->second.first};
+            timing << ", " << known->second.first << " s baseline (" << ratio << "x)";
+            isSlower = options.maxSlowdown > 0 && ratio > options.maxSlowdown
+                && run.cpuSeconds - known->second.first > MIN_SLOWDOWN_SECONDS;
+        } else {
+            timing << ", no baseline";
+        }
+        std::cout << timing.str() << std::endl;
+        if (isSlower) {
+            std::cout << "SLOWER: " << run.name << " is over " << options.maxSlowdown << "x its baseline" << std::endl;
+            ++numSlower;
+        }
+        if (numDifferent) {
+            std::cout << "DIFFERENT: " << run.name << " has " << numDifferent << " differing outputs" << std::endl;
+            ++numFailed;
+        } else {
+            std::cout << "SUCCESS: " << run.name << std::endl;
+        }
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    std::cout << numFailed << " of " << runs.size() << " structures differ";
+    if (options.maxSlowdown > 0) {
+        std::cout << ", " << numSlower << " are slower than " << options.maxSlowdown << "x the baseline";
+    }
+    std::cout << std::endl;
+    if (options.updateBaseline) {
+        if (!writeBaseline(options.baseline, runs)) {
+            std::cerr << "Could not write " << options.baseline << std::endl;
+            return 1;
+        }
+        std::cout << "Updated the timing baseline in " << options.baseline << std::endl;
+    }
+    return (numFailed || numSlower) ? 1 : 0;
+}
+
+void runSbu(const RegressionOptions& options, RegressionRun& run) {
+    // Runs sbu on the structure, with stdout and stderr in OUTPUT/name.log, and times it
+    const std::string cif{options.knownDir + "/" + run.name + ".cif"};
+    const std::string outputDir{options.outputDir + "/" + run.name};
+    const std::string logPath{options.outputDir + "/" + run.name + ".log"};
+    removeDirectory(outputDir);  // otherwise, outputs from an earlier run could hide missing ones
+    posix_spawn_file_actions_t actions{};
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, logPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+    std::vector<char*> args{const_cast<char*>(options.sbu.c_str()), const_cast<char*>(cif.c_str()),
+        const_cast<char*>(outputDir.c_str()), nullptr};
+
+    const std::chrono::steady_clock::time_point start{std::chrono::steady_clock::now()};
+    pid_t pid{};
+    const int error{posix_spawn(&pid, options.sbu.c_str(), &actions, nullptr, args.data(), environ)};
+    posix_spawn_file_actions_destroy(&actions);
+    if (error != 0) {
+        std::cerr << "Could not run " << options.sbu << ": " << std::strerror(error) << std::endl;
+        return;
+    }
+    int status{};
+    struct rusage usage{};
+    while (wait4(pid, &status, 0, &usage) < 0) {
+        if (errno != EINTR) {
+            return;
+        }
+    }
+    const std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() - start};
+    run.wallSeconds = elapsed.count();
+    run.cpuSeconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+        + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    run.exitStatus = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+int compareOutputs(const RegressionOptions& options, const RegressionRun& run) {
+    // Returns the number of outputs that are missing, extra, or different from the known outputs
+    const std::string knownRoot{options.knownDir + "/Outputs/" + run.name};
+    const std::string outputRoot{options.outputDir + "/" + run.name};
+    std::vector<std::string> knownFiles{};
+    std::vector<std::string> outputFiles{};
+    findFiles(knownRoot, "", "", knownFiles);
+    findFiles(outputRoot, "", "", outputFiles);
+    if (knownFiles.empty()) {
+        std::cout << "MISSING: no known outputs in " << knownRoot << std::endl;
+        return 1;
+    }
+    int numDifferent{0};
+    const std::set<std::string> known{knownFiles.begin(), knownFiles.end()};
+    for (const std::string& file : outputFiles) {
+        if ((hasSuffix(file, ".cif") || hasSuffix(file, ".cgd")) && !known.count(file)) {
+            std::cout << "EXTRA: " << run.name << "/" << file << " has no known output" << std::endl;
+            ++numDifferent;
+        }
+    }
+    const std::set<std::string> written{outputFiles.begin(), outputFiles.end()};
+    for (const std::string& file : knownFiles) {
+        // mol_name.txt is the path of the CIF, which depends on where sbu ran
+        if (!(hasSuffix(file, ".cif") || hasSuffix(file, ".cgd") || hasSuffix(file, ".txt")) || file == "mol_name.txt") {
+            continue;
+        }
+        const std::string outputPath{outputRoot + "/" + file};
+        if (!written.count(file)) {
+            std::cout << "MISSING: " << run.name << "/" << file << std::endl;
+            ++numDifferent;
+        } else if (!isOutputSame(knownRoot + "/" + file, outputPath, options.tolerance)) {
+            const auto expected = EXPECTED_DIFFERENCES.find(run.name + "/" + file);
+            if (expected != EXPECTED_DIFFERENCES.end()) {
+                std::cout << "EXPECTED DIFFERENCE: " << run.name << "/" << file << ", since " << expected->second << std::endl;
+                continue;
+            }
+            std::cout << "DIFFERENT: " << run.name << "/" << file << std::endl;
+            ++numDifferent;
+            if (!options.mismatchDir.empty()) {
+                copyFile(outputPath, options.mismatchDir + "/" + run.name + "/" + file);
+            }
+        }
+    }
+    return numDifferent;
+}
+
+bool isOutputSame(const std::string& knownPath, const std::string& outputPath, double tolerance) {
+    if (hasSuffix(knownPath, ".cif")) {
+        return areCIFsSame(knownPath, outputPath, tolerance);
+    } else if (hasSuffix(knownPath, ".cgd")) {
+        return areCGDsSame(knownPath, outputPath, DEFAULT_FRACTIONAL_TOLERANCE);
+    }
+    return areLineSetsSame(knownPath, outputPath);
+}
+
+std::map<std::string, std::pair<double, double>> readBaseline(const std::string& path) {
+    // Tab-separated name, CPU seconds, and wall seconds, with # comments
+    std::map<std::string, std::pair<double, double>> baseline{};
+    std::ifstream file{path};
+    std::string line{};
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields{line};
+        std::string name{};
+        double cpuSeconds{};
+        double wallSeconds{};
+        if (std::getline(fields, name, '\t') && fields >> cpuSeconds >> wallSeconds) {
+            baseline[name] = std::make_pair(cpuSeconds, wallSeconds);
+        }
+    }
+    return baseline;
+}
+
+bool writeBaseline(const std::string& path, const std::vector<RegressionRun>& runs) {
+    // Keeps the previous timings of structures that failed this time
+    std::map<std::string, std::pair<double, double>> baseline{readBaseline(path)};
+    for (const RegressionRun& run : runs) {
+        if (run.exitStatus == 0) {
+            baseline[run.name] = std::make_pair(run.cpuSeconds, run.wallSeconds);
+        }
+    }
+    std::ofstream file{path};
+    file << "# name\tcpu_seconds\twall_seconds, from bin/regression --update-baseline" << std::endl;
+    file << std::fixed << std::setprecision(3);
+    for (const auto& entry : baseline) {
+        file << entry.first << "\t" << entry.second.first << "\t" << entry.second.second << std::endl;
+    }
+    return file.good();
+}
+
+void makeDirectories(const std::string& path) {
+    // Like mkdir -p
+    for (std::size_t slash = path.find('/', 1); slash != std::string::npos; slash = path.find('/', slash + 1)) {
+        mkdir(path.substr(0, slash).c_str(), 0755);
+    }
+    mkdir(path.c_str(), 0755);
+}
+
+int removeEntry(const char* path, const struct stat*, int, struct FTW*) {
+    return std::remove(path);
+}
+
+void removeDirectory(const std::string& path) {
+    // Like rm -rf, without following symlinks
+    nftw(path.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+void copyFile(const std::string& from, const std::string& to) {
+    makeDirectories(to.substr(0, to.find_last_of('/')));
+    std::ifstream source{from, std::ios::binary};
+    std::ofstream destination{to, std::ios::binary};
+    destination << source.rdbuf();
+}
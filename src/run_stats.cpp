@@ -0,0 +1,223 @@
+#include "run_stats.h"
+#include "trace_events.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace OpenBabel
+{
+
+namespace {
+// Each thread records into its own stats, like the per-thread scratch arenas
+RunStats*& currentStats() {
+	static thread_local RunStats *current = NULL;
+	return current;
+}
+}  // end anonymous namespace
+
+
+void RunStats::AddTime(const std::string &stage, double seconds) {
+	std::map<std::string, double>::iterator it = times.find(stage);
+	if (it == times.end()) {
+		stage_order.push_back(stage);
+		times[stage] = seconds;
+	} else {
+		it->second += seconds;
+	}
+}
+
+void RunStats::AddMemory(const std::string &stage, long peak, long growth) {
+	if (times.find(stage) == times.end()) {
+		AddTime(stage, 0.0);  // keeps the stage order
+	}
+	if (peak > peak_kb[stage]) {
+		peak_kb[stage] = peak;
+	}
+	peak_growth_kb[stage] += growth;
+}
+
+void RunStats::Count(const std::string &counter, long amount) {
+	counts[counter] += amount;
+}
+
+void RunStats::SetCount(const std::string &counter, long value) {
+	counts[counter] = value;
+}
+
+double RunStats::GetTime(const std::string &stage) const {
+	std::map<std::string, double>::const_iterator it = times.find(stage);
+	return (it == times.end()) ? 0.0 : it->second;
+}
+
+long RunStats::GetCount(const std::string &counter) const {
+	std::map<std::string, long>::const_iterator it = counts.find(counter);
+	return (it == counts.end()) ? 0 : it->second;
+}
+
+long RunStats::GetPeakGrowth(const std::string &stage) const {
+	std::map<std::string, long>::const_iterator it = peak_growth_kb.find(stage);
+	return (it == peak_growth_kb.end()) ? 0 : it->second;
+}
+
+std::string RunStats::ToJSON() const {
+	// Stages in the order they first ran, then counters alphabetically
+	std::stringstream json;
+	json << "{\"stages\":{";
+	for (std::vector<std::string>::const_iterator it=stage_order.begin(); it!=stage_order.end(); ++it) {
+		if (it != stage_order.begin()) {
+			json << ",";
+		}
+		json << jsonString(*it) << ":" << GetTime(*it);
+	}
+	json << "},\"memory_kb\":{";
+	bool first_memory = true;
+	for (std::vector<std::string>::const_iterator it=stage_order.begin(); it!=stage_order.end(); ++it) {
+		std::map<std::string, long>::const_iterator peak = peak_kb.find(*it);
+		if (peak == peak_kb.end()) {
+			continue;
+		}
+		if (!first_memory) {
+			json << ",";
+		}
+		first_memory = false;
+		json << jsonString(*it) << ":{\"peak\":" << peak->second << ",\"growth\":" << GetPeakGrowth(*it) << "}";
+	}
+	json << "},\"counters\":{";
+	for (std::map<std::string, long>::const_iterator it=counts.begin(); it!=counts.end(); ++it) {
+		if (it != counts.begin()) {
+			json << ",";
+		}
+		json << jsonString(it->first) << ":" << it->second;
+	}
+	json << "}}";
+	return json.str();
+}
+
+RunStats* RunStats::Current() {
+	return currentStats();
+}
+
+void RunStats::SetCurrent(RunStats *stats) {
+	currentStats() = stats;
+}
+
+
+RunStatsScope::RunStatsScope(RunStats *stats) {
+	previous = RunStats::Current();
+	RunStats::SetCurrent(stats);
+}
+
+RunStatsScope::~RunStatsScope() {
+	RunStats::SetCurrent(previous);
+}
+
+
+StageTimer::StageTimer(const char *stage_name, const char *stage_category) {
+	stats = RunStats::Current();
+	tracing = globalTraceSink().IsOpen();
+	stage = stage_name;
+	category = stage_category;
+	start_peak_kb = 0;
+	if (stats) {
+		start_peak_kb = peakRSSKB();
+	}
+	if (stats || tracing) {
+		start = std::chrono::steady_clock::now();
+	}
+}
+
+StageTimer::~StageTimer() {
+	Stop();
+}
+
+void StageTimer::Stop() {
+	if (!stats && !tracing) {
+		return;
+	}
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	if (stats) {
+		std::chrono::duration<double> elapsed = end - start;
+		stats->AddTime(stage, elapsed.count());
+		long end_peak_kb = peakRSSKB();
+		stats->AddMemory(stage, end_peak_kb, end_peak_kb - start_peak_kb);
+		stats = NULL;  // only record once
+	}
+	if (tracing) {
+		globalTraceSink().AddSpan(stage, category, start, end);
+		tracing = false;
+	}
+}
+
+
+std::string jsonString(const std::string &text) {
+	// Quotes and escapes text as a JSON string
+	std::stringstream escaped;
+	escaped << "\"";
+	for (std::string::const_iterator it=text.begin(); it!=text.end(); ++it) {
+		switch (*it) {
+			case '"': escaped << "\\\""; break;
+			case '\\': escaped << "\\\\"; break;
+			case '\n': escaped << "\\n"; break;
+			case '\r': escaped << "\\r"; break;
+			case '\t': escaped << "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(*it) < 0x20) {
+					char code[8];
+					snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned char>(*it));
+					escaped << code;
+				} else {
+					escaped << *it;
+				}
+		}
+	}
+	escaped << "\"";
+	return escaped.str();
+}
+
+
+long currentRSSKB() {
+#ifdef __linux__
+	// The second field of statm is the resident size in pages
+	std::ifstream statm("/proc/self/statm");
+	long total_pages = 0;
+	long resident_pages = 0;
+	if (statm >> total_pages >> resident_pages) {
+		return resident_pages * (sysconf(_SC_PAGESIZE) / 1024);
+	}
+	return 0;
+#else
+	return peakRSSKB();  // no portable current RSS, so err on the high side
+#endif
+}
+
+long peakRSSKB() {
+#ifdef _WIN32
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0;
+	}
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024;  // bytes on macOS, instead of kB
+#elif defined(__linux__)
+	// Linux only folds the current RSS into ru_maxrss lazily, so include it like VmHWM does
+	long current_kb = currentRSSKB();
+	return (current_kb > usage.ru_maxrss) ? current_kb : usage.ru_maxrss;
+#else
+	return usage.ru_maxrss;
+#endif
+#endif
+}
+
+} // end namespace OpenBabel
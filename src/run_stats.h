@@ -0,0 +1,93 @@
+/**********************************************************************
+run_stats.h - Per-stage timers and counters for sbu --stats
+***********************************************************************/
+
+#ifndef RUN_STATS_H
+#define RUN_STATS_H
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace OpenBabel
+{
+
+class RunStats {
+// Accumulates wall-clock time per named stage (kept in first-seen order) and integer counters.
+// Stages also track the process RSS high-water mark: the peak when the stage last ended, and the
+// total growth of that peak during the stage, i.e. how much the stage raised the memory footprint.
+// The instrumented code records into the thread's current RunStats (see RunStatsScope),
+// so nothing is collected, and the timers cost one thread_local lookup, unless a scope is active.
+public:
+	void AddTime(const std::string &stage, double seconds);
+	void AddMemory(const std::string &stage, long peak_kb, long growth_kb);
+	void Count(const std::string &counter, long amount = 1);
+	void SetCount(const std::string &counter, long value);
+	double GetTime(const std::string &stage) const;  // 0.0 if never timed
+	long GetCount(const std::string &counter) const;  // 0 if never counted
+	long GetPeakGrowth(const std::string &stage) const;  // in kB
+	std::string ToJSON() const;  // {"stages":{...},"memory_kb":{stage:{"peak","growth"}},"counters":{...}}
+	static RunStats* Current();
+	static void SetCurrent(RunStats *stats);
+private:
+	std::vector<std::string> stage_order;
+	std::map<std::string, double> times;
+	std::map<std::string, long> peak_kb;
+	std::map<std::string, long> peak_growth_kb;
+	std::map<std::string, long> counts;
+};
+
+
+class RunStatsScope {
+// Makes stats current for the lifetime of the scope, e.g. one deconstructor, restoring the previous stats after.
+// A NULL stats disables collection within the scope.
+public:
+	RunStatsScope(RunStats *stats);
+	~RunStatsScope();
+private:
+	RunStatsScope(const RunStatsScope& other);
+	RunStatsScope& operator=(const RunStatsScope&);
+	RunStats *previous;
+};
+
+
+class StageTimer {
+// Adds the lifetime of the timer (or until Stop) to the named stage of the stats current at construction, if any.
+// Takes a C string so a disabled timer never builds a std::string; it must outlive the timer (e.g. a literal).
+// Stages may nest, e.g. SimplifyAxB within SimplifyTopology, so they do not add up to the total time.
+// When a trace is open (see trace_events.h), the stage is also recorded as a span in the given category.
+public:
+	StageTimer(const char *stage_name, const char *stage_category = "stage");
+	~StageTimer();
+	void Stop();
+private:
+	StageTimer(const StageTimer& other);
+	StageTimer& operator=(const StageTimer&);
+	RunStats *stats;
+	bool tracing;
+	const char *stage;
+	const char *category;
+	std::chrono::steady_clock::time_point start;
+	long start_peak_kb;
+};
+
+
+inline void countStat(const char *counter, long amount = 1) {
+	RunStats *stats = RunStats::Current();
+	if (stats) {
+		stats->Count(counter, amount);
+	}
+}
+
+std::string jsonString(const std::string &text);  // quoted and escaped JSON string
+
+// Resident set size of this process in kB, or 0 where unsupported (e.g. Windows)
+long currentRSSKB();
+long peakRSSKB();  // high-water mark over the lifetime of the process
+
+} // end namespace OpenBabel
+#endif // RUN_STATS_H
+
+//! \file run_stats.h
+//! \brief run_stats.h - Per-stage timers and counters for sbu --stats
@@ -1,6 +1,13 @@
 // Main MOFid code to decompose a CIF into nodes, linkers, and solvents.
 // Writes the SMILES and catenation info to stdout, errors to stderr, and
 // relevant CIFs and simplified topology.cgd to the Output/ directory.
+// Use --algorithms and --emit to restrict the deconstructors and outputs, e.g. for screening:
+// bin/sbu --algorithms metaloxo,singlenode --emit mofkey,smiles,cgd MOF.cif
+// Use --stats to also write per-stage timings, memory, and counters for each deconstructor to output_dir/stats.json.
+// Use --memory-budget MB (or $MOFID_MEMORY_BUDGET_MB) to stop writing CIFs, then skip the optional
+// deconstructors, when a structure is projected to exceed that much resident memory.
+// Use --trace FILE (or $MOFID_TRACE) to append Chrome/Perfetto trace events for the structure, each
+// deconstructor, and their stages, e.g. to view a whole batch of runs in https://ui.perfetto.dev
 
 // See https://openbabel.org/docs/dev/UseTheLibrary/CppExamples.html
 // Get iterator help from http://openbabel.org/dev-api/group__main.shtml
@@ -9,17 +16,24 @@
 // Instead of including code to display the full MOF SMILES, just use openbabel natively:
 // obabel CIFFILE -ap -ocan
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <deque>
 #include <iostream>
+#include <new>
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <map>
 #include <set>
+#include <utility>
 #include <stdio.h>
 #include <stdlib.h>
 #include <cstring>
 #include <string>
 #include <sys/stat.h>
+#include <dirent.h>
 
 #include <openbabel/mol.h>
 #include <openbabel/obiter.h>
@@ -30,22 +44,110 @@
 #include "invector.h"
 #include "obdetails.h"
 #include "deconstructor.h"
+#include "fragment_cache.h"
 #include "framework.h"
 #include "periodic.h"
 #include "pseudo_atom.h"
+#include "run_stats.h"
 #include "topology.h"
+#include "trace_events.h"
 #include "virtual_mol.h"
 
 
 using namespace OpenBabel;  // See http://openbabel.org/dev-api/namespaceOpenBabel.shtml
 
 
+// Which deconstruction algorithms to run and which outputs to write, from --algorithms and --emit
+const std::string ALGORITHM_NAMES[] = {"metaloxo", "singlenode", "allnode", "standardisolated"};
+const std::string EMIT_NAMES[] = {"smiles", "mofkey", "inchi", "linkerstats", "cifs", "cgd"};
+
+struct SbuOptions {
+	std::set<std::string> algorithms;
+	std::set<std::string> emit;
+	bool stats;  // write stats.json
+	long memory_budget_mb;  // 0 for no limit
+	SbuOptions() {  // runs everything, like the original sbu
+		algorithms.insert(ALGORITHM_NAMES, ALGORITHM_NAMES + 4);
+		emit.insert(EMIT_NAMES, EMIT_NAMES + 6);
+		stats = false;
+		memory_budget_mb = 0;
+	}
+	bool Runs(const std::string &algorithm) const { return algorithms.find(algorithm) != algorithms.end(); };
+	bool Emits(const std::string &output) const { return emit.find(output) != emit.end(); };
+};
+
+
+// Default for --memory-budget, so batch workers can be packed onto a node without changing the command line
+const std::string MEMORY_BUDGET_ENV = "MOFID_MEMORY_BUDGET_MB";
+
+class MemoryBudget {
+// Soft limit on the resident memory used for one structure.  Before each deconstructor, its peak is
+// projected as the current RSS plus the largest growth of the RSS high-water mark by a deconstructor
+// so far.  The first projection uses the growth during the CIF import instead, which also copies the
+// whole MOF but overestimates since it includes loading Open Babel's plugins and data.  Over budget,
+// sbu first stops writing CIFs, then skips the optional deconstructors, instead of being OOM-killed.
+public:
+	MemoryBudget(long limit_mb) {
+		limit_kb = limit_mb * 1024;
+		import_growth_kb = 0;
+		largest_growth_kb = -1;  // no deconstructor measured yet
+		stage_start_kb = 0;
+	}
+	void StartImport() { stage_start_kb = currentRSSKB(); };
+	void EndImport() { import_growth_kb = peakRSSKB() - stage_start_kb; };
+	void EndStage() {
+		long growth_kb = peakRSSKB() - stage_start_kb;  // overestimates if an earlier stage set the peak
+		if (growth_kb > largest_growth_kb) {
+			largest_growth_kb = growth_kb;
+		}
+	};
+	bool Admit(const std::string &name, bool required, SbuOptions *options) {
+		// Starts the stage and returns true if the deconstructor should run, possibly without CIFs
+		long current_kb = currentRSSKB();
+		long projected_kb = current_kb + ((largest_growth_kb < 0) ? import_growth_kb : largest_growth_kb);
+		if (limit_kb > 0 && projected_kb > limit_kb) {
+			std::stringstream msg;
+			msg << "Memory budget: " << name << " is projected to need " << projected_kb / 1024
+				<< " MB of the " << limit_kb / 1024 << " MB budget, ";
+			if (options->Emits("cifs")) {
+				options->emit.erase("cifs");
+				countStat("memory_budget_dropped_cifs");
+				std::cerr << msg.str() << "so CIFs will not be written" << std::endl;
+			} else if (!required) {
+				countStat("memory_budget_skipped");
+				std::cerr << msg.str() << "so it will be skipped" << std::endl;
+				return false;
+			}
+		}
+		stage_start_kb = current_kb;
+		return true;
+	};
+	bool Exceeded() const { return limit_kb > 0 && peakRSSKB() > limit_kb; };
+	long LimitKB() const { return limit_kb; };
+private:
+	long limit_kb;
+	long import_growth_kb;
+	long largest_growth_kb;
+	long stage_start_kb;
+};
+
+
 // Function prototypes
+bool analyzeMOF(const std::string &filename, const std::string &output_dir, const SbuOptions &options, std::string *mof_info);
 std::string analyzeMOF(std::string filename, const std::string &output_dir=DEFAULT_OUTPUT_PATH);
+void runDeconstructor(Deconstructor *simplifier, const std::string &output_dir, const SbuOptions &options);
+template <class T>
+void runOptionalDeconstructor(const std::string &name, OBMol *orig_mol, const std::string &output_dir, SbuOptions *options,
+	MemoryBudget *budget, std::deque<std::pair<std::string, RunStats> > *deconstructor_stats);
+bool parseMemoryBudget(const std::string &arg, long *budget_mb);
+void writeStats(const std::string &filename, double total_seconds, const RunStats &structure_stats,
+	const std::deque<std::pair<std::string, RunStats> > &deconstructor_stats, const std::string &path);
+bool parseOptionList(const std::string &arg, const std::string *allowed, int num_allowed, std::set<std::string> *parsed);
 extern "C" void analyzeMOFc(const char *cifdata, char *analysis, int buflen);
 extern "C" int SmilesToSVG(const char* smiles, int options, void* mbuf, unsigned int buflen);
 void try_mkdir(const std::string &path);
 void write_string(const std::string &contents, const std::string &path);
+void removeStaleOutputs(const std::string &output_dir);
 
 
 int main(int argc, char* argv[])
@@ -53,22 +155,77 @@ int main(int argc, char* argv[])
 	obErrorLog.SetOutputLevel(obWarning);  // See also http://openbabel.org/wiki/Errors
 
 	// Parse args and set up the output directory
-	// TODO: consider adding an arg to switch which algorithm is called (MOFid, InChIKey, all-node, etc.)
-	char* filename;
-	if (argc != 2 && argc != 3) {  // The program name (bin/sbu) also counts as an arg
+	const std::string usage = "Usage: sbu [--algorithms metaloxo,singlenode,allnode,standardisolated] "
+		"[--emit smiles,mofkey,inchi,linkerstats,cifs,cgd] [--stats] [--memory-budget MB] [--trace FILE] CIF [output_dir]";
+	SbuOptions options;
+	bool explicit_emit = false;
+	std::string trace_path;
+	std::vector<std::string> positional;
+	for (int i = 1; i < argc; ++i) {  // The program name (bin/sbu) also counts as an arg
+		std::string arg = argv[i];
+		if (arg == "--algorithms" || arg == "--emit") {
+			if (i + 1 >= argc) {
+				std::cerr << "Missing value for " << arg << std::endl << usage << std::endl;
+				return(2);
+			}
+			std::string value = argv[++i];
+			bool valid = (arg == "--algorithms")
+				? parseOptionList(value, ALGORITHM_NAMES, 4, &options.algorithms)
+				: parseOptionList(value, EMIT_NAMES, 6, &options.emit);
+			if (!valid) {
+				std::cerr << "Invalid value for " << arg << ": " << value << std::endl << usage << std::endl;
+				return(2);
+			}
+			explicit_emit = explicit_emit || (arg == "--emit");
+		} else if (arg == "--stats") {
+			options.stats = true;
+		} else if (arg == "--memory-budget") {
+			if (i + 1 >= argc || !parseMemoryBudget(argv[i + 1], &options.memory_budget_mb)) {
+				std::cerr << "--memory-budget needs a positive number of MB" << std::endl << usage << std::endl;
+				return(2);
+			}
+			++i;
+		} else if (arg == "--trace") {
+			if (i + 1 >= argc || argv[i + 1][0] == '\0') {
+				std::cerr << "--trace needs an output file" << std::endl << usage << std::endl;
+				return(2);
+			}
+			trace_path = argv[++i];
+		} else if (arg.substr(0, 2) == "--") {
+			std::cerr << "Unknown option " << arg << std::endl << usage << std::endl;
+			return(2);
+		} else {
+			positional.push_back(arg);
+		}
+	}
+	if (positional.size() != 1 && positional.size() != 2) {
 		std::cerr << "Incorrect number of arguments.  Need to specify the CIF and optionally an output directory." << std::endl;
+		std::cerr << usage << std::endl;
 		return(2);
 	}
-	filename = argv[1];
+
+	// The SMILES, MOFkey, and linker outputs all come from the MetalOxo algorithm
+	const std::string METAL_OXO_OUTPUTS[] = {"smiles", "mofkey", "inchi", "linkerstats"};
+	if (!options.Runs("metaloxo")) {
+		for (int i = 0; i < 4; ++i) {
+			if (explicit_emit && options.Emits(METAL_OXO_OUTPUTS[i])) {
+				std::cerr << "--emit " << METAL_OXO_OUTPUTS[i] << " requires the metaloxo algorithm" << std::endl;
+				return(2);
+			}
+			options.emit.erase(METAL_OXO_OUTPUTS[i]);
+		}
+	}
+
+	std::string filename = positional[0];
 	std::string output_dir = DEFAULT_OUTPUT_PATH;
-	if (argc >= 3) {
-		output_dir = std::string(argv[2]);
+	if (positional.size() >= 2) {
+		output_dir = positional[1];
 	}
 	try_mkdir(output_dir);
-	try_mkdir(output_dir + METAL_OXO_SUFFIX);
-	try_mkdir(output_dir + SINGLE_NODE_SUFFIX);
-	try_mkdir(output_dir + ALL_NODE_SUFFIX);
-	try_mkdir(output_dir + STANDARD_ISOLATED_SUFFIX);
+	if (options.Runs("metaloxo")) { try_mkdir(output_dir + METAL_OXO_SUFFIX); }
+	if (options.Runs("singlenode")) { try_mkdir(output_dir + SINGLE_NODE_SUFFIX); }
+	if (options.Runs("allnode")) { try_mkdir(output_dir + ALL_NODE_SUFFIX); }
+	if (options.Runs("standardisolated")) { try_mkdir(output_dir + STANDARD_ISOLATED_SUFFIX); }
 
     // Set up the babel data directory to use a local copy customized for MOFs
 	// (instead of system-wide Open Babel data)
@@ -89,55 +246,212 @@ int main(int argc, char* argv[])
 	setenv("BABEL_LIBDIR", LOCAL_OB_LIBDIR, 1);
 #endif
 
-	std::string mof_results = analyzeMOF(std::string(filename), output_dir);
-	if (mof_results == "") {  // No MOFs found
+	// Optionally share normalized fragment identifiers across a batch of runs
+	const char* fragment_cache_path = getenv(FRAGMENT_CACHE_ENV.c_str());
+	if (fragment_cache_path && fragment_cache_path[0] != '\0') {
+		globalFragmentCache().Open(std::string(fragment_cache_path));
+	}
+
+	const char* memory_budget = getenv(MEMORY_BUDGET_ENV.c_str());
+	if (options.memory_budget_mb == 0 && memory_budget && memory_budget[0] != '\0'
+			&& !parseMemoryBudget(memory_budget, &options.memory_budget_mb)) {
+		std::cerr << "Ignoring invalid " << MEMORY_BUDGET_ENV << "=" << memory_budget << std::endl;
+	}
+
+	// Optionally trace the run, appending to a file shared by a batch of runs
+	const char* trace_env = getenv(TRACE_ENV.c_str());
+	if (trace_path.empty() && trace_env) {
+		trace_path = trace_env;
+	}
+	if (!trace_path.empty()) {
+		globalTraceSink().Open(trace_path, "sbu " + filename);
+	}
+
+	std::string mof_results;
+	bool found_mof = false;
+	try {
+		found_mof = analyzeMOF(filename, output_dir, options, &mof_results);
+	} catch (std::bad_alloc &e) {
+		std::cerr << "Out of memory while analyzing " << filename << std::endl;
+	}
+	globalTraceSink().Close();
+	if (!found_mof) {  // No MOFs found
 		return(1);
-	} else {
-		std::cout << mof_results;
-		return(0);
 	}
+	std::cout << mof_results;
+	return(0);
 }
 
 std::string analyzeMOF(std::string filename, const std::string &output_dir) {
+	// Runs all algorithms and outputs, returning the MOF info or an empty string on errors
+	std::string mof_info;
+	analyzeMOF(filename, output_dir, SbuOptions(), &mof_info);
+	return mof_info;
+}
+
+bool analyzeMOF(const std::string &filename, const std::string &output_dir, const SbuOptions &options, std::string *mof_info) {
 	// Extract components of the MOFid
-	// Reports nodes/linkers, number of nets found, and writes CIFs to the DEFAULT_OUTPUT_PATH folder
+	// Reports nodes/linkers, number of nets found, and writes CIFs to the DEFAULT_OUTPUT_PATH folder.
+	// Only runs the deconstructors and writes the outputs selected in options.
+
+	removeStaleOutputs(output_dir);
+	TraceSpan structure_span(filename.substr(filename.find_last_of("/\\") + 1), "structure",
+		globalTraceSink().IsOpen() ? "{\"cif\":" + jsonString(filename) + "}" : "");
+
+	// Timers and counters for --stats: the import into structure_stats, then each deconstructor
+	// (including its identifier exports) into its own entry.  Nothing is collected without --stats.
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	RunStats structure_stats;
+	std::deque<std::pair<std::string, RunStats> > deconstructor_stats;
+	RunStatsScope stats_scope(options.stats ? &structure_stats : NULL);
+	// The memory budget may turn off CIF outputs for the rest of the run, so work from a copy of options
+	SbuOptions active = options;
+	MemoryBudget budget(options.memory_budget_mb);
 
 	OBMol orig_mol;
 	// Massively improving performance by skipping kekulization of the full MOF
+	// (importCIF times its own ReadCIF, detectSingleBonds, and detectPaddlewheels stages)
+	budget.StartImport();
 	if (!importCIF(&orig_mol, filename, false)) {
 		std::cerr << "Error reading file: %s" << filename << std::endl;
-		return "";
+		return false;
 	}
+	budget.EndImport();
+	countStat("atoms", orig_mol.NumAtoms());
+	countStat("bonds", orig_mol.NumBonds());
 
 	// Save a copy of the original mol for debugging
-	writeCIF(&orig_mol, output_dir + "/orig_mol.cif");
+	if (active.Emits("cifs")) {
+		StageTimer timer("WriteOrigCIF", "io");
+		writeCIF(&orig_mol, output_dir + "/orig_mol.cif");
+	}
 	write_string(filename, output_dir + "/mol_name.txt");
 
-	MetalOxoDeconstructor simplifier(&orig_mol);
-	std::string metal_oxo_dir = output_dir + METAL_OXO_SUFFIX;
-	simplifier.SetOutputDir(metal_oxo_dir);
-	simplifier.SimplifyMOF();
-	simplifier.WriteCIFs();
-	write_string(simplifier.GetMOFkey(), metal_oxo_dir + "/mofkey_no_topology.txt");
-	write_string(simplifier.GetLinkerInChIs(), metal_oxo_dir + "/inchi_linkers.txt");
-	write_string(simplifier.GetLinkerStats(), metal_oxo_dir + "/linker_stats.txt");
-
-	SingleNodeDeconstructor sn_simplify(&orig_mol);
-	sn_simplify.SetOutputDir(output_dir + SINGLE_NODE_SUFFIX);
-	sn_simplify.SimplifyMOF();
-	sn_simplify.WriteCIFs();
-
-	AllNodeDeconstructor an_simplify(&orig_mol);
-	an_simplify.SetOutputDir(output_dir + ALL_NODE_SUFFIX);
-	an_simplify.SimplifyMOF();
-	an_simplify.WriteCIFs();
-
-	StandardIsolatedDeconstructor std_simplify(&orig_mol);
-	std_simplify.SetOutputDir(output_dir + STANDARD_ISOLATED_SUFFIX);
-	std_simplify.SimplifyMOF();
-	std_simplify.WriteCIFs();
-
-	return simplifier.GetMOFInfo();
+	mof_info->clear();
+	if (active.Runs("metaloxo")) {
+		deconstructor_stats.push_back(std::make_pair(std::string("MetalOxo"), RunStats()));
+		RunStatsScope decon_scope(options.stats ? &deconstructor_stats.back().second : NULL);
+		TraceSpan decon_span("MetalOxo", "deconstructor");
+		budget.Admit("MetalOxo", true, &active);  // required for the MOFid, so only the CIFs can be dropped
+		MetalOxoDeconstructor simplifier(&orig_mol);
+		std::string metal_oxo_dir = output_dir + METAL_OXO_SUFFIX;
+		runDeconstructor(&simplifier, metal_oxo_dir, active);
+		if (active.Emits("mofkey")) {
+			StageTimer timer("GetMOFkey", "export");
+			write_string(simplifier.GetMOFkey(), metal_oxo_dir + "/mofkey_no_topology.txt");
+		}
+		if (active.Emits("inchi")) {
+			StageTimer timer("GetLinkerInChIs", "export");
+			write_string(simplifier.GetLinkerInChIs(), metal_oxo_dir + "/inchi_linkers.txt");
+		}
+		if (active.Emits("linkerstats")) {
+			StageTimer timer("GetLinkerStats", "export");
+			write_string(simplifier.GetLinkerStats(), metal_oxo_dir + "/linker_stats.txt");
+		}
+		if (active.Emits("smiles")) {
+			StageTimer timer("GetMOFInfo", "export");
+			*mof_info = simplifier.GetMOFInfo();
+		}
+		budget.EndStage();
+	}
+
+	if (active.Runs("singlenode")) {
+		runOptionalDeconstructor<SingleNodeDeconstructor>("SingleNode", &orig_mol, output_dir + SINGLE_NODE_SUFFIX,
+			&active, &budget, &deconstructor_stats);
+	}
+	if (active.Runs("allnode")) {
+		runOptionalDeconstructor<AllNodeDeconstructor>("AllNode", &orig_mol, output_dir + ALL_NODE_SUFFIX,
+			&active, &budget, &deconstructor_stats);
+	}
+	if (active.Runs("standardisolated")) {
+		runOptionalDeconstructor<StandardIsolatedDeconstructor>("StandardIsolated", &orig_mol, output_dir + STANDARD_ISOLATED_SUFFIX,
+			&active, &budget, &deconstructor_stats);
+	}
+
+	countStat("peak_rss_kb", peakRSSKB());
+	if (budget.Exceeded()) {
+		std::cerr << "Memory budget: peak RSS of " << peakRSSKB() / 1024 << " MB exceeded the "
+			<< budget.LimitKB() / 1024 << " MB budget" << std::endl;
+		countStat("memory_budget_exceeded");
+	}
+	if (options.stats) {
+		countStat("memory_budget_kb", budget.LimitKB());
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		writeStats(filename, elapsed.count(), structure_stats, deconstructor_stats, output_dir + "/stats.json");
+	}
+	return true;
+}
+
+template <class T>
+void runOptionalDeconstructor(const std::string &name, OBMol *orig_mol, const std::string &output_dir, SbuOptions *options,
+	MemoryBudget *budget, std::deque<std::pair<std::string, RunStats> > *deconstructor_stats) {
+	// Runs a deconstructor besides MetalOxo, unless the memory budget says to skip it
+	deconstructor_stats->push_back(std::make_pair(name, RunStats()));
+	RunStatsScope decon_scope(options->stats ? &deconstructor_stats->back().second : NULL);
+	TraceSpan decon_span(name, "deconstructor");
+	if (!budget->Admit(name, false, options)) {
+		return;
+	}
+	T simplifier(orig_mol);
+	runDeconstructor(&simplifier, output_dir, *options);
+	budget->EndStage();
+}
+
+void runDeconstructor(Deconstructor *simplifier, const std::string &output_dir, const SbuOptions &options) {
+	// Simplifies the MOF and writes the requested files, skipping the CIF writers when possible
+	simplifier->SetOutputDir(output_dir);
+	simplifier->SimplifyMOF(options.Emits("cifs"));
+	if (options.Emits("cifs")) {
+		StageTimer timer("WriteCIFs", "io");
+		simplifier->WriteCIFs();
+	}
+	if (options.Emits("cgd")) {
+		StageTimer timer("WriteTopology", "io");
+		simplifier->WriteTopology();
+	}
+}
+
+void writeStats(const std::string &filename, double total_seconds, const RunStats &structure_stats,
+	const std::deque<std::pair<std::string, RunStats> > &deconstructor_stats, const std::string &path) {
+	// Writes the --stats JSON: {"cif", "total_seconds", "stages", "counters", "deconstructors": {name: {"stages", "counters"}}}
+	std::string structure_json = structure_stats.ToJSON();
+	std::stringstream json;
+	json << "{\"cif\":" << jsonString(filename) << ",\"total_seconds\":" << total_seconds << ",";
+	json << structure_json.substr(1, structure_json.size() - 2);  // same keys, without the braces
+	json << ",\"deconstructors\":{";
+	for (std::deque<std::pair<std::string, RunStats> >::const_iterator it=deconstructor_stats.begin(); it!=deconstructor_stats.end(); ++it) {
+		if (it != deconstructor_stats.begin()) {
+			json << ",";
+		}
+		json << jsonString(it->first) << ":" << it->second.ToJSON();
+	}
+	json << "}}";
+	write_string(json.str(), path);
+}
+
+bool parseMemoryBudget(const std::string &arg, long *budget_mb) {
+	// Parses a positive number of MB
+	std::stringstream parser(arg);
+	long value = 0;
+	if (!(parser >> value) || !parser.eof() || value <= 0) {
+		return false;
+	}
+	*budget_mb = value;
+	return true;
+}
+
+bool parseOptionList(const std::string &arg, const std::string *allowed, int num_allowed, std::set<std::string> *parsed) {
+	// Parses a comma-separated list like "metaloxo,singlenode", checking each item against allowed
+	parsed->clear();
+	std::stringstream items(arg);
+	std::string item;
+	while (std::getline(items, item, ',')) {
+		if (std::find(allowed, allowed + num_allowed, item) == allowed + num_allowed) {
+			return false;
+		}
+		parsed->insert(item);
+	}
+	return !parsed->empty();
 }
 
 extern "C" {
@@ -195,6 +509,36 @@ void try_mkdir(const std::string &path) {
 	}
 }
 
+void removeStaleOutputs(const std::string &output_dir) {
+	// Deletes the outputs of an earlier run in output_dir, since this run may skip some of them
+	// (--algorithms, --emit, or the memory budget), and e.g. run_mofid.py would report a stale topology.cgd.
+	// Only the algorithm subdirectories are sbu's own, so the top level only loses files sbu writes.
+	const std::string TOP_LEVEL_OUTPUTS[] = {"orig_mol.cif", "orig_mol.pdb", "stats.json"};
+	for (int i = 0; i < 3; ++i) {
+		std::remove((output_dir + "/" + TOP_LEVEL_OUTPUTS[i]).c_str());
+	}
+	const std::string SUBDIRS[] = {METAL_OXO_SUFFIX, SINGLE_NODE_SUFFIX, ALL_NODE_SUFFIX, STANDARD_ISOLATED_SUFFIX};
+	for (int i = 0; i < 4; ++i) {
+		std::string subdir = output_dir + SUBDIRS[i];
+		DIR *dir = opendir(subdir.c_str());
+		if (!dir) {
+			continue;
+		}
+		std::vector<std::string> stale;
+		while (struct dirent *entry = readdir(dir)) {
+			std::string name = entry->d_name;
+			std::string ext = name.substr(name.find_last_of('.') + 1);
+			if (name.find('.') != std::string::npos && (ext == "cif" || ext == "pdb" || ext == "cgd" || ext == "txt")) {
+				stale.push_back(subdir + "/" + name);
+			}
+		}
+		closedir(dir);
+		for (std::vector<std::string>::iterator it=stale.begin(); it!=stale.end(); ++it) {
+			std::remove(it->c_str());
+		}
+	}
+}
+
 void write_string(const std::string &contents, const std::string &path) {
 	std::ofstream file_info;
 	file_info.open(path.c_str(), std::ios::out | std::ios::trunc);
@@ -0,0 +1,158 @@
+#include "scratch_arena.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <openbabel/babelconfig.h>
+#include <openbabel/oberror.h>
+
+namespace OpenBabel
+{
+
+namespace {
+// Each thread gets its own arena, so worker threads never share free lists
+ScratchArena*& currentArena() {
+	static thread_local ScratchArena *current = NULL;
+	return current;
+}
+
+ScratchArena& threadArena() {
+	static thread_local ScratchArena arena;
+	return arena;
+}
+}  // end anonymous namespace
+
+
+ScratchArena::ScratchArena(std::size_t size) {
+	owner = std::this_thread::get_id();
+	chunk_size = size;
+	cursor = NULL;
+	chunk_end = NULL;
+	live_blocks = 0;
+	for (std::size_t i = 0; i <= MAX_POOLED_SIZE / ALIGNMENT; ++i) {
+		free_lists[i] = NULL;
+	}
+}
+
+ScratchArena::~ScratchArena() {
+	for (std::vector<char*>::iterator it=chunks.begin(); it!=chunks.end(); ++it) {
+		::operator delete(*it);
+	}
+}
+
+void ScratchArena::CheckOwner(const char *caller) const {
+	// A container handed to another thread would race on the free lists, so fail loudly instead
+	if (std::this_thread::get_id() != owner) {
+		obErrorLog.ThrowError(caller, "Scratch arena used from a thread that does not own it", obError);
+		std::abort();
+	}
+}
+
+void* ScratchArena::Allocate(std::size_t bytes) {
+	CheckOwner(__FUNCTION__);
+	++live_blocks;
+	if (bytes > MAX_POOLED_SIZE) {
+		return ::operator new(bytes);
+	}
+	std::size_t size_class = SizeClass(bytes);
+	if (size_class == 0) {
+		size_class = 1;
+	}
+
+	// Recycle a freed block of the same size, if available
+	if (free_lists[size_class]) {
+		void *block = free_lists[size_class];
+		free_lists[size_class] = *static_cast<void**>(block);
+		return block;
+	}
+
+	std::size_t rounded = size_class * ALIGNMENT;
+	if (cursor == NULL || cursor + rounded > chunk_end) {
+		char *chunk = static_cast<char*>(::operator new(chunk_size));
+		chunks.push_back(chunk);
+		cursor = chunk;
+		chunk_end = chunk + chunk_size;
+	}
+	void *block = cursor;
+	cursor += rounded;
+	return block;
+}
+
+void ScratchArena::Deallocate(void *ptr, std::size_t bytes) {
+	if (ptr == NULL) {
+		return;
+	}
+	CheckOwner(__FUNCTION__);
+	--live_blocks;
+	if (bytes > MAX_POOLED_SIZE) {
+		::operator delete(ptr);
+		return;
+	}
+	std::size_t size_class = SizeClass(bytes);
+	if (size_class == 0) {
+		size_class = 1;
+	}
+	*static_cast<void**>(ptr) = free_lists[size_class];
+	free_lists[size_class] = ptr;
+}
+
+bool ScratchArena::Reset() {
+	// Releases everything but the first chunk, which is kept for the next structure.
+	// Refuses if any container still holds arena blocks, since they would be left dangling.
+	if (live_blocks != 0) {
+		return false;
+	}
+	for (std::size_t i = 1; i < chunks.size(); ++i) {
+		::operator delete(chunks[i]);
+	}
+	if (chunks.size() > 1) {
+		chunks.resize(1);
+	}
+	if (chunks.empty()) {
+		cursor = NULL;
+		chunk_end = NULL;
+	} else {
+		cursor = chunks[0];
+		chunk_end = chunks[0] + chunk_size;
+	}
+	for (std::size_t i = 0; i <= MAX_POOLED_SIZE / ALIGNMENT; ++i) {
+		free_lists[i] = NULL;
+	}
+	return true;
+}
+
+ScratchArena* ScratchArena::Current() {
+	return currentArena();
+}
+
+void ScratchArena::SetCurrent(ScratchArena *arena) {
+	currentArena() = arena;
+}
+
+
+ScratchArenaScope::ScratchArenaScope() {
+	// Nested scopes keep using the outer arena, which is only reset by the outermost scope
+	previous = ScratchArena::Current();
+	if (!previous) {
+		ScratchArena::SetCurrent(&threadArena());
+	}
+}
+
+ScratchArenaScope::~ScratchArenaScope() {
+	if (previous) {
+		return;
+	}
+	ScratchArena::SetCurrent(NULL);
+	ScratchArena &arena = threadArena();
+	if (!arena.Reset()) {
+		std::stringstream leaked;
+		leaked << arena.NumLiveBlocks() << " scratch blocks outlived their structure.  Keeping the arena until they are freed.";
+		obErrorLog.ThrowError(__FUNCTION__, leaked.str(), obWarning);
+	}
+}
+
+} // end namespace OpenBabel
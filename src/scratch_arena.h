@@ -0,0 +1,122 @@
+/**********************************************************************
+scratch_arena.h - Per-structure arena for short-lived deconstruction data
+***********************************************************************/
+
+#ifndef SCRATCH_ARENA_H
+#define SCRATCH_ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <set>
+#include <map>
+#include <functional>  // std::less
+#include <thread>
+#include <type_traits>
+#include <utility>  // std::pair
+#include <vector>
+
+namespace OpenBabel
+{
+
+class ScratchArena {
+// Chunked arena for the many small container nodes allocated while deconstructing one structure.
+// Freed blocks are recycled through size-class free lists, so the repeated by-value copies of
+// AtomSet's do not grow the arena, and Reset() hands everything back in one step between structures.
+// Only worth it for in-process batch tools (e.g. mofid_dedup), since sbu exits after one structure.
+// Not thread-safe: each thread has its own current arena (see ScratchArenaScope), and allocating or
+// freeing a block from any other thread aborts instead of corrupting the free lists.
+public:
+	static const std::size_t DEFAULT_CHUNK_SIZE = 1 << 20;
+	static const std::size_t ALIGNMENT = 16;
+	static const std::size_t MAX_POOLED_SIZE = 256;  // larger requests go straight to the heap
+	ScratchArena(std::size_t chunk_size = DEFAULT_CHUNK_SIZE);
+	~ScratchArena();
+	void* Allocate(std::size_t bytes);
+	void Deallocate(void *ptr, std::size_t bytes);
+	bool Reset();  // false if blocks are still in use
+	std::size_t NumLiveBlocks() const { return live_blocks; };
+	std::size_t BytesReserved() const { return chunks.size() * chunk_size; };
+	static ScratchArena* Current();
+	static void SetCurrent(ScratchArena *arena);
+private:
+	// Noncopyable, since containers hold raw pointers back to the arena
+	ScratchArena(const ScratchArena& other);
+	ScratchArena& operator=(const ScratchArena&);
+	static std::size_t SizeClass(std::size_t bytes) { return (bytes + ALIGNMENT - 1) / ALIGNMENT; };
+	void CheckOwner(const char *caller) const;
+
+	std::thread::id owner;  // the constructing thread
+	std::size_t chunk_size;
+	std::vector<char*> chunks;
+	char *cursor;
+	char *chunk_end;
+	std::size_t live_blocks;
+	void* free_lists[MAX_POOLED_SIZE / ALIGNMENT + 1];
+};
+
+
+class ScratchArenaScope {
+// Makes a thread's scratch arena current for the lifetime of the scope, e.g. one structure in a batch tool.
+// Declare it before any containers using ScratchAllocator, so they are destroyed before the arena is reset.
+public:
+	ScratchArenaScope();
+	~ScratchArenaScope();
+private:
+	ScratchArenaScope(const ScratchArenaScope& other);
+	ScratchArenaScope& operator=(const ScratchArenaScope&);
+	ScratchArena *previous;
+};
+
+
+template <typename T>
+class ScratchAllocator {
+// STL allocator bound to whichever arena was current when the container was constructed.
+// Outside of a ScratchArenaScope (e.g. unit tests or helper tools), it falls back to the heap.
+public:
+	typedef T value_type;
+	typedef std::false_type propagate_on_container_copy_assignment;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+	template <typename U> struct rebind { typedef ScratchAllocator<U> other; };
+
+	ScratchAllocator() : arena(ScratchArena::Current()) {};
+	template <typename U>
+	ScratchAllocator(const ScratchAllocator<U> &other) : arena(other.arena) {};
+	// Copied containers belong to the copying thread's current arena, not the source's
+	ScratchAllocator select_on_container_copy_construction() const { return ScratchAllocator(); };
+
+	T* allocate(std::size_t n) {
+		if (arena) {
+			return static_cast<T*>(arena->Allocate(n * sizeof(T)));
+		}
+		return static_cast<T*>(::operator new(n * sizeof(T)));
+	};
+	void deallocate(T *ptr, std::size_t n) {
+		if (arena) {
+			arena->Deallocate(ptr, n * sizeof(T));
+		} else {
+			::operator delete(ptr);
+		}
+	};
+
+	ScratchArena *arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ScratchAllocator<T> &a, const ScratchAllocator<U> &b) { return a.arena == b.arena; }
+template <typename T, typename U>
+bool operator!=(const ScratchAllocator<T> &a, const ScratchAllocator<U> &b) { return a.arena != b.arena; }
+
+
+// Node-based containers backed by the current scratch arena.
+// C++14 has no std::pmr containers, so the allocator is spelled out here.
+template <typename T>
+using ScratchSet = std::set<T, std::less<T>, ScratchAllocator<T> >;
+template <typename K, typename V>
+using ScratchMap = std::map<K, V, std::less<K>, ScratchAllocator<std::pair<const K, V> > >;
+
+} // end namespace OpenBabel
+#endif // SCRATCH_ARENA_H
+
+//! \file scratch_arena.h
+//! \brief scratch_arena.h - Per-structure arena for short-lived deconstruction data
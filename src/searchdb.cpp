@@ -2,16 +2,40 @@
  * Usage: searchdb '[Co]' core.smi exclude
  * The optional last parameter will reverse the search.
  * Returns the matching SMILES lines
+ * Element and bond screens are saved to core.smi.scr on the first search, so later searches
+ * only run the full SMARTS match on lines with every element and bonded pair in the pattern.
+ *
+ * Batch mode: searchdb [--threads N] --pattern '[Co]' --pattern 'n1ccccc1' [--pattern-file FILE] core.smi [exclude]
+ * Matches every pattern (or one SMARTS per line of FILE) in a single multithreaded pass over the DB,
+ * so each SMILES is parsed once.  Returns a "# SMARTS<TAB>num_hits" header per pattern, followed by its hits.
+ *
+ * Field mode: searchdb --where topology=pcu --where cat=0 --where metal=Zn --where 'linker=c1ccncc1' core.smi
+ * Returns the MOFids meeting every condition (fields are topology, cat, metal, node, and linker, where
+ * node and linker take a SMARTS to match against a component of that role).
+ *
+ * Similarity mode: searchdb --similar 'MOFID_OR_SMILES' core.smi [num_results] [fingerprint]
+ * Ranks the DB by Tanimoto similarity of building block fingerprints (ECFP4 by default),
+ * returning the top lines (25 by default) prefixed by their similarity and a tab.
+ * The fingerprints are saved to core.smi.ECFP4.mfp on the first search and reused until the DB changes.
  */
 
 #include <iostream>
+#include <iomanip>
 #include <fstream>
 #include <sstream>
+#include <utility>
+#include <vector>
+#include <stdlib.h>
 #include <openbabel/obconversion.h>
 #include <openbabel/mol.h>
 #include <openbabel/babelconfig.h>
 #include "config_sbu.h"
+#include "mof_fingerprint.h"
+#include "mofid_index.h"
+#include "smarts_batch.h"
+#include "substructure_screen.h"
 #include <cstring>
+#include <sys/stat.h>
 
 
 using namespace OpenBabel;  // See http://openbabel.org/dev-api/namespaceOpenBabel.shtml
@@ -19,11 +43,92 @@ using namespace OpenBabel;  // See http://openbabel.org/dev-api/namespaceOpenBab
 
 // Function prototypes
 std::string runSearch(std::string pattern, std::string db_file, bool reverse_search);
+std::string runSmartsFilter(const std::string &pattern, std::istream *smi, bool reverse_search);
+std::string runBatchSearch(const std::vector<std::string> &patterns, const std::string &db_file, bool reverse_search, int num_threads);
+std::string runFieldSearch(const MOFidQuery &query, const std::string &db_file);
+void loadScreenDB(const std::string &db_file, SubstructureScreenDB *db);
+std::string dbStamp(const std::string &db_file);
+std::string runSimilaritySearch(const std::string &query, const std::string &db_file, int num_results, const std::string &fp_type);
 extern "C" void runSearchc(const char *pattern, const char *db_file, bool reverse_search, char *out_file);
+extern "C" void runSimilarityc(const char *query, const char *db_file, int num_results, char *out_file);
+extern "C" void runBatchSearchc(const char *patterns, const char *db_file, bool reverse_search, char *out_file);
+
+const int DEFAULT_NUM_SIMILAR = 25;
 
 
 int main(int argc, char* argv[])
 {
+	// Set up the babel data directory to use a local copy customized for MOFs
+	// (instead of system-wide Open Babel data) for this particular program
+	setenv("BABEL_DATADIR", LOCAL_OB_DATADIR, 1);
+    // Set up the babel shared libraries
+    setenv("BABEL_LIBDIR", LOCAL_OB_LIBDIR, 1);
+
+	if (argc > 1 && std::strcmp(argv[1], "--similar") == 0) {
+		if (argc < 4) {
+			std::cerr << "Usage: searchdb --similar QUERY DB [num_results] [fingerprint]" << std::endl;
+			return 2;
+		}
+		int num_results = (argc > 4) ? atoi(argv[4]) : DEFAULT_NUM_SIMILAR;
+		std::string fp_type = (argc > 5) ? argv[5] : DEFAULT_MOF_FINGERPRINT;
+		obErrorLog.SetOutputLevel(obError);  // Some DB SMILES cannot be kekulized, which is fine for fingerprints
+		std::cout << runSimilaritySearch(argv[2], argv[3], num_results, fp_type);
+		return 0;
+	}
+
+	if (argc > 1 && std::strncmp(argv[1], "--", 2) == 0) {
+		const std::string usage = "Usage: searchdb [--threads N] --pattern SMARTS [--pattern SMARTS ...] [--pattern-file FILE] DB [exclude]\n"
+			"   or: searchdb --where FIELD=VALUE [--where FIELD=VALUE ...] DB";
+		std::vector<std::string> patterns;
+		MOFidQuery query;
+		int num_threads = defaultSearchThreads();
+		int i = 1;
+		for (; i < argc && std::strncmp(argv[i], "--", 2) == 0; ++i) {
+			std::string arg = argv[i];
+			if (i + 1 >= argc) {
+				std::cerr << usage << std::endl;
+				return 2;
+			}
+			if (arg == "--pattern") {
+				patterns.push_back(argv[++i]);
+			} else if (arg == "--pattern-file") {
+				std::ifstream pattern_file(argv[++i]);
+				if (!pattern_file) {
+					std::cerr << "Could not open pattern file " << argv[i] << std::endl;
+					return 2;
+				}
+				std::string line;
+				while (std::getline(pattern_file, line)) {
+					std::stringstream fields(line);
+					std::string smarts;
+					if (fields >> smarts && smarts[0] != '#') {  // skip blank lines and comments
+						patterns.push_back(smarts);
+					}
+				}
+			} else if (arg == "--threads") {
+				num_threads = atoi(argv[++i]);
+			} else if (arg == "--where") {
+				if (!query.AddCondition(argv[++i])) {
+					return 2;
+				}
+			} else {
+				std::cerr << usage << std::endl;
+				return 2;
+			}
+		}
+		if (i >= argc || patterns.empty() == query.Empty()) {
+			std::cerr << usage << std::endl;
+			return 2;
+		}
+		if (!query.Empty()) {
+			std::cout << runFieldSearch(query, argv[i]);
+			return 0;
+		}
+		bool exclusion_search = (i + 1 < argc && std::strcmp(argv[i + 1], "exclude") == 0);
+		std::cout << runBatchSearch(patterns, argv[i], exclusion_search, num_threads);
+		return 0;
+	}
+
 	char* pattern = argv[1];
 	char* db_file = argv[2];
 
@@ -32,16 +137,56 @@ int main(int argc, char* argv[])
 		exclusion_search = true;
 	}
 
-	// Set up the babel data directory to use a local copy customized for MOFs
-	// (instead of system-wide Open Babel data) for this particular program
-	setenv("BABEL_DATADIR", LOCAL_OB_DATADIR, 1);
-    // Set up the babel shared libraries
-    setenv("BABEL_LIBDIR", LOCAL_OB_LIBDIR, 1);
-
 	std::cout << runSearch(pattern, db_file, exclusion_search);
 }
 
 std::string runSearch(std::string pattern, std::string db_file, bool reverse_search) {
+	ScreenWord query_screen[SCREEN_WORDS];
+	if (!smartsScreen(pattern, query_screen)) {
+		// Pattern files, match counts, etc. go straight to the Open Babel filter
+		std::ifstream infile;
+		infile.open(db_file.c_str());
+		std::string results = runSmartsFilter(pattern, &infile, reverse_search);
+		infile.close();
+		return results;
+	}
+
+	SubstructureScreenDB db;
+	loadScreenDB(db_file, &db);
+
+	// Only lines passing the screen can match, so the rest skip SMILES parsing and SMARTS matching
+	std::stringstream candidates;
+	for (std::size_t i = 0; i < db.NumEntries(); ++i) {
+		if (db.Passes(i, query_screen)) {
+			candidates << db.GetLine(i) << "\n";
+		}
+	}
+	std::string filtered = runSmartsFilter(pattern, &candidates, reverse_search);
+	if (!reverse_search) {
+		return filtered;
+	}
+
+	// For an exclusion search, merge the screened out lines back in, keeping the DB order.
+	// The filtered lines are an ordered subset of the candidates.
+	std::stringstream filtered_lines(filtered);
+	std::string next_filtered;
+	bool has_filtered = static_cast<bool>(std::getline(filtered_lines, next_filtered));
+	std::stringstream out_smi;
+	for (std::size_t i = 0; i < db.NumEntries(); ++i) {
+		const std::string &line = db.GetLine(i);
+		if (!db.Passes(i, query_screen)) {
+			out_smi << line << "\n";
+		} else if (has_filtered && line == next_filtered) {
+			out_smi << line << "\n";
+			has_filtered = static_cast<bool>(std::getline(filtered_lines, next_filtered));
+		}
+	}
+	return out_smi.str();
+}
+
+std::string runSmartsFilter(const std::string &pattern, std::istream *smi, bool reverse_search) {
+	// Runs the SMARTS filter on each molecule of a .smi stream, returning the lines which match
+	// (or do not match, for a reverse search).
 	OBConversion obconv;
 	obconv.SetInFormat("smi");
 	obconv.SetOutFormat("copy");
@@ -60,11 +205,99 @@ std::string runSearch(std::string pattern, std::string db_file, bool reverse_sea
 	obconv.AddOption(search_type.c_str(), OBConversion::GENOPTIONS, pattern.c_str());
 
 	std::stringstream out_smi;
-	std::ifstream infile;
-	infile.open(db_file.c_str());
-	obconv.Convert(&infile, &out_smi);
+	obconv.Convert(smi, &out_smi);
+	return out_smi.str();
+}
+
+std::string runBatchSearch(const std::vector<std::string> &patterns, const std::string &db_file, bool reverse_search, int num_threads) {
+	// Searches db_file for all of the SMARTS patterns at once, returning a hit list per pattern
+	SmartsBatch batch(patterns);
+	SubstructureScreenDB db;
+	loadScreenDB(db_file, &db);
+	std::vector<std::vector<std::size_t> > hits = batch.Search(db, reverse_search, num_threads);
+
+	std::stringstream out_smi;
+	for (std::size_t p = 0; p < batch.NumPatterns(); ++p) {
+		if (!batch.IsValid(p)) {
+			obErrorLog.ThrowError(__FUNCTION__, batch.GetSMARTS(p) + " is not a valid SMARTS pattern", obError);
+		}
+		out_smi << "# " << batch.GetSMARTS(p) << "\t" << hits[p].size() << "\n";
+		for (std::vector<std::size_t>::iterator it=hits[p].begin(); it!=hits[p].end(); ++it) {
+			out_smi << db.GetLine(*it) << "\n";
+		}
+	}
+	return out_smi.str();
+}
+
+std::string runFieldSearch(const MOFidQuery &query, const std::string &db_file) {
+	// Searches the fields of each MOFid in db_file, returning the lines meeting every condition
+	MOFidIndex index;
+	std::ifstream infile(db_file.c_str());
+	index.Load(infile);
 	infile.close();
 
+	std::stringstream out_smi;
+	PostingList hits = index.Search(query);
+	for (PostingList::iterator it=hits.begin(); it!=hits.end(); ++it) {
+		out_smi << index.GetLine(*it) << "\n";
+	}
+	return out_smi.str();
+}
+
+void loadScreenDB(const std::string &db_file, SubstructureScreenDB *db) {
+	// Reuses the saved screens unless the DB has been modified since
+	std::string index_file = db_file + ".scr";
+	std::string stamp = dbStamp(db_file);
+	if (!db->LoadIndex(index_file, stamp)) {
+		std::ifstream infile(db_file.c_str());
+		db->Load(infile);
+		infile.close();
+		if (!db->SaveIndex(index_file, stamp)) {
+			obErrorLog.ThrowError(__FUNCTION__, "Could not save the screen index " + index_file, obWarning);
+		}
+	}
+}
+
+std::string dbStamp(const std::string &db_file) {
+	// Identifies the version of a DB for its saved indices
+	std::stringstream stamp;
+	struct stat db_info;
+	if (stat(db_file.c_str(), &db_info) == 0) {
+		stamp << db_info.st_size << " " << db_info.st_mtime;
+	}
+	return stamp.str();
+}
+
+std::string runSimilaritySearch(const std::string &query, const std::string &db_file, int num_results, const std::string &fp_type) {
+	// Ranks db_file by fingerprint similarity to the query MOFid (or SMILES of its building blocks)
+	MOFFingerprinter fingerprinter(fp_type);
+	if (!fingerprinter.IsValid()) {
+		return "";
+	}
+	FingerprintWord query_fp[MOF_FP_WORDS];
+	if (!fingerprinter.Calculate(query, query_fp)) {
+		obErrorLog.ThrowError(__FUNCTION__, "Could not parse the query " + query, obError);
+		return "";
+	}
+
+	// Reuse the saved fingerprints unless the DB has been modified since
+	MOFFingerprintDB db;
+	std::string index_file = db_file + "." + fp_type + ".mfp";
+	std::string stamp = dbStamp(db_file);
+	if (!db.LoadIndex(index_file, fp_type, stamp)) {
+		std::ifstream infile(db_file.c_str());
+		db.Load(infile, &fingerprinter);
+		infile.close();
+		if (!db.SaveIndex(index_file, fp_type, stamp)) {
+			obErrorLog.ThrowError(__FUNCTION__, "Could not save the fingerprint index " + index_file, obWarning);
+		}
+	}
+
+	std::stringstream out_smi;
+	std::vector<std::pair<double, std::size_t> > ranked = db.Rank(query_fp, (num_results > 0) ? num_results : 0);
+	for (std::vector<std::pair<double, std::size_t> >::iterator it=ranked.begin(); it!=ranked.end(); ++it) {
+		out_smi << std::fixed << std::setprecision(3) << it->first << "\t" << db.GetLine(it->second) << "\n";
+	}
 	return out_smi.str();
 }
 
@@ -75,4 +308,28 @@ void runSearchc(const char *pattern, const char *db_file, bool reverse_search, c
 	std::ofstream smip(out_file, std::ios::out | std::ios::trunc);
 	smip << runSearch(pattern, db_file, reverse_search);
 	smip.close();
+}
+
+extern "C"
+void runSimilarityc(const char *query, const char *db_file, int num_results, char *out_file) {
+	// Wrap runSimilaritySearch for Emscripten, using the default fingerprint
+	std::ofstream smip(out_file, std::ios::out | std::ios::trunc);
+	smip << runSimilaritySearch(query, db_file, num_results, DEFAULT_MOF_FINGERPRINT);
+	smip.close();
+}
+
+extern "C"
+void runBatchSearchc(const char *patterns, const char *db_file, bool reverse_search, char *out_file) {
+	// Wrap runBatchSearch for Emscripten, with one SMARTS pattern per line of patterns
+	std::vector<std::string> pattern_list;
+	std::stringstream pattern_lines(patterns);
+	std::string line;
+	while (std::getline(pattern_lines, line)) {
+		if (!line.empty()) {
+			pattern_list.push_back(line);
+		}
+	}
+	std::ofstream smip(out_file, std::ios::out | std::ios::trunc);
+	smip << runBatchSearch(pattern_list, db_file, reverse_search, 1);
+	smip.close();
 }  // extern "C"
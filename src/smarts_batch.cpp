@@ -0,0 +1,132 @@
+#include "smarts_batch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <openbabel/babelconfig.h>
+#include <openbabel/mol.h>
+#include <openbabel/obconversion.h>
+#include <openbabel/oberror.h>
+#include <openbabel/parsmart.h>
+
+namespace OpenBabel
+{
+
+namespace {
+// Entries are claimed in blocks, since line lengths (and parsing costs) vary by orders of magnitude
+const std::size_t ENTRIES_PER_BLOCK = 32;
+}  // end anonymous namespace
+
+
+SmartsBatch::SmartsBatch(const std::vector<std::string> &smarts_patterns) {
+	smarts = smarts_patterns;
+	patterns.resize(smarts.size());
+	screens.assign(smarts.size() * SCREEN_WORDS, 0);
+	for (std::size_t p = 0; p < smarts.size(); ++p) {
+		valid.push_back(patterns[p].Init(smarts[p]));
+		add_hydrogens.push_back(smarts[p].find("#1]") != std::string::npos);
+		screened.push_back(valid[p] && smartsScreen(smarts[p], &screens[p * SCREEN_WORDS]));
+	}
+}
+
+void SmartsBatch::MatchEntries(const SubstructureScreenDB *db, OBConversion *obconv, std::atomic<std::size_t> *next_entry, std::vector<char> *matches) const {
+	const std::size_t num_patterns = smarts.size();
+	std::vector<bool> passes(num_patterns);
+	while (true) {
+		std::size_t start = next_entry->fetch_add(ENTRIES_PER_BLOCK);
+		if (start >= db->NumEntries()) {
+			return;
+		}
+		std::size_t end = std::min(start + ENTRIES_PER_BLOCK, db->NumEntries());
+		for (std::size_t i = start; i < end; ++i) {
+			// Only parse the SMILES if at least one pattern survives the screen
+			bool any_passes = false;
+			bool any_hydrogens = false;
+			for (std::size_t p = 0; p < num_patterns; ++p) {
+				passes[p] = valid[p] && (!screened[p] || db->Passes(i, &screens[p * SCREEN_WORDS]));
+				any_passes = any_passes || passes[p];
+				any_hydrogens = any_hydrogens || (passes[p] && add_hydrogens[p]);
+			}
+			OBMol mol;
+			if (!any_passes || !obconv->ReadString(&mol, db->GetLine(i))) {
+				continue;
+			}
+
+			char *entry_matches = &(*matches)[i * num_patterns];
+			for (std::size_t p = 0; p < num_patterns; ++p) {
+				if (passes[p] && !add_hydrogens[p]) {
+					entry_matches[p] = patterns[p].HasMatch(mol);
+				}
+			}
+			// Like opisomorph, patterns with explicit H see the molecule with its H atoms added.
+			// They go last, since adding H changes degrees and connectivities for the others.
+			if (any_hydrogens) {
+				mol.AddHydrogens(false, false);
+				for (std::size_t p = 0; p < num_patterns; ++p) {
+					if (passes[p] && add_hydrogens[p]) {
+						entry_matches[p] = patterns[p].HasMatch(mol);
+					}
+				}
+			}
+		}
+	}
+}
+
+std::vector<std::vector<std::size_t> > SmartsBatch::Search(const SubstructureScreenDB &db, bool reverse_search, int num_threads) const {
+	const std::size_t num_patterns = smarts.size();
+	OBFormat *smi_format = OBConversion::FindFormat("smi");
+	if (!smi_format) {
+		obErrorLog.ThrowError(__FUNCTION__, "Open Babel SMILES format not found", obError);
+		return std::vector<std::vector<std::size_t> >(num_patterns);
+	}
+	// One flag per entry and pattern.  Threads write disjoint entries, so no locking is needed.
+	std::vector<char> matches(db.NumEntries() * num_patterns, 0);
+	std::atomic<std::size_t> next_entry(0);
+
+	// obErrorLog is global and unsynchronized.  Any parsing warnings for the DB entries were
+	// already reported when its screen index was built.
+	obErrorLog.StopLogging();
+#ifdef __EMSCRIPTEN__
+	num_threads = 1;  // the JS build does not enable pthreads
+#endif
+	num_threads = std::max(1, std::min(num_threads, static_cast<int>(db.NumEntries() / ENTRIES_PER_BLOCK) + 1));
+	std::deque<OBConversion> worker_convs(num_threads);  // constructed here, before the workers start
+	for (std::deque<OBConversion>::iterator it=worker_convs.begin(); it!=worker_convs.end(); ++it) {
+		it->SetInFormat(smi_format);
+	}
+	std::vector<std::thread> workers;
+	for (int t = 1; t < num_threads; ++t) {
+		workers.push_back(std::thread(&SmartsBatch::MatchEntries, this, &db, &worker_convs[t], &next_entry, &matches));
+	}
+	MatchEntries(&db, &worker_convs[0], &next_entry, &matches);  // the calling thread also works
+	for (std::vector<std::thread>::iterator it=workers.begin(); it!=workers.end(); ++it) {
+		it->join();
+	}
+	obErrorLog.StartLogging();
+
+	std::vector<std::vector<std::size_t> > hits(num_patterns);
+	for (std::size_t p = 0; p < num_patterns; ++p) {
+		if (!valid[p]) {
+			continue;
+		}
+		for (std::size_t i = 0; i < db.NumEntries(); ++i) {
+			if (static_cast<bool>(matches[i * num_patterns + p]) != reverse_search) {
+				hits[p].push_back(i);
+			}
+		}
+	}
+	return hits;
+}
+
+
+int defaultSearchThreads() {
+	unsigned int num_cpus = std::thread::hardware_concurrency();
+	return num_cpus ? static_cast<int>(num_cpus) : 1;  // 0 if unknown
+}
+
+} // end namespace OpenBabel
@@ -0,0 +1,58 @@
+/**********************************************************************
+smarts_batch.h - Many SMARTS patterns evaluated in one parallel pass over a .smi database
+***********************************************************************/
+
+#ifndef SMARTS_BATCH_H
+#define SMARTS_BATCH_H
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <openbabel/babelconfig.h>
+#include <openbabel/parsmart.h>
+
+#include "substructure_screen.h"
+
+namespace OpenBabel
+{
+// forward declarations
+class OBConversion;
+class OBMol;
+
+class SmartsBatch {
+// Compiles a list of SMARTS patterns once, then matches all of them against each database
+// molecule, so every SMILES is parsed once per batch instead of once per query.
+// Matching follows the -s option of ops/opisomorph.cpp for a plain SMARTS.
+private:
+	std::vector<std::string> smarts;
+	std::vector<OBSmartsPattern> patterns;
+	std::vector<bool> valid;
+	std::vector<bool> add_hydrogens;  // patterns with [#1] are matched after adding explicit H
+	std::vector<ScreenWord> screens;  // SCREEN_WORDS per pattern
+	std::vector<bool> screened;
+
+	// Worker loop: claims blocks of entries from next_entry until the DB is exhausted,
+	// filling NumPatterns() match flags per entry.  Each worker gets its own SMILES reader, set up by
+	// the calling thread: looking up a format by name fills Open Babel's global plugin map, and the
+	// OBConversion constructor registers its options in a static map.
+	void MatchEntries(const SubstructureScreenDB *db, OBConversion *obconv, std::atomic<std::size_t> *next_entry, std::vector<char> *matches) const;
+
+public:
+	SmartsBatch(const std::vector<std::string> &smarts_patterns);
+	std::size_t NumPatterns() const { return smarts.size(); };
+	const std::string& GetSMARTS(std::size_t pattern) const { return smarts[pattern]; };
+	bool IsValid(std::size_t pattern) const { return valid[pattern]; };
+	// Indices of the DB entries matching each pattern (or not matching, for a reverse search),
+	// in DB order.  Invalid patterns have no hits.  The DB is split across num_threads threads.
+	std::vector<std::vector<std::size_t> > Search(const SubstructureScreenDB &db, bool reverse_search, int num_threads) const;
+};
+
+int defaultSearchThreads();
+
+} // end namespace OpenBabel
+#endif // SMARTS_BATCH_H
+
+//! \file smarts_batch.h
+//! \brief smarts_batch.h - Many SMARTS patterns evaluated in one parallel pass over a .smi database
@@ -5,16 +5,33 @@
  * Modified from src/sbu.cpp, commit 05f5307ff346f2d1768b93752d836fb18270aa1e
  */
 
+/* Batch mode: sobgrep [--threads N] [--cif] --pattern SMARTS [--pattern SMARTS ...] [--pattern-file FILE] [CIFS_OR_DIRS...]
+ * Compiles the patterns once and searches many CIFs across worker threads.  CIFs are read from the
+ * listed files and directories, or from stdin (one path per line) if none are given.
+ * Writes one JSON line per structure as soon as it is searched, in completion order, e.g.
+ * {"file":"a.cif","atoms":424,"results":[{"pattern":"[Cu]","matches":2,"atoms":[[5],[9]]}]}
+ * where atoms are the 1-indexed matches of each unique hit.  --cif adds a "cif" field with the
+ * matched atoms, like the single-file output.
+ */
+
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <deque>
+#include <mutex>
 #include <queue>
+#include <thread>
 #include <vector>
 #include <map>
 #include <set>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <dirent.h>
+#endif
 #include <openbabel/obconversion.h>
 #include <openbabel/generic.h>
 #include <openbabel/atom.h>
@@ -24,22 +41,61 @@
 #include <openbabel/elements.h>
 #include <openbabel/parsmart.h>
 #include "config_sbu.h"
+#include "run_stats.h"  // jsonString
 
 
 using namespace OpenBabel;  // See http://openbabel.org/dev-api/namespaceOpenBabel.shtml
 
 
+class SobgrepBatch {
+// Shared state of the batch mode worker threads
+public:
+	std::vector<std::string> smarts;
+	std::vector<OBSmartsPattern> patterns;  // only used through the const Match, so threads can share them
+	bool write_cifs;
+	bool from_stdin;
+	std::vector<std::string> files;
+	std::size_t next_file;
+	int num_structures;
+	int num_with_matches;
+	int num_failed;
+	std::mutex input_lock;
+	std::mutex output_lock;
+	// Open Babel's CIF reader and writer fill global tables on first use: the mmcif lexer's tag lookup
+	// (CIFtagLookupTable) and the space group table (via OBUnitCell::SetSpaceGroup and GetSpaceGroup).
+	// Reading and writing CIFs is therefore serialized, while the SMARTS matching runs in parallel.
+	std::mutex cif_lock;
+};
+
+
+class SobgrepConversions {
+// Conversions owned by one worker thread.  They are set up on the main thread before the workers
+// start, since looking up a format by name fills the plugin map and constructing an OBConversion
+// registers its options in a static map.
+public:
+	OBConversion cif_reader;
+	OBConversion cif_writer;
+	bool Init();
+};
+
+
 // Function prototypes
 void local_copyAtom(OBAtom* src, OBMol* dest);
 OBMol local_initMOF(OBMol *orig_in_uc);
 OBUnitCell* local_getPeriodicLattice(OBMol *mol);
+bool initCIFReader(OBConversion *conv);
+bool readSingleBondCIF(const std::string &filename, OBConversion *cif_reader, OBMol *mol);
+std::string matchedAtomsCIF(OBMol *orig_mol, const std::set<OBAtom*> &matched_atoms, OBConversion *cif_writer, int *num_atoms);
+int runBatch(int argc, char* argv[]);
+bool addInputPath(const std::string &path, std::vector<std::string> *files);
+bool nextInput(SobgrepBatch *batch, std::string *filename);
+void batchWorker(SobgrepBatch *batch, SobgrepConversions *convs);
+std::string searchStructure(const std::string &filename, SobgrepBatch *batch, SobgrepConversions *convs, bool *found, bool *failed);
 
 
 int main(int argc, char* argv[])
 {
 	obErrorLog.SetOutputLevel(obInfo);  // See also http://openbabel.org/wiki/Errors
-	char* filename = argv[1];
-	char* pattern = argv[2];
 
     // Set up the babel data directory to use a local copy customized for MOFs
 	// (instead of system-wide Open Babel data)
@@ -56,24 +112,26 @@ int main(int argc, char* argv[])
 	setenv("BABEL_LIBDIR", LOCAL_OB_LIBDIR, 1);
 #endif
 
+	for (int arg = 1; arg < argc; ++arg) {
+		if (strncmp(argv[arg], "--", 2) == 0) {
+			return runBatch(argc, argv);
+		}
+	}
+	if (argc < 3) {
+		std::cerr << "Usage: sobgrep CIF SMARTS" << std::endl;
+		return(2);
+	}
+	char* filename = argv[1];
+	char* pattern = argv[2];
+
 	// Read CIF as single bonds
 	OBMol orig_mol;
-	OBConversion obconversion;
-	obconversion.SetInFormat("mmcif");
-	obconversion.AddOption("p", OBConversion::INOPTIONS);
-	obconversion.AddOption("s", OBConversion::INOPTIONS);
-	if (!obconversion.ReadFile(&orig_mol, filename)) {
+	OBConversion cif_reader;
+	if (!initCIFReader(&cif_reader) || !readSingleBondCIF(filename, &cif_reader, &orig_mol)) {
 		printf("Error reading file: %s", filename);
 		exit(1);
 	}
 
-	// Strip all of the original CIF labels, so they don't interfere with the automatically generated labels in the output
-	FOR_ATOMS_OF_MOL(a, orig_mol) {
-		if (a->HasData("_atom_site_label")) {
-			a->DeleteData("_atom_site_label");
-		}
-	}
-
 	int num_matches = 0;
 	std::set<OBAtom*> matched_atoms;
 	// Using example code from: http://openbabel.org/dev-api/classOpenBabel_1_1OBSmartsPattern.shtml
@@ -91,31 +149,270 @@ int main(int argc, char* argv[])
 		}
 	}
 
-	OBMol match = local_initMOF(&orig_mol);
-	match.BeginModify();
-	for (std::set<OBAtom*>::iterator it=matched_atoms.begin(); it!=matched_atoms.end(); ++it) {
-		local_copyAtom(*it, &match);
-	}
-	match.EndModify();
-	match.ConnectTheDots();
-
 	if (num_matches) {
+		int num_atoms = 0;
+		OBConversion cif_writer;
+		cif_writer.SetOutFormat("cif");
+		cif_writer.AddOption("g");
+		std::string match_cif = matchedAtomsCIF(&orig_mol, matched_atoms, &cif_writer, &num_atoms);
 		// print number of atoms and number of matches
 		std::cout << "# Found " << num_matches;
-		std::cout << " matches containing " << match.NumAtoms();
+		std::cout << " matches containing " << num_atoms;
 		std::cout << " atoms." << std::endl;
 		std::cout << "# Original file:\t" << filename << std::endl;
 		std::cout << "# Search pattern:\t" << pattern << std::endl;
+		std::cout << match_cif;
+	}
+	return(0);
+}
+
+bool initCIFReader(OBConversion *conv) {
+	// Reads CIFs as single bonds, using the mmcif format
+	if (!conv->SetInFormat("mmcif")) {
+		return false;
+	}
+	conv->AddOption("p", OBConversion::INOPTIONS);
+	conv->AddOption("s", OBConversion::INOPTIONS);
+	return true;
+}
+
+bool SobgrepConversions::Init() {
+	if (!cif_writer.SetOutFormat("cif")) {
+		return false;
+	}
+	cif_writer.AddOption("g");
+	return initCIFReader(&cif_reader);
+}
+
+bool readSingleBondCIF(const std::string &filename, OBConversion *cif_reader, OBMol *mol) {
+	// Read CIF as single bonds, with a conversion from initCIFReader
+	if (!cif_reader->ReadFile(mol, filename)) {
+		return false;
+	}
+
+	// Strip all of the original CIF labels, so they don't interfere with the automatically generated labels in the output
+	FOR_ATOMS_OF_MOL(a, *mol) {
+		if (a->HasData("_atom_site_label")) {
+			a->DeleteData("_atom_site_label");
+		}
+	}
+	return true;
+}
+
+std::string matchedAtomsCIF(OBMol *orig_mol, const std::set<OBAtom*> &matched_atoms, OBConversion *cif_writer, int *num_atoms) {
+	// Writes the matched atoms to a CIF in the original unit cell, using the cif format with option "g"
+	OBMol match = local_initMOF(orig_mol);
+	match.BeginModify();
+	FOR_ATOMS_OF_MOL(a, *orig_mol) {  // in atom order, since the set is ordered by address
+		if (matched_atoms.find(&*a) != matched_atoms.end()) {
+			local_copyAtom(&*a, &match);
+		}
+	}
+	match.EndModify();
+	match.ConnectTheDots();
+	*num_atoms = match.NumAtoms();
+
+	return cif_writer->WriteString(&match);
+}
+
+int runBatch(int argc, char* argv[]) {
+	const std::string usage = "Usage: sobgrep [--threads N] [--cif] --pattern SMARTS [--pattern SMARTS ...] [--pattern-file FILE] [CIFS_OR_DIRS...]";
+	SobgrepBatch batch;
+	batch.write_cifs = false;
+	batch.next_file = 0;
+	batch.num_structures = 0;
+	batch.num_with_matches = 0;
+	batch.num_failed = 0;
+	unsigned int num_cpus = std::thread::hardware_concurrency();
+	int num_threads = num_cpus ? num_cpus : 1;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--cif") {
+			batch.write_cifs = true;
+		} else if ((arg == "--pattern" || arg == "--pattern-file" || arg == "--threads") && i + 1 < argc) {
+			std::string value = argv[++i];
+			if (arg == "--pattern") {
+				batch.smarts.push_back(value);
+			} else if (arg == "--threads") {
+				num_threads = std::max(1, atoi(value.c_str()));
+			} else {
+				std::ifstream pattern_file(value.c_str());
+				if (!pattern_file) {
+					std::cerr << "Could not open pattern file " << value << std::endl;
+					return(2);
+				}
+				std::string line;
+				while (std::getline(pattern_file, line)) {
+					std::stringstream fields(line);
+					std::string smarts;
+					if (fields >> smarts && smarts[0] != '#') {  // skip blank lines and comments
+						batch.smarts.push_back(smarts);
+					}
+				}
+			}
+		} else if (arg.substr(0, 2) == "--") {
+			std::cerr << usage << std::endl;
+			return(2);
+		} else if (!addInputPath(arg, &batch.files)) {
+			std::cerr << "Could not read " << arg << std::endl;
+			return(2);
+		}
+	}
+	if (batch.smarts.empty()) {
+		std::cerr << usage << std::endl;
+		return(2);
+	}
+	batch.from_stdin = batch.files.empty();
+
+	// Compile each pattern once, up front
+	batch.patterns.resize(batch.smarts.size());
+	for (std::size_t p = 0; p < batch.smarts.size(); ++p) {
+		if (!batch.patterns[p].Init(batch.smarts[p])) {
+			std::cerr << "Invalid SMARTS pattern " << batch.smarts[p] << std::endl;
+			return(2);
+		}
+	}
 
-		OBConversion cifout;
-		cifout.SetOutFormat("cif");
-		cifout.AddOption("g");
-		std::cout << cifout.WriteString(&match);
+	std::deque<SobgrepConversions> worker_convs(num_threads);  // constructed here, on the main thread
+	for (std::deque<SobgrepConversions>::iterator it=worker_convs.begin(); it!=worker_convs.end(); ++it) {
+		if (!it->Init()) {
+			std::cerr << "Open Babel CIF formats not found in " << LOCAL_OB_LIBDIR << std::endl;
+			return(2);
+		}
+	}
 
+	// obErrorLog is global and unsynchronized, and CIF parsing is chatty, so per-structure
+	// messages are replaced by the "error" field of the output
+	obErrorLog.StopLogging();
+	std::vector<std::thread> workers;
+	for (int t = 1; t < num_threads; ++t) {
+		workers.push_back(std::thread(batchWorker, &batch, &worker_convs[t]));
 	}
+	batchWorker(&batch, &worker_convs[0]);  // the main thread also works
+	for (std::vector<std::thread>::iterator it=workers.begin(); it!=workers.end(); ++it) {
+		it->join();
+	}
+	obErrorLog.StartLogging();
+
+	std::cerr << batch.num_structures << " structures, " << batch.num_with_matches << " with matches, "
+		<< batch.num_failed << " failed" << std::endl;
 	return(0);
 }
 
+bool addInputPath(const std::string &path, std::vector<std::string> *files) {
+	// Adds a CIF, or all of the CIFs in a directory (sorted by name)
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0) {
+		return false;
+	}
+	if (!S_ISDIR(info.st_mode)) {
+		files->push_back(path);
+		return true;
+	}
+#ifdef _WIN32
+	std::cerr << "Directories are not supported on Windows.  List the CIFs instead." << std::endl;
+	return false;
+#else
+	DIR *dir = opendir(path.c_str());
+	if (!dir) {
+		return false;
+	}
+	std::vector<std::string> cifs;
+	for (struct dirent *entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+		std::string name = entry->d_name;
+		if (name.size() > 4 && name.substr(name.size() - 4) == ".cif") {
+			cifs.push_back(path + "/" + name);
+		}
+	}
+	closedir(dir);
+	std::sort(cifs.begin(), cifs.end());
+	files->insert(files->end(), cifs.begin(), cifs.end());
+	return true;
+#endif
+}
+
+bool nextInput(SobgrepBatch *batch, std::string *filename) {
+	// Hands out the next CIF to a worker.  Stdin is read lazily, so results stream while paths arrive.
+	std::lock_guard<std::mutex> guard(batch->input_lock);
+	if (!batch->from_stdin) {
+		if (batch->next_file >= batch->files.size()) {
+			return false;
+		}
+		*filename = batch->files[batch->next_file++];
+		return true;
+	}
+	std::string line;
+	while (std::getline(std::cin, line)) {
+		std::stringstream fields(line);
+		if (fields >> *filename) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void batchWorker(SobgrepBatch *batch, SobgrepConversions *convs) {
+	std::string filename;
+	while (nextInput(batch, &filename)) {
+		bool found = false;
+		bool failed = false;
+		std::string result = searchStructure(filename, batch, convs, &found, &failed);
+		std::lock_guard<std::mutex> guard(batch->output_lock);
+		std::cout << result << std::endl;  // flush each line for downstream consumers
+		++(batch->num_structures);
+		if (failed) {
+			++(batch->num_failed);
+		} else if (found) {
+			++(batch->num_with_matches);
+		}
+	}
+}
+
+std::string searchStructure(const std::string &filename, SobgrepBatch *batch, SobgrepConversions *convs, bool *found, bool *failed) {
+	// Matches every pattern against one CIF, returning its JSON line
+	std::stringstream json;
+	json << "{\"file\":" << jsonString(filename);
+	OBMol orig_mol;
+	*found = false;
+	{
+		std::lock_guard<std::mutex> guard(batch->cif_lock);
+		*failed = !readSingleBondCIF(filename, &convs->cif_reader, &orig_mol);
+	}
+	if (*failed) {
+		json << ",\"error\":\"Error reading file\"}";
+		return json.str();
+	}
+	json << ",\"atoms\":" << orig_mol.NumAtoms() << ",\"results\":[";
+
+	for (std::size_t p = 0; p < batch->patterns.size(); ++p) {
+		std::vector<std::vector<int> > maplist;
+		batch->patterns[p].Match(orig_mol, maplist, OBSmartsPattern::AllUnique);
+		*found = *found || !maplist.empty();
+
+		json << (p ? "," : "") << "{\"pattern\":" << jsonString(batch->smarts[p]);
+		json << ",\"matches\":" << maplist.size() << ",\"atoms\":[";
+		std::set<OBAtom*> matched_atoms;
+		for (std::vector<std::vector<int> >::iterator i=maplist.begin(); i!=maplist.end(); ++i) {
+			json << (i != maplist.begin() ? "," : "") << "[";
+			for (std::vector<int>::iterator j=i->begin(); j!=i->end(); ++j) {
+				json << (j != i->begin() ? "," : "") << *j;
+				matched_atoms.insert(orig_mol.GetAtom(*j));
+			}
+			json << "]";
+		}
+		json << "]";
+		if (batch->write_cifs && !maplist.empty()) {
+			int num_atoms = 0;
+			std::lock_guard<std::mutex> guard(batch->cif_lock);
+			json << ",\"cif\":" << jsonString(matchedAtomsCIF(&orig_mol, matched_atoms, &convs->cif_writer, &num_atoms));
+		}
+		json << "}";
+	}
+	json << "]}";
+	return json.str();
+}
+
 void local_copyAtom(OBAtom* src, OBMol* dest) {
 	// Copies properties of an atom from source to dest,
 	// without triggering hybridization, bond order detection, etc.
@@ -0,0 +1,178 @@
+#include "substructure_screen.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <fstream>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include <openbabel/babelconfig.h>
+#include <openbabel/mol.h>
+#include <openbabel/atom.h>
+#include <openbabel/bond.h>
+#include <openbabel/obiter.h>
+#include <openbabel/obconversion.h>
+#include <openbabel/parsmart.h>
+
+namespace OpenBabel
+{
+
+namespace {
+void setBit(ScreenWord *screen, int bit) {
+	screen[bit / 64] |= (1ULL << (bit % 64));
+}
+
+void setElement(ScreenWord *screen, int element) {
+	if (element >= 0 && element < SCREEN_ELEMENT_BITS) {
+		setBit(screen, element);
+	}
+}
+
+void setPair(ScreenWord *screen, int element1, int element2) {
+	// Order-independent, then spread over the pair bits with a multiplicative hash
+	unsigned long key = static_cast<unsigned long>(std::min(element1, element2)) * SCREEN_ELEMENT_BITS
+		+ std::max(element1, element2);
+	setBit(screen, SCREEN_ELEMENT_BITS + static_cast<int>((key * 2654435761UL) % SCREEN_PAIR_BITS));
+}
+}  // end anonymous namespace
+
+
+void moleculeScreen(OBMol *mol, ScreenWord *screen) {
+	std::fill(screen, screen + SCREEN_WORDS, 0);
+	FOR_ATOMS_OF_MOL(a, *mol) {
+		setElement(screen, a->GetAtomicNum());
+	}
+	FOR_BONDS_OF_MOL(b, *mol) {
+		setPair(screen, b->GetBeginAtom()->GetAtomicNum(), b->GetEndAtom()->GetAtomicNum());
+	}
+}
+
+bool smartsScreen(const std::string &smarts, ScreenWord *screen) {
+	std::fill(screen, screen + SCREEN_WORDS, 0);
+	// Only screen a plain SMARTS.  ops/opisomorph.cpp also accepts pattern files, negation with ~,
+	// and extra parameters such as match counts (<2 matches molecules without the pattern).
+	if (smarts.empty() || smarts[0] == '~' || OBConversion::FormatFromExt(smarts)) {
+		return false;
+	}
+	for (std::string::const_iterator it=smarts.begin(); it!=smarts.end(); ++it) {
+		if (isspace(static_cast<unsigned char>(*it))) {
+			return false;
+		}
+	}
+	OBSmartsPattern pattern;
+	if (!pattern.Init(smarts)) {
+		return false;
+	}
+
+	// GetAtomicNum is 0 unless every match of the atom has the same element (e.g. not [C,N] or [!C]).
+	// Hydrogens are skipped, since they are implicit in most targets.
+	for (unsigned int i = 0; i < pattern.NumAtoms(); ++i) {
+		int element = pattern.GetAtomicNum(i);
+		if (element > 1) {
+			setElement(screen, element);
+		}
+	}
+	// Every pattern bond is matched to a bond of the target, whatever its order
+	for (unsigned int i = 0; i < pattern.NumBonds(); ++i) {
+		int src, dst, order;
+		pattern.GetBond(src, dst, order, i);
+		int src_element = pattern.GetAtomicNum(src);
+		int dst_element = pattern.GetAtomicNum(dst);
+		if (src_element > 1 && dst_element > 1) {
+			setPair(screen, src_element, dst_element);
+		}
+	}
+	return true;
+}
+
+bool passesScreen(const ScreenWord *query, const ScreenWord *target) {
+	for (int w = 0; w < SCREEN_WORDS; ++w) {
+		if (query[w] & ~target[w]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+std::size_t SubstructureScreenDB::Load(std::istream &db) {
+	OBConversion obconv;
+	obconv.SetInFormat("smi");
+	std::string line;
+	ScreenWord screen[SCREEN_WORDS];
+	while (std::getline(db, line)) {
+		if (!line.empty() && line[line.size() - 1] == '\r') {
+			line.erase(line.size() - 1);
+		}
+		OBMol mol;
+		if (line.empty() || !obconv.ReadString(&mol, line)) {
+			continue;
+		}
+		moleculeScreen(&mol, screen);
+		AddEntry(line, screen);
+	}
+	return lines.size();
+}
+
+bool SubstructureScreenDB::SaveIndex(const std::string &path, const std::string &stamp) const {
+	// Same layout as the fingerprint index: text header, length-prefixed lines, then the packed screens
+	std::ofstream index(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!index) {
+		return false;
+	}
+	index << SCREEN_INDEX_VERSION << "\n" << stamp << "\n" << SCREEN_WORDS << " " << lines.size() << "\n";
+	for (std::vector<std::string>::const_iterator it=lines.begin(); it!=lines.end(); ++it) {
+		index << it->size() << "\n" << *it;
+	}
+	if (!screens.empty()) {
+		index.write(reinterpret_cast<const char*>(&screens[0]), screens.size() * sizeof(ScreenWord));
+	}
+	return index.good();
+}
+
+bool SubstructureScreenDB::LoadIndex(const std::string &path, const std::string &stamp) {
+	// Returns false, leaving the DB empty, if the index is missing, stale, or truncated
+	lines.clear();
+	screens.clear();
+	std::ifstream index(path.c_str(), std::ios::in | std::ios::binary);
+	std::string version, index_stamp;
+	int num_words = 0;
+	std::size_t num_lines = 0;
+	if (!std::getline(index, version) || !std::getline(index, index_stamp)
+			|| !(index >> num_words >> num_lines) || index.get() != '\n') {
+		return false;
+	}
+	if (version != SCREEN_INDEX_VERSION || index_stamp != stamp || num_words != SCREEN_WORDS) {
+		return false;
+	}
+
+	std::vector<std::string> index_lines;
+	for (std::size_t i = 0; i < num_lines; ++i) {
+		std::size_t length = 0;
+		if (!(index >> length) || index.get() != '\n') {
+			return false;
+		}
+		std::string line(length, '\0');
+		if (length && !index.read(&line[0], length)) {
+			return false;
+		}
+		index_lines.push_back(line);
+	}
+	std::vector<ScreenWord> index_screens(num_lines * SCREEN_WORDS);
+	if (!index_screens.empty() && !index.read(reinterpret_cast<char*>(&index_screens[0]), index_screens.size() * sizeof(ScreenWord))) {
+		return false;
+	}
+
+	lines.swap(index_lines);
+	screens.swap(index_screens);
+	return true;
+}
+
+void SubstructureScreenDB::AddEntry(const std::string &line, const ScreenWord *screen) {
+	lines.push_back(line);
+	screens.insert(screens.end(), screen, screen + SCREEN_WORDS);
+}
+
+} // end namespace OpenBabel
@@ -0,0 +1,64 @@
+/**********************************************************************
+substructure_screen.h - Bit screens to skip SMARTS matching on a .smi database
+***********************************************************************/
+
+#ifndef SUBSTRUCTURE_SCREEN_H
+#define SUBSTRUCTURE_SCREEN_H
+
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include <openbabel/babelconfig.h>
+
+namespace OpenBabel
+{
+// forward declarations
+class OBMol;
+
+typedef unsigned long long ScreenWord;
+
+// Like fastsearchformat, a molecule can only match a pattern if it has all of the pattern's
+// screen bits.  The screen records which elements and bonded element pairs are present.
+// These are the only SMARTS features which can be screened without reimplementing the matcher
+// (aromaticity, charges, H counts, etc. all have corner cases), and they are very selective
+// for MOF databases, where most queries name a metal or a heteroatom.
+const std::string SCREEN_INDEX_VERSION = "mofid-screen-v1";
+const int SCREEN_ELEMENT_BITS = 128;  // one per atomic number
+const int SCREEN_PAIR_BITS = 384;  // hashed pairs of bonded elements
+const int SCREEN_WORDS = (SCREEN_ELEMENT_BITS + SCREEN_PAIR_BITS) / 64;
+
+
+void moleculeScreen(OBMol *mol, ScreenWord *screen);
+// Bits required by any match of the SMARTS pattern, as used by the -s and -v options.
+// Returns false if the pattern cannot be screened (e.g. a pattern file or invalid SMARTS).
+bool smartsScreen(const std::string &smarts, ScreenWord *screen);
+bool passesScreen(const ScreenWord *query, const ScreenWord *target);
+
+
+class SubstructureScreenDB {
+// The readable lines of a .smi database with their screens packed into one contiguous array
+private:
+	std::vector<std::string> lines;
+	std::vector<ScreenWord> screens;  // SCREEN_WORDS per line
+
+public:
+	// Blank lines and invalid SMILES are skipped, since they can never match.
+	// Returns the number of entries.
+	std::size_t Load(std::istream &db);
+	// Binary index of the lines and screens, so later searches skip parsing the SMILES.
+	// The stamp identifies the database version (e.g. size and modification time).
+	bool SaveIndex(const std::string &path, const std::string &stamp) const;
+	bool LoadIndex(const std::string &path, const std::string &stamp);
+	void AddEntry(const std::string &line, const ScreenWord *screen);
+	std::size_t NumEntries() const { return lines.size(); };
+	const std::string& GetLine(std::size_t index) const { return lines[index]; };
+	bool Passes(std::size_t index, const ScreenWord *query) const { return passesScreen(query, &screens[index * SCREEN_WORDS]); };
+};
+
+} // end namespace OpenBabel
+#endif // SUBSTRUCTURE_SCREEN_H
+
+//! \file substructure_screen.h
+//! \brief substructure_screen.h - Bit screens to skip SMARTS matching on a .smi database
@@ -0,0 +1,64 @@
+// Replicates a CIF into an NA x NB x NC supercell, written as a P1 CIF without bonds.
+// Used by tests/check_scaling.py to build series of large cells from Resources/TestCIFs,
+// since sbu runs its own bond detection on the result anyway.
+//
+// Usage: bin/supercell CIF NA NB NC OUTPUT_CIF
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <stdlib.h>
+
+#include <openbabel/mol.h>
+#include <openbabel/babelconfig.h>
+
+#include "config_sbu.h"
+#include "framework.h"
+
+
+using namespace OpenBabel;  // See http://openbabel.org/dev-api/namespaceOpenBabel.shtml
+
+
+bool parseRepeat(const std::string &arg, int *repeat) {
+	// Parses a positive number of unit cell repeats
+	std::stringstream parser(arg);
+	return (parser >> *repeat) && parser.eof() && *repeat > 0;
+}
+
+
+int main(int argc, char* argv[])
+{
+	obErrorLog.SetOutputLevel(obError);  // bond detection warnings about the input are irrelevant here
+
+	const std::string usage = "Usage: supercell CIF NA NB NC OUTPUT_CIF";
+	if (argc != 6) {
+		std::cerr << usage << std::endl;
+		return(2);
+	}
+	int repeats[3];
+	for (int i = 0; i < 3; ++i) {
+		if (!parseRepeat(argv[i + 2], &repeats[i])) {
+			std::cerr << "Invalid number of repeats: " << argv[i + 2] << std::endl << usage << std::endl;
+			return(2);
+		}
+	}
+
+#ifdef _WIN32
+	_putenv_s("BABEL_DATADIR", LOCAL_OB_DATADIR);
+	_putenv_s("BABEL_LIBDIR", LOCAL_OB_LIBDIR);
+#else
+	setenv("BABEL_DATADIR", LOCAL_OB_DATADIR, 1);
+	setenv("BABEL_LIBDIR", LOCAL_OB_LIBDIR, 1);
+#endif
+
+	// Same import as sbu, so the replicated cell is the full P1 unit cell
+	OBMol orig_mol;
+	if (!importCIF(&orig_mol, argv[1], false)) {
+		std::cerr << "Error reading file: " << argv[1] << std::endl;
+		return(1);
+	}
+	OBMol supercell = makeSupercell(&orig_mol, repeats[0], repeats[1], repeats[2]);
+	writeCIF(&supercell, argv[5], false);
+	std::cerr << "Wrote " << supercell.NumAtoms() << " atoms to " << argv[5] << std::endl;
+	return(0);
+}
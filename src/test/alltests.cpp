@@ -3,6 +3,18 @@
 #include "config_sbu.h"
 #include "obdetailstest.cpp"
 #include "invectortest.cpp"
+#include "scratcharenatest.cpp"
+#include "cifcomparetest.cpp"
+#include "runstatstest.cpp"
+#include "traceeventstest.cpp"
+#include "fragmenthashtest.cpp"
+#include "fragmentcachetest.cpp"
+#include "deconstructortest.cpp"
+#include "dedupindextest.cpp"
+#include "moffingerprinttest.cpp"
+#include "substructurescreentest.cpp"
+#include "smartsbatchtest.cpp"
+#include "mofidindextest.cpp"
 
 int main(int argc, char** argv) {
 #ifdef _WIN32
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "cif_compare.h"
+
+namespace CifCompareTest {
+    std::string writeFile(const std::string& name, const std::string& contents) {
+        std::string path{testing::TempDir() + name};
+        std::ofstream file{path};
+        file << contents;
+        return path;
+    }
+
+    // The first three nodes of the UiO-66 net from sbu, in two different orders and periodic images
+    const std::string UIO_NET{
+        "# CGD file generated by Open Babel 2.4.90, see http://openbabel.sf.net\n"
+        "CRYSTAL\n  NAME \n  GROUP P1\n  CELL 20.7004 20.7004 20.7004 90 90 90\n"
+        "  NODE 1 12 0.5 -6.16298e-33 0.5\n  NODE 2 12 0.5 0.5 0\n  NODE 3 12 0 0 0\n"
+        "  EDGE  0 0 1   0.5 -6.16298e-33 0.5\n  EDGE  0 0 0   0.5 0.5 0\nEND\n"};
+    const std::string SHIFTED_NET{
+        "# CGD file generated by Open Babel 3.1.0, see http://openbabel.sf.net\n"
+        "CRYSTAL\n  NAME \n  GROUP P1\n  CELL 20.7004 20.7004 20.7004 90 90 90\n"
+        "  NODE 1 12 0 0 0\n  NODE 2 12 0.5 0.5 1\n  NODE 3 12 0.5 0 0.5\n"
+        "  EDGE  0.5 0.5 1   0 0 1\n  EDGE  0.5 0 1.5   0 0 2\nEND\n"};
+}
+
+using namespace CifCompareTest;
+
+TEST(CifCompareTest, MatchesNetsUpToNumberingAndLatticeShifts) {
+    const std::string known{writeFile("mofid_known.cgd", UIO_NET)};
+    const std::string shifted{writeFile("mofid_shifted.cgd", SHIFTED_NET)};
+    CGDNet net{};
+    ASSERT_TRUE(readCGD(known, net));
+    EXPECT_EQ(1u, net.cells.size());
+    EXPECT_EQ(3u, net.nodes.size());
+    EXPECT_EQ(2u, net.edges.size());
+    EXPECT_TRUE(areCGDsSame(known, shifted, DEFAULT_FRACTIONAL_TOLERANCE));
+
+    std::string moved{SHIFTED_NET};
+    moved.replace(moved.find("0 0 2"), 5, "0 1 2");  // a different edge
+    const std::string movedPath{writeFile("mofid_moved.cgd", moved)};
+    EXPECT_FALSE(areCGDsSame(known, movedPath, DEFAULT_FRACTIONAL_TOLERANCE));
+    std::remove(known.c_str());
+    std::remove(shifted.c_str());
+    std::remove(movedPath.c_str());
+}
+
+TEST(CifCompareTest, ComparesLinesAsMultisets) {
+    const std::string first{writeFile("mofid_lines1.txt", "InChI=1S/B\nInChI=1S/A\nInChI=1S/A\n")};
+    const std::string reordered{writeFile("mofid_lines2.txt", "InChI=1S/A\r\nInChI=1S/B\r\nInChI=1S/A\r\n\n")};
+    const std::string fewer{writeFile("mofid_lines3.txt", "InChI=1S/A\nInChI=1S/B\n")};
+    EXPECT_TRUE(areLineSetsSame(first, reordered));
+    EXPECT_FALSE(areLineSetsSame(first, fewer));
+    EXPECT_TRUE(hasSuffix("SingleNode/topology.cgd", ".cgd"));
+    EXPECT_FALSE(hasSuffix("cgd", ".cgd"));
+    std::remove(first.c_str());
+    std::remove(reordered.c_str());
+    std::remove(fewer.c_str());
+}
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "deconstructor.h"
+#include "framework.h"
+#include "virtual_mol.h"
+
+#include <openbabel/obconversion.h>
+#include <openbabel/mol.h>
+
+namespace DeconstructorTest {
+    class LinkerDeconstructor : public OpenBabel::MetalOxoDeconstructor {
+    // Exposes the linker fragments that GetMOFInfo and GetMOFkey export
+    public:
+        LinkerDeconstructor(OpenBabel::OBMol* orig_mof) : OpenBabel::MetalOxoDeconstructor(orig_mof) {}
+        std::vector<OpenBabel::VirtualMol> LinkerFragments() {
+            return simplified_net.PseudoToOrig(simplified_net.GetAtomsOfRole("linker")).Separate();
+        }
+        static void InitInChI(OpenBabel::OBConversion* conv) { InitInChIConversion(conv, "inchi"); }
+    };
+
+    void expectDedupMatchesEachExport(const std::string& cif, const std::set<std::string>& linker_smiles) {
+        // The batch has to export every linker exactly like exporting each fragment on its own
+        OpenBabel::OBMol mof{};
+        ASSERT_TRUE(OpenBabel::importCIF(&mof, std::string{MOFID_TEST_RESOURCES} + "/" + cif, false));
+        LinkerDeconstructor simplifier{&mof};
+        simplifier.SimplifyMOF(false);
+        std::vector<OpenBabel::VirtualMol> fragments{simplifier.LinkerFragments()};
+
+        OpenBabel::OBConversion smiles_conv{};  // same as Deconstructor::InitOutputFormat
+        smiles_conv.SetOutFormat("can");
+        smiles_conv.AddOption("i");
+        OpenBabel::OBConversion inchi_conv{};
+        LinkerDeconstructor::InitInChI(&inchi_conv);
+        std::vector<OpenBabel::OBConversion*> convs{&smiles_conv, &inchi_conv};
+
+        OpenBabel::FragmentExportBatch batch{convs};
+        for (std::size_t i = 0; i < fragments.size(); ++i) {
+            batch.AddFragment(fragments[i]);
+        }
+        EXPECT_LT(batch.NumDistinct(), batch.NumFragments());
+
+        std::set<std::string> exported_smiles{};
+        for (std::size_t i = 0; i < fragments.size(); ++i) {
+            std::vector<std::string> expected{OpenBabel::exportNormalizedMol(fragments[i], convs)};
+            EXPECT_EQ(expected, batch.GetOutputs(i));
+            exported_smiles.insert(expected[0].substr(0, expected[0].find('\t')));
+        }
+        EXPECT_EQ(linker_smiles, exported_smiles);
+    }
+}
+
+using namespace DeconstructorTest;
+
+TEST(FragmentExportBatchTest, KeepsMOF802RadicalSites) {
+    // Symmetry copies of the pyrazolate linker differ in where bond perception places the radical
+    expectDedupMatchesEachExport("KnownCIFs/07_MOF-802.cif", {
+        "[O-]C(=O)C1=NN=C([CH]1)C(=O)[O-]",
+        "[O-]C(=O)C1=N[N]C(=C1)C(=O)[O-]",
+        "[O-]C(=O)[C]1N=NC(=C1)C(=O)[O-]"
+    });
+}
+
+TEST(FragmentExportBatchTest, KeepsZIF69BondOrders) {
+    // Imidazolate copies with slightly different geometries are assigned different bond orders
+    expectDedupMatchesEachExport("TestCIFs/ZIF-69-RASPA.cif", {
+        "Clc1ccc2c(c1)N=C[N]2",
+        "Clc1ccc2c(c1)[N]C=N2",
+        "O=N(=O)C1=NC=C[N]1",
+        "O=N(=O)C1=N[CH]C=N1"
+    });
+}
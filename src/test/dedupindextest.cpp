@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+#include <string>
+
+#include "dedup_index.h"
+
+TEST(DedupIndexTest, GroupsByKey) {
+    OpenBabel::DedupIndex index{};
+    bool is_new{false};
+    EXPECT_EQ(1, index.Add("IRMOF-1", "Zn.KKEYFWRCBNTPAC.MOFkey-v1", &is_new).id);
+    EXPECT_TRUE(is_new);
+    EXPECT_EQ(2, index.Add("HKUST-1", "Cu.QMKYBPDZANOJGF.MOFkey-v1", &is_new).id);
+    EXPECT_TRUE(is_new);
+
+    const OpenBabel::DedupGroup& dup{index.Add("IRMOF-1_copy", "Zn.KKEYFWRCBNTPAC.MOFkey-v1", &is_new)};
+    EXPECT_FALSE(is_new);
+    EXPECT_EQ(1, dup.id);
+    EXPECT_EQ("IRMOF-1", dup.representative);  // first structure seen represents the group
+    EXPECT_EQ(2, dup.size);
+
+    EXPECT_EQ(3u, index.NumEntries());
+    EXPECT_EQ(2u, index.NumGroups());
+    EXPECT_EQ(1u, index.NumDuplicates());
+}
+
+TEST(DedupIndexTest, FindsOnlySeenKeys) {
+    OpenBabel::DedupIndex index{};
+    EXPECT_EQ(nullptr, index.Find("Zn.KKEYFWRCBNTPAC.MOFkey-v1"));
+    index.Add("IRMOF-1", "Zn.KKEYFWRCBNTPAC.MOFkey-v1");
+    ASSERT_NE(nullptr, index.Find("Zn.KKEYFWRCBNTPAC.MOFkey-v1"));
+    EXPECT_EQ("IRMOF-1", index.Find("Zn.KKEYFWRCBNTPAC.MOFkey-v1")->representative);
+    EXPECT_EQ(0u, index.NumDuplicates());
+}
+
+TEST(DedupIndexTest, NearDuplicateKeyDropsCatenationAndTopology) {
+    EXPECT_EQ("Zn.KKEYFWRCBNTPAC.MOFkey-v1", OpenBabel::nearDuplicateKey("Zn.KKEYFWRCBNTPAC.MOFkey-v1 cat1"));
+    EXPECT_EQ("Zn.KKEYFWRCBNTPAC.MOFkey-v1", OpenBabel::nearDuplicateKey("Zn.KKEYFWRCBNTPAC.MOFkey-v1.pcu.NO_REF"));
+    EXPECT_EQ("[Zn].[O-]C(=O)c1ccc(cc1)C(=O)[O-]",
+              OpenBabel::nearDuplicateKey("[Zn].[O-]C(=O)c1ccc(cc1)C(=O)[O-] MOFid-v1.pcu.cat0;IRMOF-1"));
+    EXPECT_EQ("[Zn].[O-]C(=O)c1ccc(cc1)C(=O)[O-]", OpenBabel::nearDuplicateKey("[Zn].[O-]C(=O)c1ccc(cc1)C(=O)[O-] cat0"));
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <ctime>
+#include <sstream>
+#include <string>
+
+#include "fragment_cache.h"
+#include "fragment_hash.h"
+
+#include <openbabel/obconversion.h>
+#include <openbabel/mol.h>
+
+namespace FragmentCacheTest {
+    std::string cacheDir(const std::string& name) {
+        // Each test gets a fresh directory, so entries from earlier test runs are not hits
+        std::stringstream path{};
+        path << testing::TempDir() << name << "_" << std::time(nullptr) << "_" << std::rand();
+        return path.str();
+    }
+
+    OpenBabel::FragmentInvariant graphFromSMILES(const std::string& SMILES) {
+        std::stringstream ss{SMILES};
+        OpenBabel::OBConversion conv{&ss};
+        conv.SetInFormat("SMI");
+        OpenBabel::OBMol mol{};
+        conv.Read(&mol);
+        return OpenBabel::FragmentInvariant{mol};
+    }
+
+    std::string smilesConversionKey() {
+        OpenBabel::OBConversion conv{};
+        conv.SetOutFormat("can");
+        conv.AddOption("i");
+        return OpenBabel::FragmentCache::GetConversionKey(conv);
+    }
+}
+
+using namespace FragmentCacheTest;
+
+TEST(FragmentCacheTest, PersistsAcrossRuns) {
+    const std::string dir{cacheDir("mofid_fragment_cache_persist")};
+    OpenBabel::FragmentInvariant fragment{graphFromSMILES("[O-]C(=O)c1ccc(cc1)C(=O)[O-]")};
+    const std::string conv{smilesConversionKey()};
+    const std::string smiles{"[O-]C(=O)c1ccc(cc1)C(=O)[O-]\t\n"};
+    {
+        OpenBabel::FragmentCache cache{};
+        ASSERT_TRUE(cache.Open(dir));
+        std::string value{};
+        EXPECT_FALSE(cache.Lookup(fragment, conv, &value));
+        cache.Store(fragment, conv, smiles);
+        EXPECT_TRUE(cache.Lookup(fragment, conv, &value));
+        EXPECT_EQ(smiles, value);
+    }
+    OpenBabel::FragmentCache reopened{};
+    ASSERT_TRUE(reopened.Open(dir));
+    std::string value{};
+    EXPECT_TRUE(reopened.Lookup(fragment, conv, &value));
+    EXPECT_EQ(smiles, value);  // tabs and newlines survive the round trip
+}
+
+TEST(FragmentCacheTest, KeysOnConversionAndGraph) {
+    const std::string dir{cacheDir("mofid_fragment_cache_keys")};
+    OpenBabel::FragmentInvariant fragment{graphFromSMILES("CCCO")};
+    const std::string conv{smilesConversionKey()};
+    OpenBabel::OBConversion inchi{};
+    inchi.SetOutFormat("inchi");
+    const std::string inchi_conv{OpenBabel::FragmentCache::GetConversionKey(inchi)};
+    OpenBabel::FragmentCache cache{};
+    ASSERT_TRUE(cache.Open(dir));
+    cache.Store(fragment, conv, "CCCO\t\n");
+    std::string value{};
+    EXPECT_FALSE(cache.Lookup(fragment, inchi_conv, &value));
+    EXPECT_FALSE(cache.Lookup(graphFromSMILES("CC(O)C"), conv, &value));
+}
+
+TEST(FragmentCacheTest, RejectsCollidingGraphs) {
+    // A 6-ring and two 3-rings share a graph hash, so their entries share a file
+    const std::string dir{cacheDir("mofid_fragment_cache_collision")};
+    const std::string conv{smilesConversionKey()};
+    OpenBabel::FragmentCache cache{};
+    ASSERT_TRUE(cache.Open(dir));
+    cache.Store(graphFromSMILES("C1CCCCC1"), conv, "C1CCCCC1\t\n");
+    std::string value{};
+    EXPECT_FALSE(cache.Lookup(graphFromSMILES("C1CC1.C1CC1"), conv, &value));
+    EXPECT_TRUE(cache.Lookup(graphFromSMILES("C1CCCCC1"), conv, &value));
+}
+
+TEST(FragmentCacheTest, ClosedCacheStoresNothing) {
+    OpenBabel::FragmentInvariant fragment{graphFromSMILES("CO")};
+    const std::string conv{smilesConversionKey()};
+    OpenBabel::FragmentCache cache{};
+    EXPECT_FALSE(cache.IsOpen());
+    cache.Store(fragment, conv, "value");
+    std::string value{};
+    EXPECT_FALSE(cache.Lookup(fragment, conv, &value));
+}
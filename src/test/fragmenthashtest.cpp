@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "fragment_hash.h"
+
+#include <openbabel/obconversion.h>
+#include <openbabel/obiter.h>
+#include <openbabel/mol.h>
+
+namespace FragmentHashTest {
+    OpenBabel::OBMol molFromSMILES(const std::string& SMILES) {
+        std::stringstream ss{SMILES};
+        OpenBabel::OBConversion conv{&ss};
+        conv.SetInFormat("SMI");
+        OpenBabel::OBMol mol{};
+        conv.Read(&mol);
+        return mol;
+    }
+
+    OpenBabel::OBMol reversedAtoms(const OpenBabel::OBMol& mol) {
+        OpenBabel::OBMol reversed{mol};
+        std::vector<OpenBabel::OBAtom*> order{};
+        FOR_ATOMS_OF_MOL(a, reversed)
+            order.insert(order.begin(), &*a);
+        reversed.RenumberAtoms(order);
+        return reversed;
+    }
+}
+
+using namespace FragmentHashTest;
+
+TEST(FragmentInvariantTest, IgnoresAtomOrder) {
+    OpenBabel::OBMol forward{molFromSMILES("OC(=O)c1ccc(cc1)C(=O)O")};
+    OpenBabel::OBMol reordered{molFromSMILES("c1cc(ccc1C(O)=O)C(=O)O")};
+    OpenBabel::FragmentInvariant a{forward};
+    OpenBabel::FragmentInvariant b{reordered};
+    EXPECT_EQ(a.GetKey(), b.GetKey());
+    EXPECT_TRUE(a.Matches(b));
+}
+
+TEST(FragmentInvariantTest, MatchesSymmetricGraphs) {
+    // Cubane leaves every atom in one class, so Matches has to search for the isomorphism
+    OpenBabel::OBMol cubane{molFromSMILES("C12C3C4C1C5C2C3C45")};
+    OpenBabel::FragmentInvariant a{cubane};
+    OpenBabel::FragmentInvariant b{reversedAtoms(cubane)};
+    EXPECT_EQ(a.GetKey(), b.GetKey());
+    EXPECT_TRUE(a.Matches(b));
+}
+
+TEST(FragmentInvariantTest, DistinguishesIsomers) {
+    OpenBabel::OBMol propanol{molFromSMILES("CCCO")};
+    OpenBabel::OBMol isopropanol{molFromSMILES("CC(O)C")};
+    OpenBabel::FragmentInvariant a{propanol};
+    OpenBabel::FragmentInvariant b{isopropanol};
+    EXPECT_EQ(a.GetFormula(), b.GetFormula());
+    EXPECT_NE(a.GetHash(), b.GetHash());
+    EXPECT_FALSE(a.Matches(b));
+}
+
+TEST(FragmentInvariantTest, DistinguishesRadicalSites) {
+    // Bond perception places the radical of the H-free pyrazolate in MOF-802 by atom order and geometry
+    OpenBabel::OBMol carbon_radical{molFromSMILES("[O-]C(=O)C1=NN=C([CH]1)C(=O)[O-]")};
+    OpenBabel::OBMol nitrogen_radical{molFromSMILES("[O-]C(=O)C1=N[N]C(=C1)C(=O)[O-]")};
+    OpenBabel::FragmentInvariant a{carbon_radical};
+    OpenBabel::FragmentInvariant b{nitrogen_radical};
+    EXPECT_EQ(a.GetFormula(), b.GetFormula());
+    EXPECT_NE(a.GetKey(), b.GetKey());
+    EXPECT_FALSE(a.Matches(b));
+}
+
+TEST(FragmentInvariantTest, MatchesOnlyIsomorphicGraphs) {
+    // Color refinement cannot tell a 6-ring from two 3-rings, but the isomorphism check can
+    OpenBabel::OBMol hexagon{molFromSMILES("C1CCCCC1")};
+    OpenBabel::OBMol triangles{molFromSMILES("C1CC1.C1CC1")};
+    OpenBabel::FragmentInvariant a{hexagon};
+    OpenBabel::FragmentInvariant b{triangles};
+    EXPECT_EQ(a.GetKey(), b.GetKey());
+    EXPECT_FALSE(a.Matches(b));
+}
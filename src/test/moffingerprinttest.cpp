@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+#include "mof_fingerprint.h"
+
+TEST(MOFidPartsTest, SplitsMOFidFields) {
+    OpenBabel::MOFidParts parts{"[Co].[O-]C(=O)c1ccncc1 MOFid-v1.rtl.cat0;ABAVIJ_clean"};
+    ASSERT_EQ(2u, parts.fragments.size());
+    EXPECT_EQ("[Co]", parts.fragments[0]);
+    EXPECT_EQ("[O-]C(=O)c1ccncc1", parts.fragments[1]);
+    EXPECT_EQ("rtl", parts.topology);
+    EXPECT_EQ(0, parts.catenation);
+    EXPECT_EQ("ABAVIJ_clean", parts.name);
+
+    OpenBabel::MOFidParts bare{"[Zn][O]([Zn])([Zn])[Zn]"};
+    EXPECT_EQ(1u, bare.fragments.size());
+    EXPECT_EQ("", bare.topology);
+    EXPECT_EQ(-1, bare.catenation);
+}
+
+TEST(MOFFingerprintTest, RanksSharedBuildingBlocks) {
+    OpenBabel::MOFFingerprinter fingerprinter{};
+    ASSERT_TRUE(fingerprinter.IsValid());
+    const std::string irmof1{"[O-]C(=O)c1ccc(cc1)C(=O)[O-].[Zn][O]([Zn])([Zn])[Zn] MOFid-v1.pcu.cat0;IRMOF-1"};
+    OpenBabel::FingerprintWord query[OpenBabel::MOF_FP_WORDS];
+    ASSERT_TRUE(fingerprinter.Calculate(irmof1, query));
+    EXPECT_DOUBLE_EQ(1.0, OpenBabel::tanimoto(query, query));
+
+    std::stringstream db{
+        "[Cu][Cu].[O-]C(=O)c1cc(cc(c1)C(=O)[O-])C(=O)[O-] MOFid-v1.tbo.cat0;HKUST-1\n"
+        "[O-]C(=O)c1ccc(cc1)C(=O)[O-].[Zn][O]([Zn])([Zn])[Zn] MOFid-v1.pcu.cat1;IRMOF-1_interpenetrated\n"
+        "\n"
+        + irmof1 + "\n"};
+    OpenBabel::MOFFingerprintDB fp_db{};
+    EXPECT_EQ(3u, fp_db.Load(db, &fingerprinter));
+    EXPECT_EQ(4u, fingerprinter.NumCachedFragments());  // the Zn4O node and BDC linker are reused
+
+    auto ranked = fp_db.Rank(query, 2);
+    ASSERT_EQ(2u, ranked.size());
+    EXPECT_EQ(2u, ranked[0].second);  // exact match first
+    EXPECT_DOUBLE_EQ(1.0, ranked[0].first);
+    EXPECT_EQ(1u, ranked[1].second);  // then the same building blocks with a different catenation
+    EXPECT_LT(ranked[1].first, 1.0);
+    EXPECT_GT(ranked[1].first, 0.9);
+}
+
+TEST(MOFFingerprintTest, IndexRoundTrip) {
+    OpenBabel::MOFFingerprinter fingerprinter{};
+    std::stringstream db{
+        "[Co].[O-]C(=O)c1ccncc1 MOFid-v1.rtl.cat0;ABAVIJ_clean\n"
+        "[Cu][Cu].[O-]C(=O)c1cc(cc(c1)C(=O)[O-])C(=O)[O-] MOFid-v1.tbo.cat0;HKUST-1\n"};
+    OpenBabel::MOFFingerprintDB fp_db{};
+    fp_db.Load(db, &fingerprinter);
+    const std::string path{testing::TempDir() + "mofid_fingerprint_index.mfp"};
+    ASSERT_TRUE(fp_db.SaveIndex(path, "ECFP4", "123 456"));
+
+    OpenBabel::MOFFingerprintDB stale{};
+    EXPECT_FALSE(stale.LoadIndex(path, "ECFP4", "124 456"));  // DB was modified
+    EXPECT_FALSE(stale.LoadIndex(path, "FP2", "123 456"));
+    EXPECT_EQ(0u, stale.NumEntries());
+
+    OpenBabel::MOFFingerprintDB loaded{};
+    ASSERT_TRUE(loaded.LoadIndex(path, "ECFP4", "123 456"));
+    ASSERT_EQ(2u, loaded.NumEntries());
+    EXPECT_EQ(fp_db.GetLine(1), loaded.GetLine(1));
+    OpenBabel::FingerprintWord query[OpenBabel::MOF_FP_WORDS];
+    fingerprinter.Calculate(fp_db.GetLine(1), query);
+    EXPECT_EQ(fp_db.Rank(query, 2), loaded.Rank(query, 2));
+    std::remove(path.c_str());
+}
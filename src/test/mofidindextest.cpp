@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "mofid_index.h"
+
+TEST(MOFidIndexTest, FindsBracketMetals) {
+    EXPECT_EQ((std::vector<int>{29}), OpenBabel::smilesMetals("[Cu][Cu]"));
+    EXPECT_EQ((std::vector<int>{27, 30}), OpenBabel::smilesMetals("[Zn+2].[63Co]O[Zn]"));
+    EXPECT_TRUE(OpenBabel::smilesMetals("[O-]C(=O)c1ccncc1.[nH]1cc[se]c1").empty());
+}
+
+TEST(MOFidIndexTest, SplitsFieldsIntoColumns) {
+    std::stringstream db{
+        "[Co].[O-]C(=O)c1ccncc1 MOFid-v1.rtl.cat0;ABAVIJ_clean\n"
+        "[Cu][Cu].[O-]C(=O)c1cc(cc(c1)C(=O)[O-])C(=O)[O-] MOFid-v1.tbo.cat0;HKUST-1\n"
+        "[O-]C(=O)c1ccc(cc1)C(=O)[O-].[Zn][O]([Zn])([Zn])[Zn] MOFid-v1.pcu.cat0;IRMOF-1\n"
+        "[O-]C(=O)c1ccc(cc1)C(=O)[O-].[Zn][O]([Zn])([Zn])[Zn] MOFid-v1.pcu.cat1;IRMOF-1_interpenetrated\n"
+        "\n"
+        "[O-]C(=O)c1ccncc1.[Zn][Zn] MOFid-v1.nbo,pcu-h.cat0;mixed\n"};
+    OpenBabel::MOFidIndex index{};
+    ASSERT_EQ(5u, index.Load(db));
+    EXPECT_EQ(7u, index.NumComponents());  // the BDC linker and Zn4O node are shared
+
+    OpenBabel::MOFidQuery query{};
+    EXPECT_TRUE(query.Empty());
+    ASSERT_TRUE(query.AddCondition("topology=pcu"));
+    EXPECT_EQ((OpenBabel::PostingList{2, 3}), index.Search(query));
+    ASSERT_TRUE(query.AddCondition("cat=cat0"));
+    ASSERT_TRUE(query.AddCondition("metal=Zn"));
+    EXPECT_EQ((OpenBabel::PostingList{2}), index.Search(query));
+    ASSERT_TRUE(query.AddCondition("linker=c1ccncc1"));  // pcu, but not with this linker
+    EXPECT_TRUE(index.Search(query).empty());
+
+    OpenBabel::MOFidQuery linker_query{};
+    ASSERT_TRUE(linker_query.AddCondition("linker=c1ccncc1"));
+    EXPECT_EQ((OpenBabel::PostingList{0, 4}), index.Search(linker_query));
+    ASSERT_TRUE(linker_query.AddCondition("topology=pcu-h"));  // secondary topologies are indexed too
+    EXPECT_EQ((OpenBabel::PostingList{4}), index.Search(linker_query));
+    EXPECT_EQ("[O-]C(=O)c1ccncc1.[Zn][Zn] MOFid-v1.nbo,pcu-h.cat0;mixed", index.GetLine(4));
+
+    OpenBabel::MOFidQuery node_query{};
+    ASSERT_TRUE(node_query.AddCondition("node=[Zn]O"));  // node SMARTS never see the linkers
+    EXPECT_EQ((OpenBabel::PostingList{2, 3}), index.Search(node_query));
+    OpenBabel::MOFidQuery metal_linker{};
+    ASSERT_TRUE(metal_linker.AddCondition("linker=[Cu]"));
+    EXPECT_TRUE(index.Search(metal_linker).empty());
+}
+
+TEST(MOFidIndexTest, RejectsBadConditions) {
+    OpenBabel::MOFidQuery query{};
+    EXPECT_FALSE(query.AddCondition("pcu"));
+    EXPECT_FALSE(query.AddCondition("color=green"));
+    EXPECT_FALSE(query.AddCondition("metal=C"));
+    EXPECT_FALSE(query.AddCondition("cat=x"));
+    EXPECT_TRUE(query.Empty());
+}
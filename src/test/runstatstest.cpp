@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include <string>
+
+#include "run_stats.h"
+
+using OpenBabel::RunStats;
+using OpenBabel::RunStatsScope;
+using OpenBabel::StageTimer;
+using OpenBabel::countStat;
+
+TEST(RunStatsTest, AccumulatesInFirstSeenOrder) {
+    RunStats stats{};
+    stats.AddTime("CollapseNodes", 1.5);
+    stats.AddTime("CollapseLinkers", 0.25);
+    stats.AddTime("CollapseNodes", 0.5);
+    stats.Count("fragments", 3);
+    stats.Count("fragments");
+    EXPECT_DOUBLE_EQ(2.0, stats.GetTime("CollapseNodes"));
+    EXPECT_EQ(4, stats.GetCount("fragments"));
+    EXPECT_EQ(0, stats.GetCount("missing"));
+    EXPECT_EQ("{\"stages\":{\"CollapseNodes\":2,\"CollapseLinkers\":0.25},\"memory_kb\":{},\"counters\":{\"fragments\":4}}",
+              stats.ToJSON());
+}
+
+TEST(RunStatsTest, TracksPeakMemoryPerStage) {
+    RunStats stats{};
+    stats.AddMemory("CollapseNodes", 2000, 300);
+    stats.AddMemory("CollapseNodes", 1500, 200);
+    EXPECT_EQ(500, stats.GetPeakGrowth("CollapseNodes"));
+    EXPECT_EQ("{\"stages\":{\"CollapseNodes\":0},\"memory_kb\":{\"CollapseNodes\":{\"peak\":2000,\"growth\":500}},\"counters\":{}}",
+              stats.ToJSON());
+#ifdef __linux__
+    EXPECT_GT(OpenBabel::currentRSSKB(), 0);
+    EXPECT_GE(OpenBabel::peakRSSKB(), OpenBabel::currentRSSKB());
+#endif
+}
+
+TEST(RunStatsTest, ScopesRecordIntoCurrentStats) {
+    RunStats outer{};
+    RunStats inner{};
+    countStat("ignored");  // no current stats
+    {
+        RunStatsScope outer_scope{&outer};
+        countStat("atoms", 10);
+        {
+            RunStatsScope inner_scope{&inner};
+            StageTimer timer{"SimplifyTopology"};
+            countStat("simplification_passes");
+        }
+        {
+            RunStatsScope disabled{nullptr};
+            countStat("atoms");
+        }
+        countStat("atoms");
+    }
+    EXPECT_EQ(nullptr, RunStats::Current());
+    EXPECT_EQ(11, outer.GetCount("atoms"));
+    EXPECT_EQ(1, inner.GetCount("simplification_passes"));
+    EXPECT_EQ(0, inner.GetCount("atoms"));
+    EXPECT_NE(std::string::npos, inner.ToJSON().find("\"SimplifyTopology\":"));
+    EXPECT_EQ(std::string::npos, outer.ToJSON().find("SimplifyTopology"));
+}
+
+TEST(RunStatsTest, EscapesJSONStrings) {
+    EXPECT_EQ("\"a\\\"b\\\\c\\n\"", OpenBabel::jsonString("a\"b\\c\n"));
+}
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+
+#include "scratch_arena.h"
+
+using OpenBabel::ScratchArena;
+using OpenBabel::ScratchArenaScope;
+using OpenBabel::ScratchMap;
+using OpenBabel::ScratchSet;
+
+TEST(ScratchArenaTest, RecyclesFreedBlocks) {
+    ScratchArena arena{};
+    void* first{arena.Allocate(24)};
+    arena.Deallocate(first, 24);
+    EXPECT_EQ(first, arena.Allocate(20));  // same 32-byte size class
+    EXPECT_EQ(1u, arena.NumLiveBlocks());
+}
+
+TEST(ScratchArenaTest, ResetRequiresNoLiveBlocks) {
+    ScratchArena arena{4096};
+    void* small{arena.Allocate(16)};
+    void* large{arena.Allocate(4 * ScratchArena::MAX_POOLED_SIZE)};
+    EXPECT_FALSE(arena.Reset());
+    arena.Deallocate(small, 16);
+    arena.Deallocate(large, 4 * ScratchArena::MAX_POOLED_SIZE);
+    EXPECT_TRUE(arena.Reset());
+    EXPECT_EQ(0u, arena.NumLiveBlocks());
+}
+
+TEST(ScratchArenaTest, ResetKeepsOneChunk) {
+    ScratchArena arena{256};
+    for (int i{0}; i < 64; ++i)
+        arena.Allocate(32);
+    EXPECT_GT(arena.BytesReserved(), 256u);
+    EXPECT_FALSE(arena.Reset());
+
+    ScratchArena empty_arena{256};
+    for (int i{0}; i < 64; ++i)
+        empty_arena.Deallocate(empty_arena.Allocate(32), 32);
+    EXPECT_TRUE(empty_arena.Reset());
+    EXPECT_EQ(256u, empty_arena.BytesReserved());
+}
+
+TEST(ScratchArenaTest, ContainersUseScopeArena) {
+    EXPECT_EQ(nullptr, ScratchArena::Current());
+    ScratchSet<int> heap_set{1, 2, 3};
+    EXPECT_EQ(nullptr, heap_set.get_allocator().arena);
+    {
+        ScratchArenaScope scope{};
+        ScratchArena* arena{ScratchArena::Current()};
+        ASSERT_NE(nullptr, arena);
+        {
+            ScratchArenaScope nested{};
+            EXPECT_EQ(arena, ScratchArena::Current());
+        }
+        EXPECT_EQ(arena, ScratchArena::Current());
+
+        ScratchMap<int, std::string> roles{};
+        roles[1] = "node";
+        roles[2] = "linker";
+        EXPECT_EQ(arena, roles.get_allocator().arena);
+        EXPECT_EQ(2u, arena->NumLiveBlocks());
+
+        ScratchSet<int> copied{heap_set};  // copies bind to the current arena
+        EXPECT_EQ(arena, copied.get_allocator().arena);
+        EXPECT_EQ(3u, copied.size());
+    }
+    EXPECT_EQ(nullptr, ScratchArena::Current());
+}
+
+void freeScratchBlockOnAnotherThread() {
+    ScratchArena arena{};
+    void* block{arena.Allocate(32)};
+    std::thread other{[&arena, block]() { arena.Deallocate(block, 32); }};
+    other.join();
+}
+
+TEST(ScratchArenaDeathTest, AbortsWhenFreedOnAnotherThread) {
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    EXPECT_DEATH(freeScratchBlockOnAnotherThread(), "does not own it");
+}
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "smarts_batch.h"
+#include "substructure_screen.h"
+
+TEST(SmartsBatchTest, MatchesEachPatternInOnePass) {
+    std::stringstream db{
+        "[Co].[O-]C(=O)c1ccncc1 MOFid-v1.rtl.cat0;ABAVIJ_clean\n"
+        "[Cu][Cu].[O-]C(=O)c1cc(cc(c1)C(=O)[O-])C(=O)[O-] MOFid-v1.tbo.cat0;HKUST-1\n"
+        "[O-]C(=O)c1ccc(cc1)C(=O)[O-].[Zn][O]([Zn])([Zn])[Zn] MOFid-v1.pcu.cat0;IRMOF-1\n"
+        "C[N+](C)(C)C.[Co] MOFid-v1.UNKNOWN.cat0;test\n"};
+    OpenBabel::SubstructureScreenDB screen_db{};
+    ASSERT_EQ(4u, screen_db.Load(db));
+
+    const std::vector<std::string> patterns{"[Co]", "C(=O)[O-]", "[Zn]O", "[NX4+]", "[CH3][#1]", "[Co"};
+    OpenBabel::SmartsBatch batch{patterns};
+    ASSERT_EQ(6u, batch.NumPatterns());
+    EXPECT_TRUE(batch.IsValid(0));
+    EXPECT_FALSE(batch.IsValid(5));
+
+    auto hits = batch.Search(screen_db, false, 1);
+    ASSERT_EQ(6u, hits.size());
+    EXPECT_EQ((std::vector<std::size_t>{0, 3}), hits[0]);
+    EXPECT_EQ((std::vector<std::size_t>{0, 1, 2}), hits[1]);
+    EXPECT_EQ((std::vector<std::size_t>{2}), hits[2]);
+    EXPECT_EQ((std::vector<std::size_t>{3}), hits[3]);
+    EXPECT_EQ((std::vector<std::size_t>{3}), hits[4]);  // explicit H pattern
+    EXPECT_TRUE(hits[5].empty());
+
+    auto excluded = batch.Search(screen_db, true, 1);
+    EXPECT_EQ((std::vector<std::size_t>{1, 2}), excluded[0]);
+    EXPECT_TRUE(excluded[5].empty());  // invalid patterns have no hits either way
+}
+
+TEST(SmartsBatchTest, ThreadsDoNotChangeResults) {
+    std::stringstream db;
+    const char* lines[] = {
+        "[Co].[O-]C(=O)c1ccncc1", "[Cu][Cu].[O-]C(=O)c1cc(cc(c1)C(=O)[O-])C(=O)[O-]",
+        "[Zn][O]([Zn])([Zn])[Zn].[O-]C(=O)c1ccc(cc1)C(=O)[O-]", "c1ccc2c(c1)[nH]cn2.[Zn]"};
+    for (int i = 0; i < 500; ++i) {
+        db << lines[i % 4] << " entry" << i << "\n";
+    }
+    OpenBabel::SubstructureScreenDB screen_db{};
+    ASSERT_EQ(500u, screen_db.Load(db));
+
+    OpenBabel::SmartsBatch batch{std::vector<std::string>{"[Zn]", "n", "c1ccccc1", "[Cu]~[Cu]"}};
+    auto serial = batch.Search(screen_db, false, 1);
+    EXPECT_EQ(250u, serial[0].size());
+    EXPECT_EQ(serial, batch.Search(screen_db, false, 4));
+}
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+#include <openbabel/mol.h>
+#include <openbabel/obconversion.h>
+#include <openbabel/parsmart.h>
+
+#include "substructure_screen.h"
+
+TEST(SubstructureScreenTest, OnlyScreensPlainSmarts) {
+    OpenBabel::ScreenWord screen[OpenBabel::SCREEN_WORDS];
+    EXPECT_TRUE(OpenBabel::smartsScreen("[Co]O", screen));
+    EXPECT_FALSE(OpenBabel::smartsScreen("~[Co]", screen));  // negated
+    EXPECT_FALSE(OpenBabel::smartsScreen("c1ccccc1 <2", screen));  // also matches molecules without benzene
+    EXPECT_FALSE(OpenBabel::smartsScreen("pattern.mol", screen));  // pattern file
+    EXPECT_FALSE(OpenBabel::smartsScreen("[Co", screen));
+}
+
+TEST(SubstructureScreenTest, NeverScreensOutMatches) {
+    const char* db_smiles[] = {
+        "[Co].[O-]C(=O)c1ccncc1", "Cl[Mn][Mn]Cl.[O-]C(=O)c1cc(cc(c1)C(=O)[O-])C(=O)[O-]",
+        "[Zn][O]([Zn])([Zn])[Zn]", "c1ccc2c(c1)[nH]cn2", "C[N+](C)(C)C", "[Cu][Cu]", "OCC#N"};
+    const char* patterns[] = {
+        "[Co]", "[#27]", "C(=O)[O-]", "[Zn]O", "n", "[c,n]", "[!C]", "[$(C=O)]O", "[Mn]Cl", "[Mn]~[Mn]",
+        "C#N", "[NX4+]", "c1ccccc1", "[#1]", "*~*", "[Co]O"};
+    OpenBabel::OBConversion obconv;
+    obconv.SetInFormat("smi");
+    for (const char* smiles : db_smiles) {
+        OpenBabel::OBMol mol;
+        ASSERT_TRUE(obconv.ReadString(&mol, smiles));
+        OpenBabel::ScreenWord target[OpenBabel::SCREEN_WORDS];
+        OpenBabel::moleculeScreen(&mol, target);
+        for (const char* smarts : patterns) {
+            OpenBabel::ScreenWord query[OpenBabel::SCREEN_WORDS];
+            ASSERT_TRUE(OpenBabel::smartsScreen(smarts, query)) << smarts;
+            OpenBabel::OBSmartsPattern pattern;
+            ASSERT_TRUE(pattern.Init(smarts));
+            if (pattern.Match(mol)) {
+                EXPECT_TRUE(OpenBabel::passesScreen(query, target)) << smarts << " in " << smiles;
+            }
+        }
+    }
+
+    OpenBabel::ScreenWord query[OpenBabel::SCREEN_WORDS];
+    OpenBabel::ScreenWord target[OpenBabel::SCREEN_WORDS];
+    OpenBabel::OBMol mol;
+    ASSERT_TRUE(obconv.ReadString(&mol, "[Co].[O-]C(=O)c1ccncc1"));
+    OpenBabel::moleculeScreen(&mol, target);
+    OpenBabel::smartsScreen("[Zn]", query);
+    EXPECT_FALSE(OpenBabel::passesScreen(query, target));
+    OpenBabel::smartsScreen("[Co]O", query);  // Co and O are both present, but not bonded
+    EXPECT_FALSE(OpenBabel::passesScreen(query, target));
+}
+
+TEST(SubstructureScreenTest, IndexRoundTrip) {
+    std::stringstream db{
+        "[Co].[O-]C(=O)c1ccncc1 MOFid-v1.rtl.cat0;ABAVIJ_clean\n"
+        "C1CC unclosed_ring\n"
+        "\n"
+        "[Cu][Cu].[O-]C(=O)c1cc(cc(c1)C(=O)[O-])C(=O)[O-] MOFid-v1.tbo.cat0;HKUST-1\r\n"};
+    OpenBabel::SubstructureScreenDB screen_db{};
+    EXPECT_EQ(2u, screen_db.Load(db));  // invalid and blank lines can never match
+    EXPECT_EQ("[Cu][Cu].[O-]C(=O)c1cc(cc(c1)C(=O)[O-])C(=O)[O-] MOFid-v1.tbo.cat0;HKUST-1", screen_db.GetLine(1));
+    const std::string path{testing::TempDir() + "mofid_screen_index.scr"};
+    ASSERT_TRUE(screen_db.SaveIndex(path, "123 456"));
+
+    OpenBabel::SubstructureScreenDB stale{};
+    EXPECT_FALSE(stale.LoadIndex(path, "124 456"));  // DB was modified
+    EXPECT_EQ(0u, stale.NumEntries());
+
+    OpenBabel::SubstructureScreenDB loaded{};
+    ASSERT_TRUE(loaded.LoadIndex(path, "123 456"));
+    ASSERT_EQ(2u, loaded.NumEntries());
+    EXPECT_EQ(screen_db.GetLine(0), loaded.GetLine(0));
+    OpenBabel::ScreenWord query[OpenBabel::SCREEN_WORDS];
+    OpenBabel::smartsScreen("[Cu]", query);
+    EXPECT_FALSE(loaded.Passes(0, query));
+    EXPECT_TRUE(loaded.Passes(1, query));
+    std::remove(path.c_str());
+}
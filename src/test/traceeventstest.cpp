@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "run_stats.h"
+#include "trace_events.h"
+
+namespace TraceEventsTest {
+    std::string tracePath(const std::string& name) {
+        std::string path{testing::TempDir() + name};
+        std::remove(path.c_str());
+        return path;
+    }
+
+    std::string readTrace(const std::string& path) {
+        std::ifstream trace{path.c_str()};
+        std::stringstream contents{};
+        contents << trace.rdbuf();
+        return contents.str();
+    }
+
+    int countOf(const std::string& text, const std::string& part) {
+        int count{0};
+        for (std::string::size_type pos = text.find(part); pos != std::string::npos; pos = text.find(part, pos + 1)) {
+            ++count;
+        }
+        return count;
+    }
+}
+
+using namespace TraceEventsTest;
+
+TEST(TraceEventsTest, AppendsSpansFromSeveralWriters) {
+    const std::string path{tracePath("mofid_trace_append.json")};
+    const std::chrono::steady_clock::time_point start{std::chrono::steady_clock::now()};
+    {
+        OpenBabel::TraceSink first{};
+        ASSERT_TRUE(first.Open(path, "sbu first.cif"));
+        EXPECT_TRUE(first.IsOpen());
+        first.AddSpan("first.cif", "structure", start, start + std::chrono::milliseconds(2), "{\"cif\":\"first.cif\"}");
+    }
+    OpenBabel::TraceSink second{};
+    ASSERT_TRUE(second.Open(path, "sbu second.cif"));
+    second.AddSpan("CollapseNodes", "deconstruction", start, start + std::chrono::microseconds(1500));
+    second.Close();
+    EXPECT_FALSE(second.IsOpen());
+    second.AddSpan("ignored", "stage", start, start);
+
+    const std::string trace{readTrace(path)};
+    EXPECT_EQ(0u, trace.find("[\n"));
+    EXPECT_EQ(1, countOf(trace, "["));  // only the creator starts the array
+    EXPECT_EQ(2, countOf(trace, "\"ph\":\"M\""));
+    EXPECT_EQ(2, countOf(trace, "\"ph\":\"X\""));
+    EXPECT_EQ(1, countOf(trace, "\"name\":\"first.cif\",\"cat\":\"structure\""));
+    EXPECT_EQ(1, countOf(trace, "\"args\":{\"cif\":\"first.cif\"}"));
+    EXPECT_EQ(1, countOf(trace, "\"dur\":1500.000"));
+    EXPECT_EQ(0, countOf(trace, "ignored"));
+    EXPECT_EQ(",\n", trace.substr(trace.size() - 2));  // each event is a whole line
+    std::remove(path.c_str());
+}
+
+TEST(TraceEventsTest, StartsArrayWhenCreated) {
+    // Another worker may flush before the creator, so the header can't wait for the creator's flush
+    const std::string path{tracePath("mofid_trace_header.json")};
+    const std::chrono::steady_clock::time_point start{std::chrono::steady_clock::now()};
+    OpenBabel::TraceSink creator{};
+    ASSERT_TRUE(creator.Open(path, "sbu creator.cif"));
+    EXPECT_EQ("[\n", readTrace(path));
+    {
+        OpenBabel::TraceSink other{};
+        ASSERT_TRUE(other.Open(path, "sbu other.cif"));
+        other.AddSpan("other.cif", "structure", start, start);
+    }
+    creator.Close();
+
+    const std::string trace{readTrace(path)};
+    EXPECT_EQ(0u, trace.find("[\n{"));
+    EXPECT_EQ(1, countOf(trace, "["));
+    EXPECT_EQ(2, countOf(trace, "\"ph\":\"M\""));
+    std::remove(path.c_str());
+}
+
+TEST(TraceEventsTest, StageTimersTraceWithoutStats) {
+    const std::string path{tracePath("mofid_trace_stages.json")};
+    ASSERT_TRUE(OpenBabel::globalTraceSink().Open(path, "traceeventstest"));
+    {
+        OpenBabel::RunStatsScope no_stats{nullptr};
+        OpenBabel::TraceSpan structure{"MOF.cif", "structure"};
+        OpenBabel::StageTimer timer{"detectPaddlewheels", "perception"};
+        timer.Stop();
+        timer.Stop();  // only traced once
+    }
+    OpenBabel::globalTraceSink().Close();
+    {
+        OpenBabel::TraceSpan after_close{"closed", "structure"};
+    }
+
+    const std::string trace{readTrace(path)};
+    EXPECT_EQ(1, countOf(trace, "\"name\":\"detectPaddlewheels\",\"cat\":\"perception\""));
+    EXPECT_EQ(1, countOf(trace, "\"name\":\"MOF.cif\",\"cat\":\"structure\""));
+    EXPECT_EQ(0, countOf(trace, "closed"));
+    std::remove(path.c_str());
+}
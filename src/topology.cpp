@@ -3,6 +3,7 @@
 #include "virtual_mol.h"
 #include "pseudo_atom.h"
 #include "periodic.h"
+#include "run_stats.h"
 #include "obdetails.h"
 #include "invector.h"
 
@@ -13,6 +14,10 @@
 #include <set>
 #include <utility>  // std::pair
 #include <queue>
+#include <map>
+#include <stack>
+#include <sstream>
+#include <algorithm>
 
 #include <openbabel/babelconfig.h>
 #include <openbabel/mol.h>
@@ -20,11 +25,47 @@
 #include <openbabel/bond.h>
 #include <openbabel/obiter.h>
 #include <openbabel/generic.h>
+#include <openbabel/elements.h>
 
 
 namespace OpenBabel
 {
 
+bool NetInvariants::operator==(const NetInvariants &other) const {
+	return num_vertices == other.num_vertices && num_edges == other.num_edges
+		&& degrees == other.degrees && composition == other.composition;
+}
+
+std::string NetInvariants::GetFormula() const {
+	// Hill order with explicit 1's, matching OBMol::GetFormula on the orig_mol atoms
+	std::map<std::string, int> by_symbol;
+	for (std::map<int, int>::const_iterator it=composition.begin(); it!=composition.end(); ++it) {
+		by_symbol[OBElements::GetSymbol(it->first)] = it->second;
+	}
+	std::stringstream formula;
+	if (by_symbol.count("C")) {
+		const char *first_symbols[] = {"C", "H"};
+		for (int i = 0; i < 2; ++i) {
+			std::map<std::string, int>::iterator first = by_symbol.find(first_symbols[i]);
+			if (first != by_symbol.end()) {
+				formula << first->first << first->second;
+				by_symbol.erase(first);
+			}
+		}
+	}
+	for (std::map<std::string, int>::iterator it=by_symbol.begin(); it!=by_symbol.end(); ++it) {
+		formula << it->first << it->second;
+	}
+	return formula.str();
+}
+
+std::string NetInvariants::ToString() const {
+	std::stringstream description;
+	description << GetFormula() << " (" << num_vertices << " vertices, " << num_edges << " edges)";
+	return description.str();
+}
+
+
 ConnectionTable::ConnectionTable(OBMol* parent) {
 	parent_net = parent;
 }
@@ -71,7 +112,7 @@ bool ConnectionTable::HasNeighbor(PseudoAtom begin, PseudoAtom end) {
 }
 
 AtomSet ConnectionTable::GetConnEndpointSet(PseudoAtom conn) {
-	std::set<PseudoAtom> endpoints;
+	AtomSet endpoints;
 	endpoints.insert(conn2endpts[conn].first);
 	endpoints.insert(conn2endpts[conn].second);
 	return endpoints;
@@ -127,6 +168,7 @@ bool ConnectionTable::CheckConsistency() {
 
 Topology::Topology(OBMol *parent_mol) {
 	orig_molp = parent_mol;
+	bulk_edit_depth = 0;
 	if (parent_mol == NULL) {  // default constructor for Topology, e.g. a data member in another class
 		simplified_net = OBMol();
 		return;  // skip initialization with default empty data
@@ -136,9 +178,9 @@ Topology::Topology(OBMol *parent_mol) {
 	// Remember not to declare the object types in the constructor.
 	// We're trying to initialize class members, not declare local variables with the same name.
 	conns = ConnectionTable(&simplified_net);
-	deleted_atoms = std::map<std::string, VirtualMol>();  // empty: initially all atoms from orig_mol exist
+	deleted_atoms = ScratchMap<std::string, VirtualMol>();  // empty: initially all atoms from orig_mol exist
 	pa_to_act = PseudoAtomMap(&simplified_net, orig_molp);
-	pa_roles = std::map<OBAtom*, std::string>();    // initialize to empty.  Automatically will add elements
+	pa_roles = ScratchMap<OBAtom*, std::string>();    // initialize to empty.  Automatically will add elements
 
 	// Initialize simplified_net via copying orig_mol and creating the 1:1 mapping
 	FOR_ATOMS_OF_MOL(orig_atom, *orig_molp) {
@@ -156,6 +198,44 @@ Topology::Topology(OBMol *parent_mol) {
 	}
 }
 
+void Topology::BeginBulkEdit() {
+	++bulk_edit_depth;
+}
+
+void Topology::EndBulkEdit() {
+	// Compact all of the tombstoned atoms and their bonds in one pass
+	if (bulk_edit_depth == 0) {
+		obErrorLog.ThrowError(__FUNCTION__, "EndBulkEdit() called without a matching BeginBulkEdit()", obWarning);
+		return;
+	}
+	--bulk_edit_depth;
+	if (bulk_edit_depth || tombstones.empty()) {
+		return;
+	}
+	std::vector<OBAtom*> to_delete(tombstones.begin(), tombstones.end());
+	tombstones.clear();
+	simplified_net.DeleteAtoms(to_delete);
+}
+
+void Topology::RemoveNetAtom(PseudoAtom atom) {
+	// Deletes an atom from simplified_net, or tombstones it during a bulk edit.
+	// A tombstoned atom loses its bonds immediately, so neighbor iterators and valences
+	// are already correct, but its memory (and pointer) stay reserved until EndBulkEdit().
+	if (!bulk_edit_depth) {
+		simplified_net.DeleteAtom(atom);  // automatically deletes attached bonds
+		return;
+	}
+	std::vector<OBBond*> atom_bonds;
+	FOR_BONDS_OF_ATOM(b, *atom) {
+		atom_bonds.push_back(&*b);
+	}
+	for (std::vector<OBBond*>::iterator it=atom_bonds.begin(); it!=atom_bonds.end(); ++it) {
+		(*it)->GetBeginAtom()->DeleteBond(*it);
+		(*it)->GetEndAtom()->DeleteBond(*it);
+	}
+	tombstones.insert(atom);
+}
+
 bool Topology::IsConnection(PseudoAtom a) {
 	// Is a member of the simplified net a connection or pseudoatom?
 	return conns.IsConn(a);
@@ -166,6 +246,16 @@ PseudoAtom Topology::GetOtherEndpoint(PseudoAtom conn, PseudoAtom begin) {
 	return conns.GetOtherEndpoint(conn, begin);
 }
 
+AtomSet Topology::GetNeighborPAs(PseudoAtom atom) {
+	// Get the pseudoatoms on the other end of each connection to atom
+	AtomSet nbors;
+	AtomSet atom_conns = conns.GetAtomConns(atom);
+	for (AtomSet::iterator it=atom_conns.begin(); it!=atom_conns.end(); ++it) {
+		nbors.insert(conns.GetOtherEndpoint(*it, atom));
+	}
+	return nbors;
+}
+
 VirtualMol Topology::GetDeletedOrigAtoms(const std::string &deletion_reason) {
 	// Get atoms that were in the original parent molecule but no longer in the simplified net
 	if (deletion_reason != ALL_DELETED_ORIG_ATOMS) {
@@ -177,7 +267,7 @@ VirtualMol Topology::GetDeletedOrigAtoms(const std::string &deletion_reason) {
 		}
 	} else {
 		VirtualMol combined_deleted_atoms(orig_molp);
-		for (std::map<std::string,VirtualMol>::iterator it=deleted_atoms.begin(); it!=deleted_atoms.end(); ++it) {
+		for (ScratchMap<std::string,VirtualMol>::iterator it=deleted_atoms.begin(); it!=deleted_atoms.end(); ++it) {
 			combined_deleted_atoms.AddVirtualMol(it->second);
 		}
 		return combined_deleted_atoms;
@@ -187,7 +277,7 @@ VirtualMol Topology::GetDeletedOrigAtoms(const std::string &deletion_reason) {
 VirtualMol Topology::GetAtomsOfRole(const std::string &role) {
 	// Pseudoatoms of a given role
 	VirtualMol match(&simplified_net);
-	for (std::map<OBAtom*, std::string>::iterator it=pa_roles.begin(); it!=pa_roles.end(); ++it) {
+	for (ScratchMap<OBAtom*, std::string>::iterator it=pa_roles.begin(); it!=pa_roles.end(); ++it) {
 		if (it->second == role) {
 			match.AddAtom(it->first);
 		}
@@ -199,6 +289,7 @@ VirtualMol Topology::GetAtoms(bool include_conn) {
 	// Returns all atoms in the simplified net, optionally discarding connections
 	VirtualMol atoms(&simplified_net);
 	FOR_ATOMS_OF_MOL(a, simplified_net) {
+		if (tombstones.find(&*a) != tombstones.end()) { continue; }
 		if (include_conn || !IsConnection(&*a)) {
 			atoms.AddAtom(&*a);
 		}
@@ -206,9 +297,61 @@ VirtualMol Topology::GetAtoms(bool include_conn) {
 	return atoms;
 }
 
+std::vector<NetInvariants> Topology::GetNetInvariants() {
+	// Walks each connected component of the simplified net once.  Original atoms are marked with the
+	// component that claimed them, so atoms mapped to several PA's are only counted once per net.
+	std::vector<NetInvariants> nets;
+	std::vector<int> pa_component(simplified_net.NumAtoms() + 1, -1);  // by PA index
+	std::vector<int> orig_component(orig_molp ? orig_molp->NumAtoms() + 1 : 1, -1);  // by orig atom index
+
+	FOR_ATOMS_OF_MOL(seed, simplified_net) {
+		if (pa_component[seed->GetIdx()] != -1 || tombstones.find(&*seed) != tombstones.end()) {
+			continue;  // already in a net, or deleted (tombstones have no bonds, so they are never reached below)
+		}
+		int component = nets.size();
+		nets.push_back(NetInvariants());
+		NetInvariants &net = nets.back();
+
+		std::stack<OBAtom*> to_visit;
+		to_visit.push(&*seed);
+		pa_component[seed->GetIdx()] = component;
+		while (!to_visit.empty()) {
+			OBAtom* curr_atom = to_visit.top();
+			to_visit.pop();
+
+			int degree = 0;
+			FOR_NBORS_OF_ATOM(nbor, *curr_atom) {
+				++degree;
+				if (pa_component[nbor->GetIdx()] == -1) {
+					pa_component[nbor->GetIdx()] = component;
+					to_visit.push(&*nbor);
+				}
+			}
+			if (IsConnection(curr_atom)) {
+				++net.num_edges;
+			} else {
+				++net.num_vertices;
+				net.degrees.push_back(degree);
+			}
+
+			AtomSet orig_atoms = pa_to_act[curr_atom].GetAtoms();
+			for (AtomSet::iterator it=orig_atoms.begin(); it!=orig_atoms.end(); ++it) {
+				int &owner = orig_component[(*it)->GetIdx()];
+				if (owner != component) {
+					owner = component;
+					++net.composition[(*it)->GetAtomicNum()];
+				}
+			}
+		}
+		std::sort(net.degrees.begin(), net.degrees.end());
+	}
+	return nets;
+}
+
 VirtualMol Topology::GetConnectors() {
 	VirtualMol atoms(&simplified_net);
 	FOR_ATOMS_OF_MOL(a, simplified_net) {
+		if (tombstones.find(&*a) != tombstones.end()) { continue; }
 		if (IsConnection(&*a)) {
 			atoms.AddAtom(&*a);
 		}
@@ -230,8 +373,8 @@ void Topology::SetRoleToAtoms(const std::string &role, VirtualMol atoms) {
 		obErrorLog.ThrowError(__FUNCTION__, "VirtualMol needs to contain PseudoAtoms of the simplified net.", obError);
 		return;
 	}
-	std::set<OBAtom*> atom_list = atoms.GetAtoms();
-	for (std::set<OBAtom*>::iterator it=atom_list.begin(); it!=atom_list.end(); ++it) {
+	AtomSet atom_list = atoms.GetAtoms();
+	for (AtomSet::iterator it=atom_list.begin(); it!=atom_list.end(); ++it) {
 		SetRoleToAtom(role, *it);
 	}
 }
@@ -249,11 +392,11 @@ VirtualMol Topology::OrigToPseudo(VirtualMol orig_atoms) {
 		obErrorLog.ThrowError(__FUNCTION__, "VirtualMol needs to contain child atoms of the original, unsimplified MOF", obError);
 		return VirtualMol();
 	}
-	std::set<OBAtom*> act_atoms = orig_atoms.GetAtoms();
+	AtomSet act_atoms = orig_atoms.GetAtoms();
 	VirtualMol pa(&simplified_net);
 
 	// Find the relevant set of pseudoatoms
-	for (std::set<OBAtom*>::iterator it=act_atoms.begin(); it!=act_atoms.end(); ++it) {
+	for (AtomSet::iterator it=act_atoms.begin(); it!=act_atoms.end(); ++it) {
 		pa.AddAtom(act_to_pa[*it]);
 	}
 	// TODO consider a consistency check that the PA's don't include any other atoms (a length check for fragment vs. sum of PA AtomSets)
@@ -269,7 +412,7 @@ VirtualMol Topology::PseudoToOrig(VirtualMol pa_atoms) {
 
 	VirtualMol orig_atoms(orig_molp);
 	AtomSet pa_set = pa_atoms.GetAtoms();
-	for (std::set<OBAtom*>::iterator it=pa_set.begin(); it!=pa_set.end(); ++it) {
+	for (AtomSet::iterator it=pa_set.begin(); it!=pa_set.end(); ++it) {
 		orig_atoms.AddVirtualMol(pa_to_act[*it]);
 	}
 	return orig_atoms;
@@ -310,7 +453,7 @@ PseudoAtom Topology::ConnectAtoms(PseudoAtom begin, PseudoAtom end, vector3 *pos
 void Topology::DeleteConnection(PseudoAtom conn) {
 	// Removes connections between two atoms (no longer directly bonded through a connection site)
 	conns.RemoveConn(conn);
-	simplified_net.DeleteAtom(conn);  // automatically deletes attached bonds
+	RemoveNetAtom(conn);  // automatically deletes attached bonds
 	pa_roles.erase(conn);
 	pa_to_act.RemoveAtom(conn);
 }
@@ -336,7 +479,7 @@ void Topology::DeleteAtomAndConns(PseudoAtom atom, const std::string &role_for_o
 	for (AtomSet::iterator it=nbors.begin(); it!=nbors.end(); ++it) {
 		DeleteConnection(*it);
 	}
-	simplified_net.DeleteAtom(atom);  // automatically deletes bonds
+	RemoveNetAtom(atom);  // automatically deletes bonds
 
 	// Remove original atoms if present
 	AtomSet act_atoms = pa_to_act[atom].GetAtoms();
@@ -479,7 +622,7 @@ OBMol Topology::ToOBMol() {
 
 	// For the interim, let's try coloring the atoms as a test.
 	// This will not likely be the implementation for the final version of the code, but it's worth trying now
-	for (std::map<OBAtom*, std::string>::iterator it=pa_roles.begin(); it!=pa_roles.end(); ++it) {
+	for (ScratchMap<OBAtom*, std::string>::iterator it=pa_roles.begin(); it!=pa_roles.end(); ++it) {
 		if (it->second == "node") {
 			changeAtomElement(it->first, 40);  // Zr (teal)
 		} else if (it->second == "linker") {
@@ -491,6 +634,9 @@ OBMol Topology::ToOBMol() {
 	// I did the coloring this way out of convenience, but honestly it's actually
 	// a really good way to visualize how the net turned out.
 	// A web app to combine/hide the different layers could work too.
+	if (bulk_edit_depth) {
+		obErrorLog.ThrowError(__FUNCTION__, "Exporting the simplified net during a bulk edit, which still contains tombstoned atoms", obWarning);
+	}
 	return simplified_net;
 }
 
@@ -638,11 +784,18 @@ int Topology::SimplifyAxB() {
 	// Returns the number of modifications to connection sites.
 	// Based on simplifyLX in the previous version of the code.
 	// May require multiple passes to fully simplify the network (when it returns 0).
+	return SimplifyAxB(GetAtoms(false).GetAtoms());  // check all non-connector atoms
+}
+
+int Topology::SimplifyAxB(const AtomSet &a_sites, AtomSet *modified_sites) {
+	// Same as SimplifyAxB(), but only checking the connections of a_sites as the A pseudoatoms.
+	// If modified_sites is specified, the A and B endpoints of each new connection x3 are added to it,
+	// since those are the only sites where the next pass could find new redundant connections.
+	StageTimer timer("SimplifyAxB", "deconstruction");
 
-	std::vector<PseudoAtom> to_delete;  // X's to delete at the end
+	AtomSet to_delete;  // X's to delete at the end
 
-	AtomSet a_atoms = GetAtoms(false).GetAtoms();  // get non-connector atoms
-	for (AtomSet::iterator a_it=a_atoms.begin(); a_it!=a_atoms.end(); ++a_it) {
+	for (AtomSet::const_iterator a_it=a_sites.begin(); a_it!=a_sites.end(); ++a_it) {
 		PseudoAtom a = *a_it;  // looping over A sites
 		std::map<PseudoAtom, AtomSet> nbor_to_xs;  // all the connection X's per nbor
 		AtomSet a_x_list = conns.GetAtomConns(a);
@@ -660,8 +813,8 @@ int Topology::SimplifyAxB() {
 				for (AtomSet::iterator x2=x1; x2!=ab_xs.end(); ++x2) {
 					if (
 						*x1 != *x2 &&
-						!inVector<PseudoAtom>(*x1, to_delete) &&
-						!inVector<PseudoAtom>(*x2, to_delete)
+						to_delete.find(*x1) == to_delete.end() &&
+						to_delete.find(*x2) == to_delete.end()
 					) {
 						// Form a test molecule with A-x1-B-x2-A'
 						VirtualMol test_xs(a->GetParent());
@@ -674,10 +827,14 @@ int Topology::SimplifyAxB() {
 							// If test_xs is periodic, then A' is in a different UC than A,
 							// so X1 and X2 are a bridge.  If non-periodic (this case),
 							// then X1 and X2 are redundant connections between A and B.
-							to_delete.push_back(*x1);
-							to_delete.push_back(*x2);
+							to_delete.insert(*x1);
+							to_delete.insert(*x2);
 							vector3 loc = getMidpoint(*x1, *x2, false);
 							ConnectAtoms(a, b, &loc);
+							if (modified_sites) {
+								modified_sites->insert(a);
+								modified_sites->insert(b);
+							}
 						}
 					}
 				}
@@ -686,7 +843,7 @@ int Topology::SimplifyAxB() {
 	}
 
 	// Delete the redundant X's (which will also remove their X-L and X-M bonds)
-	for (std::vector<PseudoAtom>::iterator it=to_delete.begin(); it!=to_delete.end(); ++it) {
+	for (AtomSet::iterator it=to_delete.begin(); it!=to_delete.end(); ++it) {
 		DeleteConnection(*it);
 	}
 
@@ -8,6 +8,7 @@ topology.h - Simplified topological net and related classes
 #include <string>
 #include <vector>
 #include <set>
+#include <map>
 #include <utility>  // std::pair
 
 #include <openbabel/babelconfig.h>
@@ -26,15 +27,32 @@ const std::string DELETE_ORIG_ATOM_ERROR = "unexpected error";  // role for tryi
 const std::string ALL_DELETED_ORIG_ATOMS = "get all atoms";  // role for trying to delete PAs containing orig_mol atoms
 
 
+class NetInvariants {
+// Graph invariants of one connected net in the simplified topology, computed on the quotient graph
+// of pseudo atoms and connections, plus the composition of the original atoms mapped to the net.
+// Interpenetrated copies of the same net have equal invariants.
+public:
+	int num_vertices;  // pseudo atoms, excluding connections
+	int num_edges;  // connections
+	std::vector<int> degrees;  // sorted connectivity of the pseudo atoms
+	std::map<int, int> composition;  // original atoms by atomic number
+	NetInvariants() : num_vertices(0), num_edges(0) {};
+	bool operator==(const NetInvariants &other) const;
+	bool operator!=(const NetInvariants &other) const { return !(*this == other); };
+	std::string GetFormula() const;  // composition in Hill order, e.g. C16H8O13Zn4
+	std::string ToString() const;  // formula plus the net size, for error messages
+};
+
+
 class ConnectionTable {
 // Handles accounting for connection pseudoatoms and their endpoints
 private:
 	OBMol *parent_net;
-	std::map< PseudoAtom, std::pair<PseudoAtom, PseudoAtom> > conn2endpts;
+	ScratchMap< PseudoAtom, std::pair<PseudoAtom, PseudoAtom> > conn2endpts;
 	// Don't keep track of endpoint neighbors, since there may be multiple
 	// connections between atoms 1 and 2 (e.g. different directions in IRMOF-1)
 	// std::map< PseudoAtom, std::set<PseudoAtom> > endpt_nbors;
-	std::map< PseudoAtom, std::set<PseudoAtom> > endpt_conns;
+	ScratchMap< PseudoAtom, AtomSet > endpt_conns;
 public:
 	ConnectionTable(OBMol* parent = NULL);
 	//bool CheckConsistency();
@@ -72,10 +90,16 @@ private:
 	// which would prevent inadvertently deleting bonds, etc.
 
 	ConnectionTable conns;
-	std::map<std::string, VirtualMol> deleted_atoms;  // atoms "deleted" from orig_molp in the simplified net
+	ScratchMap<std::string, VirtualMol> deleted_atoms;  // atoms "deleted" from orig_molp in the simplified net
 	PseudoAtomMap pa_to_act;  // map simplified PA to VirtualMol of orig atoms
-	std::map<OBAtom*, std::string> pa_roles;  // roles of the simplified pseudoatoms
-	std::map<OBAtom*, PseudoAtom> act_to_pa;  // where did the orig_mol atoms end up in the simplified net?
+	ScratchMap<OBAtom*, std::string> pa_roles;  // roles of the simplified pseudoatoms
+	ScratchMap<OBAtom*, PseudoAtom> act_to_pa;  // where did the orig_mol atoms end up in the simplified net?
+
+	// Deferred deletions during a bulk edit (see BeginBulkEdit).  Tombstoned atoms are detached
+	// from the net right away but keep their OBAtom* until EndBulkEdit compacts simplified_net.
+	int bulk_edit_depth;
+	AtomSet tombstones;
+	void RemoveNetAtom(PseudoAtom atom);
 
 	// The complicated constructor makes a copy constructor nontrivial (and it's not currently being used).
 	// Besides Wikipedia, here's another good overview: https://en.cppreference.com/w/cpp/language/rule_of_three
@@ -87,6 +111,11 @@ public:
 	Topology(OBMol *parent_mol = NULL);
 	OBMol* GetOrigMol() { return orig_molp; };
 
+	// Batch many deletions together, renumbering simplified_net once at the end.
+	// Calls may be nested, like OBMol::BeginModify/EndModify.
+	void BeginBulkEdit();
+	void EndBulkEdit();
+
 	// Manipulating/querying the roles of pseudoatoms
 	bool AtomHasRole(PseudoAtom atom, const std::string &role);
 	VirtualMol GetAtomsOfRole(const std::string &role);
@@ -96,11 +125,14 @@ public:
 
 	// Exporting atoms and connections
 	VirtualMol GetAtoms(bool include_conn=true);
+	// Invariants of each connected net, in O(V+E) plus the number of original atoms, without copying atoms
+	std::vector<NetInvariants> GetNetInvariants();
 	OBMol FragmentToOBMolNoConn(VirtualMol pa_fragment);
 	VirtualMol GetDeletedOrigAtoms(const std::string &deletion_reason=ALL_DELETED_ORIG_ATOMS);
 	VirtualMol GetConnectors();
 	bool IsConnection(PseudoAtom a);
 	PseudoAtom GetOtherEndpoint(PseudoAtom conn, PseudoAtom begin);
+	AtomSet GetNeighborPAs(PseudoAtom atom);
 
 	// Conversions between the original and simplified nets
 	VirtualMol OrigToPseudo(VirtualMol orig_atoms);
@@ -118,6 +150,7 @@ public:
 	PseudoAtom CollapseFragment(VirtualMol pa_fragment);
 	void MergeAtomToAnother(PseudoAtom from, PseudoAtom to);
 	int SimplifyAxB();
+	int SimplifyAxB(const AtomSet &a_sites, AtomSet *modified_sites = NULL);
 	int SplitFourVertexIntoTwoThree(PseudoAtom site);
 	PseudoAtom ConnTo2cPA(PseudoAtom conn_pa, int element=DEFAULT_ELEMENT);
 
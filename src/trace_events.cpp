@@ -0,0 +1,186 @@
+#include "trace_events.h"
+#include "run_stats.h"  // jsonString
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#include <unistd.h>
+#define TRACE_SINK_APPEND
+#endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#ifdef _WIN32
+#include <process.h>
+#endif
+
+#include <openbabel/babelconfig.h>
+#include <openbabel/oberror.h>
+
+namespace OpenBabel
+{
+
+namespace {
+long processID() {
+#ifdef _WIN32
+	return _getpid();
+#elif defined(TRACE_SINK_APPEND)
+	return getpid();
+#else
+	return 0;
+#endif
+}
+
+long threadID() {
+	// The kernel's thread ID on Linux, which matches Python's threading.get_native_id()
+#ifdef __linux__
+	return syscall(SYS_gettid);
+#else
+	return static_cast<long>(std::hash<std::thread::id>()(std::this_thread::get_id()) & 0x7fffffff);
+#endif
+}
+
+double microseconds(std::chrono::steady_clock::time_point time) {
+	return std::chrono::duration<double, std::micro>(time.time_since_epoch()).count();
+}
+}  // end anonymous namespace
+
+
+TraceSink::TraceSink() {
+	open = false;
+	append_fd = -1;
+}
+
+TraceSink::~TraceSink() {
+	Close();
+}
+
+bool TraceSink::Open(const std::string &filename, const std::string &process_name) {
+	Close();
+	std::lock_guard<std::mutex> guard(lock);
+	path = filename;
+	// Only the process that creates the file starts the JSON array.  It's written right away, so the
+	// events flushed by other processes in the meantime can't come before it.
+	const std::string header = "[\n";
+#ifdef TRACE_SINK_APPEND
+	append_fd = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_EXCL, 0644);
+	if (append_fd >= 0) {
+		if (write(append_fd, header.c_str(), header.size()) != static_cast<ssize_t>(header.size())) {
+			obErrorLog.ThrowError(__FUNCTION__, "Incomplete write to trace file " + path, obWarning);
+		}
+	} else {
+		append_fd = ::open(path.c_str(), O_WRONLY | O_APPEND);
+	}
+	if (append_fd < 0) {
+		obErrorLog.ThrowError(__FUNCTION__, "Could not open trace file " + path, obWarning);
+		path = "";
+		return false;
+	}
+#else
+	std::ifstream existing(path.c_str());
+	if (!existing.good()) {
+		std::ofstream trace_file(path.c_str(), std::ios::out | std::ios::binary);
+		trace_file << header;
+	}
+#endif
+	std::stringstream metadata;
+	metadata << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << processID()
+		<< ",\"tid\":" << threadID() << ",\"args\":{\"name\":" << jsonString(process_name) << "}},\n";
+	pending.push_back(metadata.str());
+	open = true;
+	return true;
+}
+
+void TraceSink::Close() {
+	Flush();
+	std::lock_guard<std::mutex> guard(lock);
+	open = false;
+#ifdef TRACE_SINK_APPEND
+	if (append_fd >= 0) {
+		::close(append_fd);
+	}
+#endif
+	append_fd = -1;
+	path = "";
+}
+
+void TraceSink::AddSpan(const std::string &name, const std::string &category, std::chrono::steady_clock::time_point start,
+		std::chrono::steady_clock::time_point end, const std::string &args_json) {
+	if (!IsOpen()) {
+		return;
+	}
+	std::stringstream event;
+	event << std::fixed << std::setprecision(3);
+	event << "{\"name\":" << jsonString(name) << ",\"cat\":" << jsonString(category) << ",\"ph\":\"X\""
+		<< ",\"ts\":" << microseconds(start) << ",\"dur\":" << (microseconds(end) - microseconds(start))
+		<< ",\"pid\":" << processID() << ",\"tid\":" << threadID();
+	if (!args_json.empty()) {
+		event << ",\"args\":" << args_json;
+	}
+	event << "},\n";
+
+	bool full = false;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		pending.push_back(event.str());
+		full = pending.size() >= FLUSH_EVENTS;
+	}
+	if (full) {
+		Flush();
+	}
+}
+
+void TraceSink::Flush() {
+	std::lock_guard<std::mutex> guard(lock);
+	if (path.empty() || pending.empty()) {
+		return;
+	}
+	std::string events;
+	for (std::vector<std::string>::iterator it=pending.begin(); it!=pending.end(); ++it) {
+		events += *it;
+	}
+	pending.clear();
+#ifdef TRACE_SINK_APPEND
+	// A single O_APPEND write keeps events from concurrent workers intact
+	if (write(append_fd, events.c_str(), events.size()) != static_cast<ssize_t>(events.size())) {
+		obErrorLog.ThrowError(__FUNCTION__, "Incomplete write to trace file " + path, obWarning);
+	}
+#else
+	std::ofstream trace_file(path.c_str(), std::ios::out | std::ios::app | std::ios::binary);
+	trace_file << events;
+#endif
+}
+
+TraceSink& globalTraceSink() {
+	static TraceSink sink;
+	return sink;
+}
+
+
+TraceSpan::TraceSpan(const std::string &span_name, const std::string &span_category, const std::string &span_args) {
+	tracing = globalTraceSink().IsOpen();
+	if (tracing) {
+		name = span_name;
+		category = span_category;
+		args_json = span_args;
+		start = std::chrono::steady_clock::now();
+	}
+}
+
+TraceSpan::~TraceSpan() {
+	if (tracing) {
+		globalTraceSink().AddSpan(name, category, start, std::chrono::steady_clock::now(), args_json);
+	}
+}
+
+} // end namespace OpenBabel
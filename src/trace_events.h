@@ -0,0 +1,72 @@
+/**********************************************************************
+trace_events.h - Chrome/Perfetto trace-event output for batch runs
+***********************************************************************/
+
+#ifndef TRACE_EVENTS_H
+#define TRACE_EVENTS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace OpenBabel
+{
+
+// Environment variable naming the trace file shared by a batch of sbu runs (and Python/run_mofid.py)
+const std::string TRACE_ENV = "MOFID_TRACE";
+
+
+class TraceSink {
+// Collects complete ("X") trace events for chrome://tracing or ui.perfetto.dev, tagged by process and thread.
+// The file uses the JSON array format, whose closing bracket is optional, so any number of processes can
+// append to it: the creator writes the opening bracket, and each flush is a single O_APPEND write of whole
+// events.  Timestamps come from the monotonic clock, so spans from different processes line up.
+private:
+	std::string path;
+	std::atomic<bool> open;
+	std::vector<std::string> pending;  // serialized events since the last flush
+	int append_fd;
+	std::mutex lock;
+
+	TraceSink(const TraceSink& other);
+	TraceSink& operator=(const TraceSink&);
+
+public:
+	static const std::size_t FLUSH_EVENTS = 1000;
+	TraceSink();
+	~TraceSink();  // flushes any pending events
+	bool Open(const std::string &filename, const std::string &process_name);
+	void Close();
+	bool IsOpen() const { return open.load(std::memory_order_relaxed); };
+	void AddSpan(const std::string &name, const std::string &category, std::chrono::steady_clock::time_point start,
+		std::chrono::steady_clock::time_point end, const std::string &args_json = "");
+	void Flush();
+};
+
+TraceSink& globalTraceSink();  // process-wide sink used by TraceSpan and StageTimer
+
+
+class TraceSpan {
+// Adds the lifetime of the span to the global trace, if it is open.  args_json is an optional JSON
+// object of extra details, e.g. {"cif":"MOF.cif"}.  Stages that also need stats use StageTimer instead.
+public:
+	TraceSpan(const std::string &span_name, const std::string &span_category, const std::string &span_args = "");
+	~TraceSpan();
+private:
+	TraceSpan(const TraceSpan& other);
+	TraceSpan& operator=(const TraceSpan&);
+	bool tracing;
+	std::string name;
+	std::string category;
+	std::string args_json;
+	std::chrono::steady_clock::time_point start;
+};
+
+} // end namespace OpenBabel
+#endif // TRACE_EVENTS_H
+
+//! \file trace_events.h
+//! \brief trace_events.h - Chrome/Perfetto trace-event output for batch runs
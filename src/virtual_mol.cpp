@@ -34,7 +34,7 @@ int VirtualMol::NumAtoms() {
 	return _atoms.size();
 }
 
-std::set<OBAtom*> VirtualMol::GetAtoms() {
+AtomSet VirtualMol::GetAtoms() {
 	return _atoms;
 }
 
@@ -70,8 +70,8 @@ bool VirtualMol::AddVirtualMol(VirtualMol addition) {
 		obErrorLog.ThrowError(__FUNCTION__, "VirtualMol parents do not match", obWarning);
 		return false;
 	}
-	std::set<OBAtom*> atoms_to_add = addition.GetAtoms();
-	for (std::set<OBAtom*>::iterator it=atoms_to_add.begin(); it!=atoms_to_add.end(); ++it) {
+	AtomSet atoms_to_add = addition.GetAtoms();
+	for (AtomSet::iterator it=atoms_to_add.begin(); it!=atoms_to_add.end(); ++it) {
 		_atoms.insert(*it);
 	}
 	return true;
@@ -103,7 +103,7 @@ ConnIntToExt VirtualMol::GetExternalBondsOrConns() {
 	// WARNING: if this function is run on a simplified_net, it will consider connection sites as
 	// external unless they're part of the VirtualMol
 	ConnIntToExt connections;
-	for (std::set<OBAtom*>::iterator it=_atoms.begin(); it!=_atoms.end(); ++it) {
+	for (AtomSet::iterator it=_atoms.begin(); it!=_atoms.end(); ++it) {
 		FOR_NBORS_OF_ATOM(nbor, *it) {
 			if (!HasAtom(&*nbor)) {
 				std::pair<OBAtom*, OBAtom*> bond(*it, &*nbor);
@@ -114,8 +114,9 @@ ConnIntToExt VirtualMol::GetExternalBondsOrConns() {
 	return connections;
 }
 
-void VirtualMol::CopyToMappedMol(MappedMol *dest, bool export_bonds, bool copy_bonds) {
+void VirtualMol::CopyToMappedMol(MappedMol *dest, bool export_bonds, bool copy_bonds, bool map_pseudo_atoms) {
 	// Copies VirtualMol to a destination MappedMol
+	// If map_pseudo_atoms is false, copy_pa_to_multiple is left empty for callers that only need mol_copy.
 	// WARNING: the copy_bonds=false path is untested
 
 	if (dest->origin_molp) {
@@ -129,12 +130,14 @@ void VirtualMol::CopyToMappedMol(MappedMol *dest, bool export_bonds, bool copy_b
 	dest->copy_pa_to_multiple.clear();
 
 	// Copy atoms
-	for (std::set<OBAtom*>::iterator it=_atoms.begin(); it!=_atoms.end(); ++it) {
+	for (AtomSet::iterator it=_atoms.begin(); it!=_atoms.end(); ++it) {
 		OBAtom* virtual_atom = (*it);
 		OBAtom* mol_atom = formAtom(pmol_copied, virtual_atom->GetVector(), virtual_atom->GetAtomicNum());
 		dest->origin_to_copy[virtual_atom] = mol_atom;
 		dest->copy_to_origin[mol_atom] = virtual_atom;
-		dest->copy_pa_to_multiple[mol_atom] = VirtualMol(virtual_atom);
+		if (map_pseudo_atoms) {
+			dest->copy_pa_to_multiple[mol_atom] = VirtualMol(virtual_atom);
+		}
 
 		// Also copy paddlewheel detection.  Based on framework.cpp:resetBonds
 		bool is_paddlewheel = virtual_atom->HasData("Paddlewheel");
@@ -150,16 +153,22 @@ void VirtualMol::CopyToMappedMol(MappedMol *dest, bool export_bonds, bool copy_b
 	}
 
 	if (copy_bonds) {
-		FOR_BONDS_OF_MOL(b, *_parent_mol) {
-			OBAtom* v_a1 = b->GetBeginAtom();
-			OBAtom* v_a2 = b->GetEndAtom();
-			int v_order = b->GetBondOrder();
-			if (HasAtom(v_a1) && HasAtom(v_a2)) {
-				OBAtom* copied_a1 = dest->origin_to_copy[v_a1];
-				OBAtom* copied_a2 = dest->origin_to_copy[v_a2];
-				formBond(pmol_copied, copied_a1, copied_a2, v_order);
+		// Only visit the bonds of the copied atoms, instead of every bond in the parent.
+		// Bonds are keyed by index, so each is copied once and in the parent's bond order.
+		std::map<unsigned long, OBBond*> internal_bonds;
+		for (AtomSet::iterator it=_atoms.begin(); it!=_atoms.end(); ++it) {
+			FOR_BONDS_OF_ATOM(b, *it) {
+				if (HasAtom(b->GetNbrAtom(*it))) {
+					internal_bonds[b->GetIdx()] = &*b;
+				}
 			}
 		}
+		for (std::map<unsigned long, OBBond*>::iterator it=internal_bonds.begin(); it!=internal_bonds.end(); ++it) {
+			OBBond* b = it->second;
+			OBAtom* copied_a1 = dest->origin_to_copy[b->GetBeginAtom()];
+			OBAtom* copied_a2 = dest->origin_to_copy[b->GetEndAtom()];
+			formBond(pmol_copied, copied_a1, copied_a2, b->GetBondOrder());
+		}
 	} else {  // recalculating bonds based on distance, etc.
 		resetBonds(pmol_copied);
 	}
@@ -169,7 +178,7 @@ void VirtualMol::CopyToMappedMol(MappedMol *dest, bool export_bonds, bool copy_b
 OBMol VirtualMol::ToOBMol(bool export_bonds, bool copy_bonds) {
 	// Wrapper for CopyToMappedMol() if we're only interested in an unmapped OBMol copy
 	MappedMol temp_map;
-	CopyToMappedMol(&temp_map, export_bonds, copy_bonds);
+	CopyToMappedMol(&temp_map, export_bonds, copy_bonds, false);
 	return temp_map.mol_copy;
 }
 
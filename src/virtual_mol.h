@@ -14,13 +14,15 @@ virtual_mol.h - Collection of OBAtom*, plus adapters for OBMol, etc.
 #include <openbabel/mol.h>
 #include <openbabel/atom.h>
 
+#include "scratch_arena.h"
+
 namespace OpenBabel
 {
 
 // Connections from interior of a fragment to external
 typedef std::pair<OBAtom*, OBAtom*> AtomPair;
-typedef std::set< AtomPair > ConnIntToExt;
-typedef std::set<OBAtom*> AtomSet;  // TODO consider using this alias throughout
+typedef ScratchSet< AtomPair > ConnIntToExt;
+typedef ScratchSet<OBAtom*> AtomSet;  // TODO consider using this alias throughout
 
 class VirtualMol;
 class MappedMol;
@@ -31,7 +33,7 @@ class VirtualMol {
 // instances and it's more difficult to compare two OBAtom's if they intrinsically have different raw pointers.
 // (Formerly, the code instead relied on searching for identical atomic number, position, etc.)
 private:
-	std::set<OBAtom*> _atoms;
+	AtomSet _atoms;
 	OBMol *_parent_mol;
 public:
 	// VirtualMol() = delete;  // does not make sense when there's a default parameter below.
@@ -41,7 +43,7 @@ public:
 	VirtualMol(OBAtom *single_atom);
 	OBMol* GetParent();
 	int NumAtoms();
-	std::set<OBAtom*> GetAtoms();
+	AtomSet GetAtoms();
 	bool HasAtom(OBAtom *a);
 	bool AddAtom(OBAtom *a);
 	bool RemoveAtom(OBAtom *a);
@@ -49,7 +51,7 @@ public:
 	// Imports an OBMol fragment with copies of atoms in the same positions as _parent_mol
 	int ImportCopiedFragment(OBMol *fragment);
 	ConnIntToExt GetExternalBondsOrConns();  // map of external connections in the parent molecule
-	void CopyToMappedMol(MappedMol *dest, bool export_bonds = true, bool copy_bonds = true);
+	void CopyToMappedMol(MappedMol *dest, bool export_bonds = true, bool copy_bonds = true, bool map_pseudo_atoms = true);
 	OBMol ToOBMol(bool export_bonds = true, bool copy_bonds = true);
 	void ToCIF(const std::string &filename, bool write_bonds = true);
 	// TODO: consider implementing SMILES in a parent class due to OBConv
@@ -67,7 +69,7 @@ public:
 	for (AtomSet::iterator a = __vset.begin(); a != __vset.end(); ++a)
 
 
-typedef std::map<OBAtom*, OBAtom*> atom_map_t;
+typedef ScratchMap<OBAtom*, OBAtom*> atom_map_t;
 
 class MappedMol {
 // Copy of an OBMol, including a 1:1 mapping between the origin and copied OBAtom's.
@@ -86,7 +88,7 @@ public:
 	atom_map_t origin_to_copy;
 	atom_map_t copy_to_origin;
 	// If we simplify mol_copy, this will keep track of a PA to the origin OBAtom's
-	std::map<OBAtom*, VirtualMol> copy_pa_to_multiple;
+	ScratchMap<OBAtom*, VirtualMol> copy_pa_to_multiple;
 
 	MappedMol() { origin_molp = NULL; };
 	virtual ~MappedMol() {};
@@ -0,0 +1,162 @@
+"""
+Fit the empirical scaling of each sbu stage on a series of supercells
+
+Replicates each CIF into 1x1x1 ... NxNxN P1 supercells with bin/supercell, runs
+bin/sbu --stats on each one, and fits time ~ atoms^k per deconstructor stage by
+least squares on a log-log scale.  An exponent near 1 is linear; 2 or more points
+to an O(N^2) path, e.g. pairwise atom lookups in detectSingleBonds or
+ImportCopiedFragment, or repeated scans in SimplifyAxB.
+
+Usage (from the repo root, like `make scalingtest`):
+python tests/check_scaling.py [--max-size 4] [--max-exponent K] [--json OUT] [CIFS...]
+
+With --max-exponent, exits with status 1 if any stage slower than --min-seconds
+at the largest size scales worse than K.  Sizes after a timeout are skipped.
+"""
+
+import os
+import sys
+import json
+import math
+import shutil
+import argparse
+import tempfile
+import subprocess
+
+DEFAULT_CIFS = [os.path.join('Resources', 'TestCIFs', 'P1-IRMOF-1.cif')]
+STRUCTURE_STAGES = 'import'  # label for the stages timed before any deconstructor runs
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description='Fit the scaling exponent of sbu stages on supercells')
+    parser.add_argument('cifs', nargs='*', default=DEFAULT_CIFS)
+    parser.add_argument('--max-size', type=int, default=4,
+        help='largest supercell, NxNxN (default: 4)')
+    parser.add_argument('--bin', default='bin',
+        help='directory containing sbu and supercell (default: bin)')
+    parser.add_argument('--algorithms', default='metaloxo',
+        help='passed to sbu --algorithms (default: metaloxo)')
+    parser.add_argument('--emit', default='smiles,cgd',
+        help='passed to sbu --emit (default: smiles,cgd, i.e. no CIF writing)')
+    parser.add_argument('--timeout', type=float, default=600,
+        help='seconds allowed per sbu run (default: 600)')
+    parser.add_argument('--min-seconds', type=float, default=0.01,
+        help='ignore stages faster than this at the largest size for --max-exponent (default: 0.01)')
+    parser.add_argument('--max-exponent', type=float, default=None,
+        help='fail if a stage scales worse than atoms^K')
+    parser.add_argument('--json', default=None,
+        help='also write the raw timings and fitted exponents to this file')
+    return parser.parse_args()
+
+
+def fit_exponent(points):
+    # Least squares slope of log(seconds) vs. log(atoms), or None without two usable sizes
+    logs = [(math.log(atoms), math.log(seconds)) for atoms, seconds in points if atoms > 0 and seconds > 0]
+    if len(set(x for x, _ in logs)) < 2:
+        return None
+    mean_x = sum(x for x, _ in logs) / len(logs)
+    mean_y = sum(y for _, y in logs) / len(logs)
+    sxx = sum((x - mean_x) ** 2 for x, _ in logs)
+    sxy = sum((x - mean_x) * (y - mean_y) for x, y in logs)
+    return sxy / sxx
+
+
+def run_series(cif, args, work_dir):
+    # Returns a list of (size, stats dict or None on failure) for 1x1x1 ... NxNxN
+    name = os.path.splitext(os.path.basename(cif))[0]
+    series = []
+    for n in range(1, args.max_size + 1):
+        label = '%s_%dx%dx%d' % (name, n, n, n)
+        supercell_cif = os.path.join(work_dir, label + '.cif')
+        output_dir = os.path.join(work_dir, label)
+        os.mkdir(output_dir)
+        subprocess.check_call([os.path.join(args.bin, 'supercell'), cif, str(n), str(n), str(n), supercell_cif],
+            stderr=subprocess.DEVNULL)
+        cmd = [os.path.join(args.bin, 'sbu'), '--stats', '--algorithms', args.algorithms,
+            '--emit', args.emit, supercell_cif, output_dir]
+        sys.stderr.write('Running %s\n' % ' '.join(cmd))
+        try:
+            subprocess.run(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL,
+                timeout=args.timeout, check=True)
+        except subprocess.TimeoutExpired:
+            sys.stderr.write('Timed out after %g s at %dx%dx%d, skipping larger cells\n' % (args.timeout, n, n, n))
+            series.append((n, None))
+            break
+        except subprocess.CalledProcessError as e:
+            sys.stderr.write('sbu failed with status %d at %dx%dx%d\n' % (e.returncode, n, n, n))
+            series.append((n, None))
+            break
+        with open(os.path.join(output_dir, 'stats.json')) as f:
+            series.append((n, json.load(f)))
+    return series
+
+
+def stage_timings(series):
+    # {(deconstructor, stage): [(atoms, seconds), ...]}, in the order the stages ran
+    timings = {}
+    order = []
+    for _, stats in series:
+        if stats is None:
+            continue
+        atoms = stats['counters']['atoms']
+        sections = [(STRUCTURE_STAGES, stats)] + list(stats['deconstructors'].items())
+        for section, section_stats in sections:
+            for stage, seconds in section_stats['stages'].items():
+                key = (section, stage)
+                if key not in timings:
+                    timings[key] = []
+                    order.append(key)
+                timings[key].append((atoms, seconds))
+    return [(key, timings[key]) for key in order]
+
+
+def report(cif, series, args):
+    # Prints a table of timings and exponents, returning the JSON summary and a list of failures
+    sizes = ['%dx%dx%d' % (n, n, n) for n, stats in series if stats is not None]
+    atoms = [stats['counters']['atoms'] for _, stats in series if stats is not None]
+    print('# %s' % cif)
+    print('%-40s %s %9s' % ('stage', ' '.join('%10s' % s for s in sizes), 'exponent'))
+    print('%-40s %s' % ('atoms', ' '.join('%10d' % a for a in atoms)))
+    summary = {'cif': cif, 'sizes': sizes, 'atoms': atoms, 'complete': len(sizes) == args.max_size, 'stages': []}
+    failures = []
+    for (section, stage), points in stage_timings(series):
+        exponent = fit_exponent(points)
+        label = section + '/' + stage
+        times = ' '.join('%10.4f' % seconds for _, seconds in points)
+        times += ' ' * (11 * (len(sizes) - len(points)))  # stages that did not run at every size
+        print('%-40s %s %9s' % (label, times, '-' if exponent is None else '%.2f' % exponent))
+        summary['stages'].append({'deconstructor': section, 'stage': stage,
+            'atoms': [a for a, _ in points], 'seconds': [s for _, s in points], 'exponent': exponent})
+        if (args.max_exponent is not None and exponent is not None and exponent > args.max_exponent
+                and points[-1][1] >= args.min_seconds):
+            failures.append('%s: %s scales as atoms^%.2f' % (cif, label, exponent))
+    print('')
+    return summary, failures
+
+
+def main():
+    args = parse_args()
+    work_dir = tempfile.mkdtemp(prefix='mofid_scaling_')
+    summaries = []
+    failures = []
+    try:
+        for cif in args.cifs:
+            cif_dir = os.path.join(work_dir, str(len(summaries)))  # CIFs may share a basename
+            os.mkdir(cif_dir)
+            series = run_series(cif, args, cif_dir)
+            summary, cif_failures = report(cif, series, args)
+            summaries.append(summary)
+            failures.extend(cif_failures)
+    finally:
+        shutil.rmtree(work_dir, ignore_errors=True)
+
+    if args.json is not None:
+        with open(args.json, 'w') as f:
+            json.dump(summaries, f, indent=2)
+    for failure in failures:
+        sys.stderr.write('FAILED: %s\n' % failure)
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())